@@ -30,6 +30,7 @@
 #endif
 
 #include "utils/FileSystemUtil.h"
+#include "utils/HashUtil.h"
 #include "utils/StringUtil.h"
 #include <fstream>
 #include <SDL.h>
@@ -1781,16 +1782,37 @@ std::string executeCMDInNewProcessAndReadOutput(LPSTR lpCommandLine)
 }
 #endif
 
-std::string ApiSystem::getCRC32(std::string fileName, bool fromZipContents)
+std::string ApiSystem::getCRC32(std::string fileName, bool fromZipContents, long long* bytesRead)
 {
-	std::string cmd = "7zr h \"" + fileName + "\"";
-	
+	if (bytesRead != nullptr)
+		*bytesRead = 0;
+
 	std::string ext = Utils::String::toLower(Utils::FileSystem::getExtension(fileName));
 	if (fromZipContents && (ext == ".7z" || ext == ".zip"))
-		cmd = "7zr l -slt \"" + fileName + "\"";
+	{
+		std::string crc = Utils::Hash::getArchiveCRC32(fileName);
+		if (!crc.empty() || ext != ".7z")
+			return crc;
+
+		// 7z archive with a compressed header : decoding it needs 7zr, the result is cached for the next calls
+		crc = getArchiveCRC32With7z(fileName);
+		Utils::Hash::setArchiveCRC32(fileName, crc);
+		return crc;
+	}
+
+	// The md5 comes with the same read : the scrapers ask for it next
+	Utils::Hash::Digest digest;
+	if (!Utils::Hash::hashFile(fileName, Utils::Hash::CRC32 | Utils::Hash::MD5, digest, bytesRead))
+		return "";
+
+	return digest.crc32;
+}
+
+std::string ApiSystem::getArchiveCRC32With7z(const std::string& fileName)
+{
+	std::string cmd = "7zr l -slt \"" + fileName + "\"";
 
 	std::string crc;
-	std::string fn = Utils::FileSystem::getFileName(fileName);
 
 #if WIN32
 	// Windows : use x86 7za to test. x64 version fails ( cuz our process is x86 )
@@ -1802,8 +1824,6 @@ std::string ApiSystem::getCRC32(std::string fileName, bool fromZipContents)
 		int idx = all.find("CRC = ");
 		if (idx != std::string::npos)
 			crc = all.substr(idx + 6);
-		else if (all.find(fn) == (all.size() - fn.size()) && all.length() > 8 && all[9] == ' ')
-			crc = all.substr(0, 8);
 	}
 
 	return crc;
@@ -1822,8 +1842,6 @@ std::string ApiSystem::getCRC32(std::string fileName, bool fromZipContents)
 		int idx = all.find("CRC = ");
 		if (idx != std::string::npos)
 			crc = all.substr(idx + 6);
-		else if (all.find(fn) == (all.size() - fn.size()) && all.length() > 8 && all[9] == ' ')
-			crc = all.substr(0, 8);
 	}
 	
 	pclose(pipe);
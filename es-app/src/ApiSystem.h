@@ -127,7 +127,8 @@ public:
     std::pair<std::string,int> installBatoceraBezel(std::string bezelsystem, const std::function<void(const std::string)>& func = nullptr);
     std::pair<std::string,int> uninstallBatoceraBezel(BusyComponent* ui, std::string bezelsystem);
 
-	std::string getCRC32(const std::string fileName, bool fromZipContents = true);
+	// bytesRead receives the bytes hashed from the file : 0 for cache hits and archives read from their directory
+	std::string getCRC32(const std::string fileName, bool fromZipContents = true, long long* bytesRead = nullptr);
 
 	bool	getBrighness(int& value);
 	void	setBrighness(int value);
@@ -136,6 +137,7 @@ public:
 
 private:
 	std::vector<std::string> executeEnumerationScript(const std::string command);
+	std::string getArchiveCRC32With7z(const std::string& fileName);
 
     static ApiSystem *instance;
 
@@ -0,0 +1,413 @@
+#include "Benchmark.h"
+
+#include "utils/FileSystemUtil.h"
+#include "utils/StringUtil.h"
+#include "resources/TextureAtlas.h"
+#include "ImageIO.h"
+#include "InputManager.h"
+#include "Log.h"
+#include "Window.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#if defined(USE_NULL_RENDERER)
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+
+// Headless builds are the benchmark builds : they count allocations by replacing the global operator new
+static std::atomic<size_t> sAllocations(0);
+
+void* operator new(size_t size)
+{
+	sAllocations++;
+
+	void* ptr = malloc(size > 0 ? size : 1);
+	if (ptr == nullptr)
+		throw std::bad_alloc();
+
+	return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+	free(ptr);
+}
+
+#define ALLOCATIONS_COUNTED 1
+static size_t getAllocations() { return sAllocations; }
+#else
+#define ALLOCATIONS_COUNTED 0
+static size_t getAllocations() { return 0; }
+#endif
+
+// Platforms with themes in most theme sets, so the generated systems look like real ones
+static const char* sPlatforms[] = { "nes", "snes", "megadrive", "gba", "psx", "n64", "mame", "gb", "gbc", "mastersystem", "pcengine", "atari2600", "neogeo", "gamegear", "fba", "segacd" };
+static const char* sGenres[] = { "Platform", "Shooter", "Sports", "Puzzle", "Racing", "Fighting", "Role playing game", "Action" };
+
+static std::string escapeJson(const std::string& value)
+{
+	std::string ret;
+	for (auto c : value)
+	{
+		if (c == '"' || c == '\\')
+			ret += '\\';
+
+		if ((unsigned char)c >= 0x20)
+			ret += c;
+	}
+
+	return ret;
+}
+
+bool Benchmark::generate(int systems, int games)
+{
+	std::string configPath = Utils::FileSystem::getEsConfigPath() + "/es_systems.cfg";
+	if (Utils::FileSystem::exists(configPath))
+	{
+		LOG(LogError) << "Benchmark::generate : " << configPath << " already exists, use --home with an empty folder";
+		return false;
+	}
+
+	std::string romsPath = Utils::FileSystem::getEsConfigPath() + "/benchmark/roms";
+
+	std::ofstream config(configPath);
+	config << "<?xml version=\"1.0\"?>\n<systemList>\n";
+
+	const int platforms = sizeof(sPlatforms) / sizeof(sPlatforms[0]);
+
+	for (int s = 0; s < systems; s++)
+	{
+		std::string platform = sPlatforms[s % platforms];
+		std::string name = s < platforms ? platform : platform + std::to_string(s / platforms);
+		std::string path = romsPath + "/" + name;
+
+		Utils::FileSystem::createDirectory(path);
+
+		config <<
+			"  <system>\n"
+			"    <name>" << name << "</name>\n"
+			"    <fullname>Benchmark " << name << "</fullname>\n"
+			"    <path>" << path << "</path>\n"
+			"    <extension>.zip</extension>\n"
+			"    <command>true</command>\n"
+			"    <platform>" << platform << "</platform>\n"
+			"    <theme>" << platform << "</theme>\n"
+			"  </system>\n";
+
+		std::ofstream gamelist(path + "/gamelist.xml");
+		gamelist << "<?xml version=\"1.0\"?>\n<gameList>\n";
+
+		for (int g = 0; g < games; g++)
+		{
+			std::ostringstream file;
+			file << "Game " << std::setw(6) << std::setfill('0') << g << ".zip";
+
+			std::ofstream rom(path + "/" + file.str());
+
+			gamelist <<
+				"  <game>\n"
+				"    <path>./" << file.str() << "</path>\n"
+				"    <name>" << name << " game " << g << "</name>\n"
+				"    <desc>Synthetic entry " << g << " of " << name << ", generated for benchmarks.</desc>\n"
+				"    <rating>" << (g % 11) / 10.0f << "</rating>\n"
+				"    <releasedate>" << (1980 + g % 40) << "0101T000000</releasedate>\n"
+				"    <developer>Developer " << g % 50 << "</developer>\n"
+				"    <publisher>Publisher " << g % 20 << "</publisher>\n"
+				"    <genre>" << sGenres[g % (sizeof(sGenres) / sizeof(sGenres[0]))] << "</genre>\n"
+				"    <players>" << 1 + g % 4 << "</players>\n"
+				"  </game>\n";
+		}
+
+		gamelist << "</gameList>\n";
+	}
+
+	config << "</systemList>\n";
+
+	LOG(LogInfo) << "Benchmark::generate : " << systems << " systems of " << games << " games in " << romsPath;
+	return true;
+}
+
+Benchmark::Benchmark(Window* window) : mWindow(window), mCurrentStep(0), mFrameAllocations(0), mFrameRepacks(0)
+{
+	mLabels.push_back("start");
+}
+
+bool Benchmark::load(const std::string& scriptPath)
+{
+	std::ifstream script(scriptPath);
+	if (!script.is_open())
+	{
+		LOG(LogError) << "Benchmark::load : unable to open " << scriptPath;
+		return false;
+	}
+
+	std::string line;
+	while (std::getline(script, line))
+	{
+		line = Utils::String::trim(line.substr(0, line.find('#')));
+		if (line.empty())
+			continue;
+
+		std::istringstream args(line);
+		std::string command, name;
+		int count = 1;
+
+		args >> command >> name;
+		if (!(args >> count))
+			count = 1;
+
+		Step step;
+		step.value = 0;
+
+		if (command == "input")
+		{
+			for (int i = 0; i < count; i++)
+			{
+				step.input = name; step.value = 1; mSteps.push_back(step);
+				step.input = name; step.value = 0; mSteps.push_back(step);
+			}
+		}
+		else if (command == "hold")
+		{
+			step.input = name; step.value = 1; mSteps.push_back(step);
+
+			step.input = "";
+			for (int i = 1; i < count; i++)
+				mSteps.push_back(step);
+
+			step.input = name; step.value = 0; mSteps.push_back(step);
+		}
+		else if (command == "wait")
+		{
+			// The frame count is the first argument
+			count = atoi(name.c_str());
+			for (int i = 0; i < count; i++)
+				mSteps.push_back(step);
+		}
+		else if (command == "mark")
+		{
+			step.label = line.substr(line.find(name));
+			mSteps.push_back(step);
+		}
+		else if (command == "image")
+		{
+			step.image = name;
+			step.value = count;
+			mSteps.push_back(step);
+		}
+		else
+			LOG(LogWarning) << "Benchmark::load : unknown command " << command;
+	}
+
+	return !mSteps.empty();
+}
+
+void Benchmark::sendInput(const std::string& name, int value)
+{
+	InputConfig* config = InputManager::getInstance()->getInputConfigByDevice(DEVICE_KEYBOARD);
+
+	Input input;
+	if (config == nullptr || !config->getInputByName(name, &input))
+	{
+		LOG(LogWarning) << "Benchmark : no keyboard mapping for " << name;
+		return;
+	}
+
+	input.value = value;
+	mWindow->input(config, input);
+}
+
+void Benchmark::measureImage(const std::string& path, int count)
+{
+	std::ifstream file(path, std::ios::binary);
+	std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (data.empty() || count <= 0)
+	{
+		LOG(LogWarning) << "Benchmark : unable to read " << path;
+		return;
+	}
+
+	ImageResult result;
+	result.path = path;
+	result.width = 0;
+	result.height = 0;
+	result.count = count;
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < count; i++)
+		delete[] ImageIO::loadFromMemoryRGBA32(data.data(), data.size(), result.width, result.height);
+
+	double decodeTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	size_t rowSize = result.width * 4;
+	double megabytes = (double)(rowSize * result.height) * count / (1024.0 * 1024.0);
+
+	// Same scanline pass as the decoder : swizzle each row into its flipped position
+	std::vector<unsigned char> source(rowSize * result.height, 0x80);
+	std::vector<unsigned char> target(source.size());
+
+	start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < count; i++)
+		for (size_t y = 0; y < result.height; y++)
+			ImageIO::swizzleBGRA((const unsigned int*)(source.data() + y * rowSize), (unsigned int*)(target.data() + (result.height - 1 - y) * rowSize), result.width);
+
+	double swizzleTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// Same pass as a downscaled decode, at half size
+	size_t halfWidth = std::max((size_t)1, result.width / 2);
+	size_t halfHeight = std::max((size_t)1, result.height / 2);
+
+	start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < count; i++)
+		ImageIO::downscaleBGRA(source.data(), result.width, result.height, rowSize, 4, (unsigned int*)target.data(), halfWidth, halfHeight);
+
+	double downscaleTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	result.decodeMBs = decodeTime > 0 ? megabytes / decodeTime : 0;
+	result.swizzleMBs = swizzleTime > 0 ? megabytes / swizzleTime : 0;
+	result.downscaleMBs = downscaleTime > 0 ? megabytes / downscaleTime : 0;
+	mImages.push_back(result);
+
+	LOG(LogInfo) << "Benchmark : " << path << " " << result.width << "x" << result.height << ", decode " << result.decodeMBs << " MB/s, swizzle " << result.swizzleMBs << " MB/s, downscale " << result.downscaleMBs << " MB/s";
+}
+
+bool Benchmark::update()
+{
+	// Marks and image measures don't take a frame
+	while (mCurrentStep < mSteps.size() && (!mSteps[mCurrentStep].label.empty() || !mSteps[mCurrentStep].image.empty()))
+	{
+		const Step& step = mSteps[mCurrentStep++];
+		if (!step.image.empty())
+			measureImage(step.image, step.value);
+		else
+			mLabels.push_back(step.label);
+	}
+
+	if (mCurrentStep >= mSteps.size())
+		return false;
+
+	const Step& step = mSteps[mCurrentStep++];
+	if (!step.input.empty())
+		sendInput(step.input, step.value);
+
+	return true;
+}
+
+void Benchmark::beginFrame()
+{
+	mFrameStart = std::chrono::steady_clock::now();
+	mFrameAllocations = getAllocations();
+	mFrameRepacks = TextureAtlas::getRepackCount();
+}
+
+void Benchmark::endFrame()
+{
+	Frame frame;
+	frame.label = mLabels.size() - 1;
+	frame.cpuTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mFrameStart).count();
+	frame.stats = Renderer::getFrameStats();
+	frame.allocations = getAllocations() - mFrameAllocations;
+	frame.atlasPages = TextureAtlas::getPageCount();
+	frame.atlasRepacks = TextureAtlas::getRepackCount() - mFrameRepacks;
+
+	mFrames.push_back(frame);
+}
+
+bool Benchmark::save(const std::string& path)
+{
+	std::ofstream out(path);
+	if (!out.is_open())
+	{
+		LOG(LogError) << "Benchmark::save : unable to write " << path;
+		return false;
+	}
+
+	out << std::fixed << std::setprecision(3);
+	out << "{\n  \"frameTime\": " << FRAME_TIME << ",\n  \"allocationsCounted\": " << (ALLOCATIONS_COUNTED ? "true" : "false") << ",\n";
+
+	out << "  \"sections\": [\n";
+
+	for (size_t label = 0; label < mLabels.size(); label++)
+	{
+		std::vector<double> times;
+		Renderer::FrameStats total;
+		size_t allocations = 0;
+		size_t atlasPages = 0;
+		size_t atlasRepacks = 0;
+
+		for (auto& frame : mFrames)
+		{
+			if (frame.label != label)
+				continue;
+
+			atlasPages = frame.atlasPages;
+			atlasRepacks += frame.atlasRepacks;
+
+			times.push_back(frame.cpuTime);
+			total.draws += frame.stats.draws;
+			total.drawCalls += frame.stats.drawCalls;
+			total.textureBinds += frame.stats.textureBinds;
+			total.textureUploads += frame.stats.textureUploads;
+			allocations += frame.allocations;
+		}
+
+		std::sort(times.begin(), times.end());
+
+		size_t count = times.size();
+		double sum = 0;
+		for (auto time : times)
+			sum += time;
+
+		out << "    { \"label\": \"" << escapeJson(mLabels[label]) << "\", \"frames\": " << count;
+
+		if (count > 0)
+		{
+			out << ", \"cpuAvg\": " << sum / count << ", \"cpuP50\": " << times[count / 2] << ", \"cpuP95\": " << times[std::min(count - 1, count * 95 / 100)] << ", \"cpuMax\": " << times.back() <<
+				", \"drawsAvg\": " << (double)total.draws / count << ", \"drawCallsAvg\": " << (double)total.drawCalls / count <<
+				", \"textureBindsAvg\": " << (double)total.textureBinds / count << ", \"textureUploads\": " << total.textureUploads <<
+				", \"atlasPages\": " << atlasPages << ", \"atlasRepacks\": " << atlasRepacks;
+
+			if (ALLOCATIONS_COUNTED)
+				out << ", \"allocations\": " << allocations;
+		}
+
+		out << " }" << (label + 1 < mLabels.size() ? "," : "") << "\n";
+	}
+
+	out << "  ],\n  \"images\": [\n";
+
+	for (size_t i = 0; i < mImages.size(); i++)
+	{
+		const ImageResult& image = mImages[i];
+
+		out << "    { \"path\": \"" << escapeJson(image.path) << "\", \"width\": " << image.width << ", \"height\": " << image.height << ", \"count\": " << image.count <<
+			", \"decodeMBs\": " << image.decodeMBs << ", \"swizzleMBs\": " << image.swizzleMBs << ", \"downscaleMBs\": " << image.downscaleMBs << " }" << (i + 1 < mImages.size() ? "," : "") << "\n";
+	}
+
+	out << "  ],\n  \"frames\": [\n";
+
+	for (size_t i = 0; i < mFrames.size(); i++)
+	{
+		const Frame& frame = mFrames[i];
+
+		out << "    { \"label\": " << frame.label << ", \"cpu\": " << frame.cpuTime << ", \"draws\": " << frame.stats.draws << ", \"drawCalls\": " << frame.stats.drawCalls <<
+			", \"stateChanges\": " << frame.stats.stateChanges << ", \"textureBinds\": " << frame.stats.textureBinds << ", \"textureUploads\": " << frame.stats.textureUploads <<
+			", \"atlasPages\": " << frame.atlasPages << ", \"atlasRepacks\": " << frame.atlasRepacks;
+
+		if (ALLOCATIONS_COUNTED)
+			out << ", \"allocations\": " << frame.allocations;
+
+		out << " }" << (i + 1 < mFrames.size() ? "," : "") << "\n";
+	}
+
+	out << "  ]\n}\n";
+
+	LOG(LogInfo) << "Benchmark::save : " << mFrames.size() << " frames written to " << path;
+	return true;
+}
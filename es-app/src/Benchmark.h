@@ -0,0 +1,92 @@
+#pragma once
+#ifndef ES_APP_BENCHMARK_H
+#define ES_APP_BENCHMARK_H
+
+#include "renderers/Renderer.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+class Window;
+
+//
+// Scripted benchmark (--benchmark). Replays an input script at a fixed frame time and records, for each frame,
+// the CPU time of update + render + swap, the renderer counters, the texture atlas pages & repacks and the number of
+// allocations (headless builds only). Results are written as JSON with a summary per script section.
+// Running the same script with TextureAtlasMaxSize set to 0 gives the texture binds without the atlas.
+//
+// Script : one command per line, '#' starts a comment
+//   input <name> [count]   press and release a mapped input (up, down, left, right, a, b, start, select, pageup...)
+//   hold <name> <frames>   keep an input pressed (list scrolling acceleration)
+//   wait <frames>          let the UI run
+//   mark <label>           start a new section in the results
+//   image <path> [count]   decode an image count times, outside of any frame, and report the ImageIO throughputs in MB/s
+//
+class Benchmark
+{
+public:
+	// Frame time given to Window::update, so runs are comparable whatever the machine
+	static const int FRAME_TIME = 16;
+
+	// Writes es_systems.cfg, empty roms and gamelists for 'systems' systems of 'games' games in the config folder
+	static bool generate(int systems, int games);
+
+	Benchmark(Window* window);
+
+	bool load(const std::string& scriptPath);
+
+	// Sends the inputs of the next frame. Returns false when the script is over
+	bool update();
+
+	void beginFrame();
+	void endFrame();
+
+	bool save(const std::string& path);
+
+private:
+	struct Step
+	{
+		std::string	input;
+		int			value;
+		std::string	label;
+		std::string	image;
+	};
+
+	struct ImageResult
+	{
+		std::string	path;
+		size_t		width;
+		size_t		height;
+		int			count;
+		double		decodeMBs;	// full decode : FreeImage + swizzle
+		double		swizzleMBs;	// swizzle & vertical flip scanline pass alone
+		double		downscaleMBs; // fused box downscale to half size + swizzle + flip, in MB of source pixels
+	};
+
+	struct Frame
+	{
+		size_t					label;
+		double					cpuTime;
+		Renderer::FrameStats	stats;
+		size_t					allocations;
+		size_t					atlasPages;
+		size_t					atlasRepacks;
+	};
+
+	void sendInput(const std::string& name, int value);
+	void measureImage(const std::string& path, int count);
+
+	Window*						mWindow;
+	std::vector<Step>			mSteps;
+	size_t						mCurrentStep;
+
+	std::vector<std::string>	mLabels;
+	std::vector<Frame>			mFrames;
+	std::vector<ImageResult>	mImages;
+
+	std::chrono::steady_clock::time_point mFrameStart;
+	size_t						mFrameAllocations;
+	size_t						mFrameRepacks;
+};
+
+#endif // ES_APP_BENCHMARK_H
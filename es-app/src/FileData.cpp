@@ -15,14 +15,19 @@
 #include "VolumeControl.h"
 #include "Window.h"
 #include "views/UIModeController.h"
+#include "resources/TextureResource.h"
+#include "Settings.h"
 #include <assert.h>
 #include "SystemConf.h"
 #include "InputManager.h"
 #include "scrapers/ThreadedScraper.h"
 #include "Gamelist.h" 
 #include "ApiSystem.h"
+#include "LocalArtManifest.h"
 #include <time.h>
 
+#define GAME_RETURN_TIMEOUT 1500 // ms waited for the textures on screen when a game exits (FastGameLaunch)
+
 FileData::FileData(FileType type, const std::string& path, SystemData* system)
 	: mType(type), mSystem(system), mParent(NULL), mMetadata(type == GAME ? GAME_METADATA : FOLDER_METADATA) // metadata is REALLY set in the constructor!
 {
@@ -88,6 +93,28 @@ std::string FileData::getCleanName() const
 	return Utils::String::removeParenthesis(this->getDisplayName());
 }
 
+static std::mutex localArtLock;
+
+// LocalArt : first media of the list found in the "images" folder of the system
+static std::string findLocalArt(FileData* file, std::initializer_list<LocalArtManifest::Media> medias)
+{
+	SystemEnvironmentData* envData = file->getSystemEnvData();
+	if (envData == nullptr)
+		return "";
+
+	std::shared_ptr<LocalArtManifest> manifest;
+
+	{
+		std::unique_lock<std::mutex> lock(localArtLock);
+		if (envData->mLocalArt == nullptr)
+			envData->mLocalArt = std::make_shared<LocalArtManifest>(envData->mStartPath + "/images");
+
+		manifest = envData->mLocalArt;
+	}
+
+	return manifest->find(file->getDisplayName(), medias);
+}
+
 const std::string FileData::getThumbnailPath()
 {
 	std::string thumbnail = getMetadata().get("thumbnail");
@@ -98,19 +125,9 @@ const std::string FileData::getThumbnailPath()
 		// no image, try to use local image
 		if(thumbnail.empty() && Settings::getInstance()->getBool("LocalArt"))
 		{
-			const char* extList[2] = { ".png", ".jpg" };
-			for(int i = 0; i < 2; i++)
-			{
-				if(thumbnail.empty())
-				{
-					std::string path = getSystemEnvData()->mStartPath + "/images/" + getDisplayName() + "-thumb" + extList[i];
-					if (Utils::FileSystem::exists(path))
-					{
-						setMetadata("thumbnail", path);
-						thumbnail = path;
-					}
-				}
-			}
+			thumbnail = findLocalArt(this, { LocalArtManifest::THUMB_PNG, LocalArtManifest::THUMB_JPG });
+			if (!thumbnail.empty())
+				setMetadata("thumbnail", thumbnail);
 		}
 
 		if (thumbnail.empty())
@@ -118,21 +135,7 @@ const std::string FileData::getThumbnailPath()
 
 		// no image, try to use local image
 		if (thumbnail.empty() && Settings::getInstance()->getBool("LocalArt"))
-		{
-			const char* extList[2] = { ".png", ".jpg" };
-			for (int i = 0; i < 2; i++)
-			{
-				if (thumbnail.empty())
-				{
-					std::string path = getSystemEnvData()->mStartPath + "/images/" + getDisplayName() + "-image" + extList[i];					
-					if (!Utils::FileSystem::exists(path))
-						path = getSystemEnvData()->mStartPath + "/images/" + getDisplayName() + extList[i];
-
-					if (Utils::FileSystem::exists(path))
-						thumbnail = path;
-				}
-			}
-		}
+			thumbnail = findLocalArt(this, { LocalArtManifest::IMAGE_PNG, LocalArtManifest::PLAIN_PNG, LocalArtManifest::IMAGE_JPG, LocalArtManifest::PLAIN_JPG });
 	}
 
 	return thumbnail;
@@ -140,17 +143,17 @@ const std::string FileData::getThumbnailPath()
 
 const bool FileData::getFavorite()
 {
-	return getMetadata().get("favorite") == "true";
+	return getMetadata().getBool(MetaDataId::Favorite);
 }
 
 const bool FileData::getHidden()
 {
-	return getMetadata().get("hidden") == "true";
+	return getMetadata().getBool(MetaDataId::Hidden);
 }
 
 const bool FileData::getKidGame()
 {
-	return getMetadata().get("kidgame") != "false";
+	return getMetadata().get(MetaDataId::KidGame) != "false";
 }
 
 static std::shared_ptr<bool> showFilenames;
@@ -184,12 +187,9 @@ const std::string FileData::getVideoPath()
 	// no video, try to use local video
 	if(video.empty() && Settings::getInstance()->getBool("LocalArt"))
 	{
-		std::string path = getSystemEnvData()->mStartPath + "/images/" + getDisplayName() + "-video.mp4";
-		if (Utils::FileSystem::exists(path))
-		{
-			setMetadata("video", path);
-			video = path;
-		}
+		video = findLocalArt(this, { LocalArtManifest::VIDEO_MP4 });
+		if (!video.empty())
+			setMetadata("video", video);
 	}
 	
 	return video;
@@ -202,19 +202,9 @@ const std::string FileData::getMarqueePath()
 	// no marquee, try to use local marquee
 	if (marquee.empty() && Settings::getInstance()->getBool("LocalArt"))
 	{
-		const char* extList[2] = { ".png", ".jpg" };
-		for(int i = 0; i < 2; i++)
-		{
-			if(marquee.empty())
-			{
-				std::string path = getSystemEnvData()->mStartPath + "/images/" + getDisplayName() + "-marquee" + extList[i];
-				if (Utils::FileSystem::exists(path))
-				{
-					setMetadata("marquee", path);
-					marquee = path;
-				}
-			}
-		}
+		marquee = findLocalArt(this, { LocalArtManifest::MARQUEE_PNG, LocalArtManifest::MARQUEE_JPG });
+		if (!marquee.empty())
+			setMetadata("marquee", marquee);
 	}
 
 	return marquee;
@@ -230,24 +220,11 @@ const std::string FileData::getImagePath()
 		if (getSystemName() == "imageviewer")
 			image = getPath();
 
-		if (Settings::getInstance()->getBool("LocalArt"))
+		if (image.empty() && Settings::getInstance()->getBool("LocalArt"))
 		{
-			const char* extList[2] = { ".png", ".jpg" };
-			for (int i = 0; i < 2; i++)
-			{
-				if (image.empty())
-				{
-					std::string path = getSystemEnvData()->mStartPath + "/images/" + getDisplayName() + "-image" + extList[i];
-					if (!Utils::FileSystem::exists(path))
-						path = getSystemEnvData()->mStartPath + "/images/" + getDisplayName() + extList[i];
-
-					if (Utils::FileSystem::exists(path))
-					{
-						setMetadata("image", path);
-						image = path;
-					}
-				}
-			}
+			image = findLocalArt(this, { LocalArtManifest::IMAGE_PNG, LocalArtManifest::PLAIN_PNG, LocalArtManifest::IMAGE_JPG, LocalArtManifest::PLAIN_JPG });
+			if (!image.empty())
+				setMetadata("image", image);
 		}
 	}
 
@@ -279,6 +256,20 @@ void FileData::launchGame(Window* window, LaunchGameOptions options)
 {
 	LOG(LogInfo) << "Attempting to launch game...";
 
+	// Fast launch : the game-start scripts run while the UI is released, and the textures of the
+	// current view are loaded first, before the first frame, when the game exits
+	const bool fastLaunch = Settings::getInstance()->getBool("FastGameLaunch");
+
+	const std::string rom = Utils::FileSystem::getEscapedPath(getPath());
+	const std::string basename = Utils::FileSystem::getStem(getPath());
+	const std::string rom_raw = Utils::FileSystem::getPreferredPath(getPath());
+
+	if (fastLaunch)
+	{
+		TextureResource::snapshotTextures();
+		Scripting::fireEventAsync("game-start", rom, basename);
+	}
+
 	AudioManager::getInstance()->deinit(); // batocera
 	VolumeControl::getInstance()->deinit();
 
@@ -290,10 +281,6 @@ void FileData::launchGame(Window* window, LaunchGameOptions options)
 	std::string systemName = getSourceFileData()->getSystem()->getName();
 	std::string command = getSystemEnvData()->mLaunchCommand;
 
-	const std::string rom = Utils::FileSystem::getEscapedPath(getPath());
-	const std::string basename = Utils::FileSystem::getStem(getPath());
-	const std::string rom_raw = Utils::FileSystem::getPreferredPath(getPath());
-
 	command = Utils::String::replace(command, "%SYSTEM%", systemName); // batocera
 	command = Utils::String::replace(command, "%ROM%", rom);
 	command = Utils::String::replace(command, "%BASENAME%", basename);
@@ -361,7 +348,11 @@ void FileData::launchGame(Window* window, LaunchGameOptions options)
 
 
 
-	Scripting::fireEvent("game-start", rom, basename);
+	// The game starts once its scripts are done
+	if (fastLaunch)
+		Scripting::waitForAsyncEvents();
+	else
+		Scripting::fireEvent("game-start", rom, basename);
 
 	time_t tstart = time(NULL);
 
@@ -373,6 +364,9 @@ void FileData::launchGame(Window* window, LaunchGameOptions options)
 		LOG(LogWarning) << "...launch terminated with nonzero exit code " << exitCode << "!";
 	}
 
+	window->measureTexturedFrame();
+
+	// Not in the background : game-end scripts may still use the display or the audio, they are done before ES takes them back
 	Scripting::fireEvent("game-end");
 
 	window->init();
@@ -381,6 +375,10 @@ void FileData::launchGame(Window* window, LaunchGameOptions options)
 	// mSystem can be NULL
 	//AudioManager::getInstance()->setName(mSystem->getName()); // batocera system-specific music
 	AudioManager::getInstance()->init(); // batocera
+
+	if (fastLaunch)
+		TextureResource::restoreTextures(GAME_RETURN_TIMEOUT);
+
 	window->normalizeNextUpdate();
 
 	//update number of times the game has been launched
@@ -4,10 +4,14 @@
 #include "utils/StringUtil.h"
 #include "FileData.h"
 #include "FileFilterIndex.h"
+#include "GamelistJournal.h"
+#include "GamelistSnapshot.h"
 #include "Log.h"
 #include "Settings.h"
 #include "SystemData.h"
 #include <pugixml/src/pugixml.hpp>
+#include <chrono>
+#include <sstream>
 
 #ifdef WIN32
 #include <Windows.h>
@@ -104,7 +108,52 @@ FileData* findOrCreateFile(SystemData* system, const std::string& path, FileType
 	return NULL;
 }
 
-void loadGamelistFile (const std::string xmlpath, SystemData* system, std::unordered_map<std::string, FileData*>& fileMap, size_t checkSize = SIZE_MAX)
+FileData* loadGamelistNode(pugi::xml_node& fileNode, SystemData* system, std::unordered_map<std::string, FileData*>& fileMap, bool trustGamelist)
+{
+	FileType type = GAME;
+
+	std::string tag = fileNode.name();
+
+	if (tag == "folder")
+		type = FOLDER;
+	else if (tag != "game")
+		return nullptr;
+
+	const std::string path = Utils::FileSystem::resolveRelativePath(fileNode.child("path").text().get(), system->getStartPath(), false);
+
+	// Files found by populateFolder are known to exist
+	if (!trustGamelist && fileMap.find(path) == fileMap.cend() && !Utils::FileSystem::exists(path))
+	{
+		LOG(LogWarning) << "File \"" << path << "\" does not exist! Ignoring.";
+		return nullptr;
+	}
+
+	FileData* file = findOrCreateFile(system, path, type, fileMap);
+	if (!file)
+	{
+		LOG(LogError) << "Error finding/creating FileData for \"" << path << "\", skipping.";
+		return nullptr;
+	}
+
+	if (file->isArcadeAsset())
+		return nullptr;
+
+	std::string defaultName = file->getMetadata().get("name");
+	file->setMetadata(MetaDataList::createFromXML(type == FOLDER ? FOLDER_METADATA : GAME_METADATA, fileNode, system));
+
+	//make sure name gets set if one didn't exist
+	if (file->getMetadata().get("name").empty())
+		file->setMetadata("name", defaultName);
+
+	if (!file->getHidden() && Utils::FileSystem::isHidden(path))
+		file->getMetadata().set("hidden", "true");
+
+	file->getMetadata().resetChangedFlag();
+	return file;
+}
+
+// snapshotEntries receives every entry of the file, including the ones whose file is missing
+void loadGamelistFile (const std::string xmlpath, SystemData* system, std::unordered_map<std::string, FileData*>& fileMap, size_t checkSize = SIZE_MAX, std::vector<FileData*>* loadedFiles = nullptr, std::vector<GamelistSnapshot::Entry>* snapshotEntries = nullptr)
 {	
 	bool trustGamelist = Settings::getInstance()->getBool("ParseGamelistOnly");
 
@@ -136,51 +185,72 @@ void loadGamelistFile (const std::string xmlpath, SystemData* system, std::unord
 		}
 	}
 	
-	std::string relativeTo = system->getStartPath();
-
 	for (pugi::xml_node fileNode : root.children())
 	{
-		FileType type = GAME;
+		FileData* file = loadGamelistNode(fileNode, system, fileMap, trustGamelist);
 
-		std::string tag = fileNode.name();
+		if (snapshotEntries != nullptr)
+		{
+			if (file != nullptr)
+				snapshotEntries->push_back(GamelistSnapshot::Entry(file->getType(), file->getPath(), file->getMetadata()));
+			else
+			{
+				// Missing now, the file may be back (or moved to a subfolder) when the snapshot is used
+				std::string tag = fileNode.name();
+				if (tag == "game" || tag == "folder")
+				{
+					FileType type = tag == "folder" ? FOLDER : GAME;
+					std::string path = Utils::FileSystem::resolveRelativePath(fileNode.child("path").text().get(), system->getStartPath(), false);
+					snapshotEntries->push_back(GamelistSnapshot::Entry(type, path, MetaDataList::createFromXML(type == FOLDER ? FOLDER_METADATA : GAME_METADATA, fileNode, system)));
+				}
+			}
+		}
 
-		if (tag == "folder")
-			type = FOLDER;
-		else if (tag != "game")
+		if (file == nullptr)
 			continue;
 
-		const std::string path = Utils::FileSystem::resolveRelativePath(fileNode.child("path").text().get(), relativeTo, false);
-				
-		if (!trustGamelist && !Utils::FileSystem::exists(path))
-		{
-			LOG(LogWarning) << "File \"" << path << "\" does not exist! Ignoring.";
+		if (checkSize != SIZE_MAX)
+			file->getMetadata().setDirty();
+
+		if (loadedFiles != nullptr)
+			loadedFiles->push_back(file);
+	}
+}
+
+bool loadGamelistSnapshot(const std::string xmlpath, SystemData* system, std::unordered_map<std::string, FileData*>& fileMap)
+{
+	GamelistSnapshot snapshot;
+	if (!snapshot.open(system, xmlpath))
+		return false;
+
+	bool trustGamelist = Settings::getInstance()->getBool("ParseGamelistOnly");
+
+	for (size_t i = 0; i < snapshot.size(); i++)
+	{
+		FileType type = snapshot.getType(i);
+		std::string path = snapshot.getPath(i);
+
+		if (!trustGamelist && fileMap.find(path) == fileMap.cend() && !Utils::FileSystem::exists(path))
 			continue;
-		}
 
 		FileData* file = findOrCreateFile(system, path, type, fileMap);
-		if (!file)
-		{
-			LOG(LogError) << "Error finding/creating FileData for \"" << path << "\", skipping.";
+		if (file == nullptr || file->isArcadeAsset())
 			continue;
-		}
-		else if (!file->isArcadeAsset())
-		{
-			std::string defaultName = file->getMetadata().get("name");
-			file->setMetadata(MetaDataList::createFromXML(type == FOLDER ? FOLDER_METADATA : GAME_METADATA, fileNode, system));
 
-			//make sure name gets set if one didn't exist
-			if (file->getMetadata().get("name").empty())
-				file->setMetadata("name", defaultName);
+		// Same as loadGamelistNode : entries stored while their file was missing have no default name
+		std::string defaultName = file->getMetadata().get("name");
+		file->setMetadata(snapshot.getMetadata(i, system));
 
-			if (!file->getHidden() && Utils::FileSystem::isHidden(path))
-				file->getMetadata().set("hidden", "true");
+		if (file->getMetadata().get("name").empty())
+			file->setMetadata("name", defaultName);
 
-			if (checkSize != SIZE_MAX)
-				file->getMetadata().setDirty();
-			else
-				file->getMetadata().resetChangedFlag();
-		}
+		if (!file->getHidden() && Utils::FileSystem::isHidden(path))
+			file->getMetadata().set("hidden", "true");
+
+		file->getMetadata().resetChangedFlag();
 	}
+
+	return true;
 }
 
 void clearTemporaryGamelistRecovery(SystemData* system)
@@ -210,11 +280,42 @@ void parseGamelist(SystemData* system, std::unordered_map<std::string, FileData*
 
 	auto size = Utils::FileSystem::getFileSize(xmlpath);
 	if (size != 0)
-		loadGamelistFile(xmlpath, system, fileMap);
+	{
+		auto startTime = std::chrono::steady_clock::now();
+
+		if (!GamelistSnapshot::isEnabled())
+			loadGamelistFile(xmlpath, system, fileMap);
+		else if (loadGamelistSnapshot(xmlpath, system, fileMap))
+			LOG(LogDebug) << "parseGamelist " << system->getName() << " : snapshot loaded in " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count() << "ms";
+		else
+		{
+			std::vector<GamelistSnapshot::Entry> entries;
+			loadGamelistFile(xmlpath, system, fileMap, SIZE_MAX, nullptr, &entries);
+			GamelistSnapshot::save(system, xmlpath, entries);
+
+			LOG(LogDebug) << "parseGamelist " << system->getName() << " : XML parsed in " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count() << "ms";
+		}
+	}
+
+	// Recovery files written by older versions
+	std::vector<FileData*> recoveredFiles;
 
 	auto files = Utils::FileSystem::getDirContent(getGamelistRecoveryPath(system), true);
 	for (auto file : files)
-		loadGamelistFile(file, system, fileMap, size);
+		loadGamelistFile(file, system, fileMap, size, &recoveredFiles);
+
+	// Changes made since gamelist.xml was last written
+	bool trustGamelist = Settings::getInstance()->getBool("ParseGamelistOnly");
+	GamelistJournal::replay(system, [system, &fileMap, trustGamelist](pugi::xml_node& fileNode) { loadGamelistNode(fileNode, system, fileMap, trustGamelist); });
+
+	// Move recovered changes to the journal
+	if (recoveredFiles.size() > 0)
+	{
+		for (auto file : recoveredFiles)
+			saveToGamelistRecovery(file);
+
+		clearTemporaryGamelistRecovery(system);
+	}
 
 	if (size != SIZE_MAX)
 		system->setGamelistHash(size);
@@ -244,43 +345,37 @@ bool addFileDataNode(pugi::xml_node& parent, const FileData* file, const char* t
 	return true;	
 }
 
-bool saveToGamelistRecovery(FileData* file)
+static void appendToJournal(FileData* file, SystemData* system)
 {
-	if (!Settings::getInstance()->getBool("SaveGamelistsOnExit"))
-		return false;
-	
+	const char* tag = (file->getType() == GAME) ? "game" : "folder";
+
 	pugi::xml_document doc;
 	pugi::xml_node root = doc.append_child("gameList");
 
-	const char* tag = file->getType() == GAME ? "game" : "folder";
-
-	SystemData* system = file->getSourceFileData()->getSystem();
-	root.append_attribute("parentHash").set_value(system->getGamelistHash());
-
-	if (addFileDataNode(root, file, tag, system))
+	if (!addFileDataNode(root, file, tag, system))
 	{
-		std::string fp = file->getFullPath();
-		fp = Utils::FileSystem::createRelativePath(file->getFullPath(), system->getRootFolder()->getFullPath(), true);
-		fp = Utils::FileSystem::getParent(fp) + "/" + Utils::FileSystem::getStem(fp) + ".xml";
-
-		std::string path = Utils::FileSystem::getAbsolutePath(fp, getGamelistRecoveryPath(system));
-		path = Utils::FileSystem::getCanonicalPath(path);
+		// Nothing left but the default name : the record removes the entry from gamelist.xml
+		root.append_child(tag).append_child("path").text().set(Utils::FileSystem::createRelativePath(file->getPath(), system->getStartPath(), false).c_str());
+	}
 
-		std::string folder = Utils::FileSystem::getParent(path);
+	std::ostringstream node;
+	root.first_child().print(node, "", pugi::format_raw);
 
-		if (!Utils::FileSystem::exists(folder))
-			Utils::FileSystem::createDirectory(folder);
+	GamelistJournal::append(system, node.str());
+	file->getMetadata().resetChangedFlag();
+}
 
-		if (!doc.save_file(path.c_str()))
-		{
-			LOG(LogError) << "Error saving gamelist.xml to \"" << path << "\" (for system " << system->getName() << ")!";
-			return false;
-		}
+bool saveToGamelistRecovery(FileData* file)
+{
+	if (!Settings::getInstance()->getBool("SaveGamelistsOnExit") || Settings::getInstance()->getBool("IgnoreGamelist"))
+		return false;
 
-		return true;
-	}
+	SystemData* system = file->getSourceFileData()->getSystem();
+	if (system == nullptr || !system->isGameSystem() || system->getName() == "imageviewer")
+		return false;
 
-	return false;
+	appendToJournal(file->getSourceFileData(), system);
+	return true;
 }
 
 bool hasDirtyFile(SystemData* system)
@@ -301,10 +396,7 @@ bool hasDirtyFile(SystemData* system)
 
 void updateGamelist(SystemData* system)
 {
-	//We do this by reading the XML again, adding changes and then writing it back,
-	//because there might be information missing in our systemdata which would then miss in the new XML.
-	//We have the complete information for every game though, so we can simply remove a game
-	//we already have in the system from the XML, and then add it back from its GameData information...
+	// Changed entries are appended to the journal of the system, GamelistJournal merges them into gamelist.xml in the background
 
 	if(system == nullptr || Settings::getInstance()->getBool("IgnoreGamelist"))
 		return;
@@ -319,90 +411,17 @@ void updateGamelist(SystemData* system)
 		return;
 	}
 
-	std::vector<FileData*> dirtyFiles;
-	std::vector<FileData*> files = rootFolder->getFilesRecursive(GAME | FOLDER);
-	for (auto file : files)
-		if (file->getMetadata().wasChanged())
-			dirtyFiles.push_back(file);
-
-	if (dirtyFiles.size() == 0)
-	{
-		clearTemporaryGamelistRecovery(system);
-		return;
-	}
-
 	int numUpdated = 0;
 
-	pugi::xml_document doc;
-	pugi::xml_node root;
-	std::string xmlReadPath = system->getGamelistPath(false);
-
-	if(Utils::FileSystem::exists(xmlReadPath))
-	{
-		//parse an existing file first
-		pugi::xml_parse_result result = doc.load_file(xmlReadPath.c_str());
-		if(!result)
-			LOG(LogError) << "Error parsing XML file \"" << xmlReadPath << "\"!\n	" << result.description();
-
-		root = doc.child("gameList");
-		if(!root)
-		{
-			LOG(LogError) << "Could not find <gameList> node in gamelist \"" << xmlReadPath << "\"!";
-			root = doc.append_child("gameList");
-		}
-	}
-	else //set up an empty gamelist to append to		
-		root = doc.append_child("gameList");
-
-	std::map<std::string, pugi::xml_node> xmlMap;
-
-	for (pugi::xml_node fileNode : root.children())
-	{
-		pugi::xml_node path = fileNode.child("path");
-		if (path)
-		{
-			std::string nodePath = Utils::FileSystem::getCanonicalPath(Utils::FileSystem::resolveRelativePath(path.text().get(), system->getStartPath(), true));
-			xmlMap[nodePath] = fileNode;
-		}
-	}
-	
-	// iterate through all files, checking if they're already in the XML
-	for(auto file : dirtyFiles)
+	for (auto file : rootFolder->getFilesRecursive(GAME | FOLDER))
 	{
-		bool removed = false;
-
-		// check if the file already exists in the XML
-		// if it does, remove it before adding
-		auto xmf = xmlMap.find(Utils::FileSystem::getCanonicalPath(file->getPath()));
-		if (xmf != xmlMap.cend())
+		if (file->getMetadata().wasChanged())
 		{
-			removed = true;
-			root.remove_child(xmf->second);
+			appendToJournal(file, system);
+			numUpdated++;
 		}
-		
-		const char* tag = (file->getType() == GAME) ? "game" : "folder";
-
-		// it was either removed or never existed to begin with; either way, we can add it now
-		if (addFileDataNode(root, file, tag, system))
-			++numUpdated; // Only if really added
-		else if (removed)
-			++numUpdated; // Only if really removed
 	}
 
-	// Now write the file
-	if (numUpdated > 0) 
-	{
-		//make sure the folders leading up to this path exist (or the write will fail)
-		std::string xmlWritePath(system->getGamelistPath(true));
-		Utils::FileSystem::createDirectory(Utils::FileSystem::getParent(xmlWritePath));
-
-		LOG(LogInfo) << "Added/Updated " << numUpdated << " entities in '" << xmlReadPath << "'";
-
-		if (!doc.save_file(xmlWritePath.c_str()))
-			LOG(LogError) << "Error saving gamelist.xml to \"" << xmlWritePath << "\" (for system " << system->getName() << ")!";
-		else
-			clearTemporaryGamelistRecovery(system);
-	}
-	else
-		clearTemporaryGamelistRecovery(system);
+	if (numUpdated > 0)
+		LOG(LogInfo) << "Added/Updated " << numUpdated << " entities in '" << system->getName() << "' journal";
 }
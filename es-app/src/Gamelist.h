@@ -10,9 +10,10 @@ class FileData;
 // Loads gamelist.xml data into a SystemData.
 void parseGamelist(SystemData* system, std::unordered_map<std::string, FileData*>& fileMap);
 
-// Writes currently loaded metadata for a SystemData to gamelist.xml.
+// Writes currently changed metadata for a SystemData to its journal, merged later into gamelist.xml.
 void updateGamelist(SystemData* system);
 
+// Appends the metadata of a file to the journal of its system. Doesn't block, the record is written by a background thread.
 bool saveToGamelistRecovery(FileData* file);
 bool hasDirtyFile(SystemData* system);
 
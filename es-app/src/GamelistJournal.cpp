@@ -0,0 +1,540 @@
+#include "GamelistJournal.h"
+
+#include "utils/FileSystemUtil.h"
+#include "Log.h"
+#include "SystemData.h"
+#include <pugixml/src/pugixml.hpp>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unordered_map>
+
+#if WIN32
+#include <io.h>
+#else
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#define GAMELIST_JOURNAL_MAGIC		0x4A475345 // "ESGJ"
+#define GAMELIST_JOURNAL_VERSION	1
+
+// Delay without any new record before a journal is compacted into gamelist.xml
+#define GAMELIST_JOURNAL_COMPACT_DELAY	30
+
+struct GamelistJournalHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t xmlSize;		// gamelist.xml the records apply to
+	int64_t  xmlModified;
+};
+
+struct GamelistJournalRecordHeader
+{
+	uint32_t size;
+	uint32_t checksum;
+};
+
+static uint32_t checksum(const char* data, size_t size)
+{
+	uint32_t hash = 2166136261U;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= (unsigned char)data[i];
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+GamelistJournal* GamelistJournal::sInstance = nullptr;
+std::mutex GamelistJournal::sInstanceLock;
+
+GamelistJournal::GamelistJournal() : mWriting(false), mExit(false)
+{
+	mThread = std::thread(&GamelistJournal::threadProc, this);
+}
+
+GamelistJournal::~GamelistJournal()
+{
+	{
+		std::unique_lock<std::mutex> lock(mLock);
+		mExit = true;
+	}
+
+	mEvent.notify_one();
+	mThread.join();
+}
+
+GamelistJournal* GamelistJournal::getInstance()
+{
+	std::unique_lock<std::mutex> lock(sInstanceLock);
+
+	if (sInstance == nullptr)
+		sInstance = new GamelistJournal();
+
+	return sInstance;
+}
+
+void GamelistJournal::deinit()
+{
+	std::unique_lock<std::mutex> lock(sInstanceLock);
+
+	// Pending records are written and merged into gamelist.xml before the thread exits
+	if (sInstance != nullptr)
+	{
+		delete sInstance;
+		sInstance = nullptr;
+	}
+}
+
+GamelistJournal::Target GamelistJournal::getTarget(SystemData* system)
+{
+	Target target;
+	target.journalPath = Utils::FileSystem::getEsConfigPath() + "/recovery/" + system->getName() + ".journal";
+	target.xmlReadPath = system->getGamelistPath(false);
+	target.xmlWritePath = system->getGamelistPath(true);
+	target.startPath = system->getStartPath();
+	return target;
+}
+
+void GamelistJournal::append(SystemData* system, const std::string& node)
+{
+	Record record;
+	record.target = getTarget(system);
+	record.node = node;
+
+	GamelistJournal* instance = getInstance();
+
+	{
+		std::unique_lock<std::mutex> lock(instance->mLock);
+		instance->mQueue.push_back(record);
+	}
+
+	instance->mEvent.notify_one();
+}
+
+void GamelistJournal::flush()
+{
+	GamelistJournal* instance = getInstance();
+
+	std::unique_lock<std::mutex> lock(instance->mLock);
+	instance->mIdle.wait(lock, [instance] { return instance->mQueue.empty() && !instance->mWriting; });
+}
+
+void GamelistJournal::threadProc()
+{
+	std::unique_lock<std::mutex> lock(mLock);
+
+	while (true)
+	{
+		if (mQueue.empty() && !mExit)
+		{
+			if (mPendingCompaction.empty())
+				mEvent.wait(lock);
+			else
+				mEvent.wait_until(lock, mLastWrite + std::chrono::seconds(GAMELIST_JOURNAL_COMPACT_DELAY));
+		}
+
+		if (!mQueue.empty())
+		{
+			std::vector<Record> records;
+			records.swap(mQueue);
+
+			mWriting = true;
+			lock.unlock();
+
+			write(records);
+
+			lock.lock();
+			mWriting = false;
+			mLastWrite = std::chrono::steady_clock::now();
+
+			for (auto& record : records)
+				mPendingCompaction[record.target.journalPath] = record.target;
+
+			mIdle.notify_all();
+			continue;
+		}
+
+		if (mExit && mPendingCompaction.empty())
+			break;
+
+		// At exit, journals are compacted without waiting : gamelist.xml is up to date for whatever runs next
+		if (!mExit && (mPendingCompaction.empty() || std::chrono::steady_clock::now() < mLastWrite + std::chrono::seconds(GAMELIST_JOURNAL_COMPACT_DELAY)))
+			continue;
+
+		// Compaction counts as writing : flush() and replay() wait for it, so they never see a gamelist.xml without its journal
+		auto targets = mPendingCompaction;
+		mPendingCompaction.clear();
+
+		mWriting = true;
+		lock.unlock();
+
+		for (auto& target : targets)
+			compact(target.second);
+
+		lock.lock();
+		mWriting = false;
+		mIdle.notify_all();
+	}
+
+	mIdle.notify_all();
+}
+
+void GamelistJournal::write(const std::vector<Record>& records)
+{
+	std::unordered_map<std::string, FILE*> files;
+
+	for (auto& record : records)
+	{
+		FILE* f = nullptr;
+
+		auto it = files.find(record.target.journalPath);
+		if (it != files.cend())
+			f = it->second;
+		else
+		{
+			bool exists = Utils::FileSystem::exists(record.target.journalPath);
+			if (!exists)
+				Utils::FileSystem::createDirectory(Utils::FileSystem::getParent(record.target.journalPath));
+			else if (mRepaired.find(record.target.journalPath) == mRepaired.cend())
+			{
+				// Left by a previous run : records appended after a torn one could never be read
+				exists = repair(record.target.journalPath, record.target.xmlReadPath);
+			}
+
+			mRepaired.insert(record.target.journalPath);
+
+			f = fopen(record.target.journalPath.c_str(), exists ? "ab" : "wb");
+			if (f == nullptr)
+			{
+				LOG(LogError) << "GamelistJournal::write\tUnable to open " << record.target.journalPath;
+				continue;
+			}
+
+			// A new journal is bound to the current gamelist.xml
+			if (!exists)
+			{
+				GamelistJournalHeader header;
+				header.magic = GAMELIST_JOURNAL_MAGIC;
+				header.version = GAMELIST_JOURNAL_VERSION;
+				header.xmlSize = (uint64_t)Utils::FileSystem::getFileSize(record.target.xmlReadPath);
+				header.xmlModified = (int64_t)Utils::FileSystem::getFileModificationDate(record.target.xmlReadPath).getTime();
+				fwrite(&header, sizeof(header), 1, f);
+			}
+
+			files[record.target.journalPath] = f;
+		}
+
+		GamelistJournalRecordHeader header;
+		header.size = (uint32_t)record.node.size();
+		header.checksum = checksum(record.node.c_str(), record.node.size());
+
+		fwrite(&header, sizeof(header), 1, f);
+		fwrite(record.node.c_str(), 1, record.node.size(), f);
+	}
+
+	for (auto& file : files)
+	{
+		fflush(file.second);
+#if WIN32
+		_commit(_fileno(file.second));
+#else
+		fsync(fileno(file.second));
+#endif
+		fclose(file.second);
+	}
+}
+
+// Copies the elements of a record over an entry of a gamelist.xml changed outside since the record was written :
+// the elements the record doesn't have keep the values set outside
+static void mergeNode(pugi::xml_node& target, const pugi::xml_node& record)
+{
+	for (pugi::xml_node child : record.children())
+	{
+		pugi::xml_node existing = target.child(child.name());
+		if (existing)
+		{
+			target.insert_copy_after(child, existing);
+			target.remove_child(existing);
+		}
+		else
+			target.append_copy(child);
+	}
+}
+
+// A record with a path only removes the entry
+static bool isRemoval(const pugi::xml_node& record)
+{
+	return record.first_child() == record.last_child();
+}
+
+bool GamelistJournal::read(const std::string& journalPath, const std::string& xmlPath, std::vector<std::string>& records, bool& stale, long long* validSize)
+{
+	stale = false;
+
+	if (validSize != nullptr)
+		*validSize = 0;
+
+	FILE* f = fopen(journalPath.c_str(), "rb");
+	if (f == nullptr)
+		return false;
+
+	GamelistJournalHeader header;
+	if (fread(&header, sizeof(header), 1, f) != 1 || header.magic != GAMELIST_JOURNAL_MAGIC || header.version != GAMELIST_JOURNAL_VERSION)
+	{
+		fclose(f);
+		return false;
+	}
+
+	long long size = sizeof(header);
+
+	// gamelist.xml was replaced since the journal was started (edited outside, or scraped by another tool)
+	if (header.xmlSize != (uint64_t)Utils::FileSystem::getFileSize(xmlPath) ||
+		header.xmlModified != (int64_t)Utils::FileSystem::getFileModificationDate(xmlPath).getTime())
+	{
+		LOG(LogWarning) << "GamelistJournal::read\t" << xmlPath << " changed, merging " << journalPath << " into its entries";
+		stale = true;
+	}
+
+	GamelistJournalRecordHeader recordHeader;
+	while (fread(&recordHeader, sizeof(recordHeader), 1, f) == 1)
+	{
+		std::string node(recordHeader.size, '\0');
+		if (recordHeader.size > 0 && fread(&node[0], 1, recordHeader.size, f) != recordHeader.size)
+			break;
+
+		// Torn write of the last record
+		if (checksum(node.c_str(), node.size()) != recordHeader.checksum)
+			break;
+
+		records.push_back(node);
+		size += sizeof(recordHeader) + recordHeader.size;
+	}
+
+	fclose(f);
+
+	if (validSize != nullptr)
+		*validSize = size;
+
+	return true;
+}
+
+bool GamelistJournal::repair(const std::string& journalPath, const std::string& xmlPath)
+{
+	std::vector<std::string> records;
+	bool stale;
+	long long validSize;
+	read(journalPath, xmlPath, records, stale, &validSize);
+
+	long long fileSize = Utils::FileSystem::getFileSize(journalPath);
+	if (validSize > 0 && validSize == fileSize)
+		return true;
+
+	LOG(LogWarning) << "GamelistJournal::repair\tTruncating " << journalPath << " from " << fileSize << " to " << validSize << " bytes";
+
+	FILE* f = fopen(journalPath.c_str(), "r+b");
+	if (f == nullptr)
+		return false;
+
+#if WIN32
+	bool ret = _chsize_s(_fileno(f), validSize) == 0;
+	_commit(_fileno(f));
+#else
+	bool ret = ftruncate(fileno(f), (off_t)validSize) == 0;
+	fsync(fileno(f));
+#endif
+	fclose(f);
+
+	return ret && validSize > 0;
+}
+
+bool GamelistJournal::replay(SystemData* system, const std::function<void(pugi::xml_node&)>& apply)
+{
+	Target target = getTarget(system);
+	if (!Utils::FileSystem::exists(target.journalPath))
+		return false;
+
+	GamelistJournal* instance = getInstance();
+
+	std::vector<std::string> records;
+	bool stale;
+
+	{
+		// Not while a record is written or the journal is compacted
+		std::unique_lock<std::mutex> lock(instance->mLock);
+		instance->mIdle.wait(lock, [instance] { return instance->mQueue.empty() && !instance->mWriting; });
+
+		// The records of this run are appended right after the last valid one
+		if (instance->mRepaired.find(target.journalPath) == instance->mRepaired.cend())
+		{
+			repair(target.journalPath, target.xmlReadPath);
+			instance->mRepaired.insert(target.journalPath);
+		}
+
+		if (!read(target.journalPath, target.xmlReadPath, records, stale))
+		{
+			Utils::FileSystem::removeFile(target.journalPath);
+			return false;
+		}
+
+		if (records.size() > 0)
+		{
+			// Merge it into gamelist.xml later
+			instance->mPendingCompaction[target.journalPath] = target;
+			instance->mLastWrite = std::chrono::steady_clock::now();
+		}
+	}
+
+	instance->mEvent.notify_one();
+
+	// gamelist.xml changed outside : records are applied merged into its current entries, as compact() will write them
+	pugi::xml_document xmlDoc;
+	std::unordered_map<std::string, pugi::xml_node> xmlMap;
+
+	if (stale && records.size() > 0 && xmlDoc.load_file(target.xmlReadPath.c_str()))
+	{
+		for (pugi::xml_node fileNode : xmlDoc.child("gameList").children())
+		{
+			pugi::xml_node path = fileNode.child("path");
+			if (path)
+				xmlMap[Utils::FileSystem::resolveRelativePath(path.text().get(), target.startPath, true)] = fileNode;
+		}
+	}
+
+	for (auto& record : records)
+	{
+		pugi::xml_document doc;
+		if (!doc.load_buffer(record.c_str(), record.size()))
+			continue;
+
+		pugi::xml_node node = doc.first_child();
+
+		if (!xmlMap.empty() && !isRemoval(node))
+		{
+			auto it = xmlMap.find(Utils::FileSystem::resolveRelativePath(node.child("path").text().get(), target.startPath, true));
+			if (it != xmlMap.cend())
+			{
+				pugi::xml_document merged;
+				pugi::xml_node mergedNode = merged.append_copy(it->second);
+				mergeNode(mergedNode, node);
+				apply(mergedNode);
+				continue;
+			}
+		}
+
+		apply(node);
+	}
+
+	return true;
+}
+
+// Replaces gamelist.xml with the temporary file. Both the file and the rename are flushed to the disk,
+// so a power loss can't leave an empty or partial gamelist.xml once the journal is removed
+bool GamelistJournal::syncGamelist(const std::string& tempPath, const std::string& xmlPath)
+{
+	if (!Utils::FileSystem::syncFile(tempPath))
+		return false;
+
+#if WIN32
+	Utils::FileSystem::removeFile(xmlPath);
+#endif
+
+	if (rename(tempPath.c_str(), xmlPath.c_str()) != 0)
+		return false;
+
+	return Utils::FileSystem::syncFile(Utils::FileSystem::getParent(xmlPath));
+}
+
+void GamelistJournal::compact(const Target& target)
+{
+	std::vector<std::string> records;
+	bool stale;
+	if (!read(target.journalPath, target.xmlReadPath, records, stale) || records.size() == 0)
+	{
+		Utils::FileSystem::removeFile(target.journalPath);
+		return;
+	}
+
+	pugi::xml_document doc;
+	pugi::xml_node root;
+
+	if (Utils::FileSystem::exists(target.xmlReadPath))
+	{
+		pugi::xml_parse_result result = doc.load_file(target.xmlReadPath.c_str());
+		if (!result)
+		{
+			// Keep the journal, it is still replayed at load
+			LOG(LogError) << "GamelistJournal::compact\tError parsing XML file \"" << target.xmlReadPath << "\"!\n	" << result.description();
+			return;
+		}
+
+		root = doc.child("gameList");
+	}
+
+	if (!root)
+		root = doc.append_child("gameList");
+
+	// Only the paths are resolved, no canonical path : they are written the same way by the same code
+	std::unordered_map<std::string, pugi::xml_node> xmlMap;
+
+	for (pugi::xml_node fileNode : root.children())
+	{
+		pugi::xml_node path = fileNode.child("path");
+		if (path)
+			xmlMap[Utils::FileSystem::resolveRelativePath(path.text().get(), target.startPath, true)] = fileNode;
+	}
+
+	for (auto& record : records)
+	{
+		pugi::xml_document recordDoc;
+		if (!recordDoc.load_buffer(record.c_str(), record.size()))
+			continue;
+
+		pugi::xml_node node = recordDoc.first_child();
+		std::string path = Utils::FileSystem::resolveRelativePath(node.child("path").text().get(), target.startPath, true);
+
+		auto it = xmlMap.find(path);
+
+		// gamelist.xml changed outside : the entry is updated element by element instead of replaced
+		if (stale && it != xmlMap.cend() && !isRemoval(node))
+		{
+			mergeNode(it->second, node);
+			continue;
+		}
+
+		if (it != xmlMap.cend())
+		{
+			root.remove_child(it->second);
+			xmlMap.erase(it);
+		}
+
+		if (!isRemoval(node))
+			xmlMap[path] = root.append_copy(node);
+	}
+
+	Utils::FileSystem::createDirectory(Utils::FileSystem::getParent(target.xmlWritePath));
+
+	// Written to a temporary file first : if anything fails, the journal is still there
+	std::string tempPath = target.xmlWritePath + ".tmp";
+	if (!doc.save_file(tempPath.c_str()))
+	{
+		LOG(LogError) << "GamelistJournal::compact\tError saving gamelist.xml to \"" << tempPath << "\"";
+		Utils::FileSystem::removeFile(tempPath);
+		return;
+	}
+
+	if (!syncGamelist(tempPath, target.xmlWritePath))
+	{
+		LOG(LogError) << "GamelistJournal::compact\tError saving gamelist.xml to \"" << target.xmlWritePath << "\"";
+		Utils::FileSystem::removeFile(tempPath);
+		return;
+	}
+
+	// The journal goes only once the new gamelist.xml is on the disk
+	Utils::FileSystem::removeFile(target.journalPath);
+
+	LOG(LogInfo) << "GamelistJournal::compact\t" << records.size() << " changes merged into " << target.xmlWritePath;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#ifndef ES_APP_GAMELIST_JOURNAL_H
+#define ES_APP_GAMELIST_JOURNAL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+class SystemData;
+
+namespace pugi { class xml_node; }
+
+//
+// Append-only journal of metadata changes, one file per system in <EsConfigPath>/recovery/<system>.journal.
+// A record is the <game> / <folder> node of a changed entry (a node with a path only removes the entry).
+// Records are written and fsync'ed by a background thread, framed by their size and checksum. A torn write
+// left by a crash is cut from the end of the file before anything is appended to it. The journal is replayed over gamelist.xml at load, and compacted
+// into gamelist.xml by the background thread once no change has been written for a while, and at exit.
+// If gamelist.xml was changed outside ES since the journal was started, records are merged element by element
+// into the current entries instead of replacing them, so neither side is lost.
+//
+class GamelistJournal
+{
+public:
+	static void append(SystemData* system, const std::string& node);
+
+	// Applies the journal of a system, calling 'apply' for each record. Returns false if there is no journal
+	static bool replay(SystemData* system, const std::function<void(pugi::xml_node&)>& apply);
+
+	// Waits until all appended records are written
+	static void flush();
+	static void deinit();
+
+private:
+	struct Target
+	{
+		std::string journalPath;
+		std::string xmlReadPath;
+		std::string xmlWritePath;
+		std::string startPath;
+	};
+
+	struct Record
+	{
+		Target		target;
+		std::string	node;
+	};
+
+	GamelistJournal();
+	~GamelistJournal();
+
+	static GamelistJournal* getInstance();
+	static Target getTarget(SystemData* system);
+
+	void threadProc();
+
+	void write(const std::vector<Record>& records);
+	void compact(const Target& target);
+	// stale is set when gamelist.xml changed since the journal was started.
+	// validSize receives the size of the header and the valid records, 0 if the header itself is invalid
+	static bool read(const std::string& journalPath, const std::string& xmlPath, std::vector<std::string>& records, bool& stale, long long* validSize = nullptr);
+	// Cuts what follows the last valid record. Returns false if there is no valid header, the journal has to be started again
+	static bool repair(const std::string& journalPath, const std::string& xmlPath);
+
+	static bool syncGamelist(const std::string& tempPath, const std::string& xmlPath);
+
+	std::vector<Record>				mQueue;
+	std::map<std::string, Target>	mPendingCompaction;
+	std::set<std::string>			mRepaired; // Journals checked for a torn write since ES started
+	bool							mWriting;
+	bool							mExit;
+	std::chrono::steady_clock::time_point mLastWrite;
+
+	std::mutex						mLock;
+	std::condition_variable			mEvent;
+	std::condition_variable			mIdle;
+	std::thread						mThread;
+
+	static GamelistJournal*			sInstance;
+	static std::mutex				sInstanceLock;
+};
+
+#endif // ES_APP_GAMELIST_JOURNAL_H
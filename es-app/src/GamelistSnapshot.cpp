@@ -0,0 +1,299 @@
+#include "GamelistSnapshot.h"
+
+#include "utils/FileSystemUtil.h"
+#include "MetaData.h"
+#include "Settings.h"
+#include "SystemData.h"
+#include "Log.h"
+#include <unordered_map>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#if WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define GAMELIST_SNAPSHOT_MAGIC		0x4C475345 // "ESGL"
+#define GAMELIST_SNAPSHOT_VERSION	3
+#define GAMELIST_SNAPSHOT_NONE		0xFFFFFFFF
+
+struct GamelistSnapshotHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t xmlSize;
+	int64_t  xmlModified;
+	uint32_t startPath;		// Offset in the string table
+	uint32_t slots;			// Metadata slots per record
+	uint32_t count;			// Records
+	uint32_t stringsSize;
+};
+
+GamelistSnapshot::GamelistSnapshot() : mData(nullptr), mDataSize(0), mMapped(false), mCount(0), mSlots(0), mRecords(nullptr), mStrings(nullptr), mStringsSize(0)
+{
+}
+
+GamelistSnapshot::~GamelistSnapshot()
+{
+	close();
+}
+
+bool GamelistSnapshot::isEnabled()
+{
+	return Settings::getInstance()->getBool("GamelistSnapshot");
+}
+
+std::string GamelistSnapshot::getSnapshotPath(SystemData* system)
+{
+	return Utils::FileSystem::getEsConfigPath() + "/cache/gamelists/" + system->getName() + ".bin";
+}
+
+size_t GamelistSnapshot::getSlotCount()
+{
+	// Records are indexed by metadata id, folder ids are a subset of game ids
+	size_t slots = 0;
+
+	for (auto type : { GAME_METADATA, FOLDER_METADATA })
+		for (auto& mdd : getMDDByType(type))
+			if ((size_t)mdd.id + 1 > slots)
+				slots = (size_t)mdd.id + 1;
+
+	return slots;
+}
+
+bool GamelistSnapshot::open(SystemData* system, const std::string& xmlPath)
+{
+	close();
+
+	std::string path = getSnapshotPath(system);
+
+#if WIN32
+	std::ifstream f(path, std::ios::binary | std::ios::ate);
+	if (f.fail())
+		return false;
+
+	mDataSize = (size_t)f.tellg();
+	if (mDataSize < sizeof(GamelistSnapshotHeader))
+		return false;
+
+	mData = new unsigned char[mDataSize];
+	f.seekg(0);
+	if (!f.read((char*)mData, mDataSize))
+	{
+		close();
+		return false;
+	}
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(GamelistSnapshotHeader))
+	{
+		::close(fd);
+		return false;
+	}
+
+	mDataSize = (size_t)info.st_size;
+
+	void* map = mmap(nullptr, mDataSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+
+	if (map == MAP_FAILED)
+	{
+		mDataSize = 0;
+		return false;
+	}
+
+	mData = (unsigned char*)map;
+	mMapped = true;
+#endif
+
+	GamelistSnapshotHeader header;
+	memcpy(&header, mData, sizeof(header));
+
+	mSlots = header.slots;
+	mCount = header.count;
+	mStringsSize = header.stringsSize;
+
+	size_t recordsSize = (size_t)header.count * (2 + header.slots) * sizeof(uint32_t);
+
+	if (header.magic != GAMELIST_SNAPSHOT_MAGIC || header.version != GAMELIST_SNAPSHOT_VERSION || header.slots != getSlotCount() ||
+		mDataSize != sizeof(header) + recordsSize + header.stringsSize || header.stringsSize == 0 || mData[mDataSize - 1] != 0)
+	{
+		close();
+		return false;
+	}
+
+	mRecords = mData + sizeof(header);
+	mStrings = (const char*)(mRecords + recordsSize);
+
+	// Stale if gamelist.xml was modified since the snapshot was written. Rom folders don't matter :
+	// all the entries are there, the files found by the scan pick theirs whatever folder they are in
+	if (header.xmlSize != (uint64_t)Utils::FileSystem::getFileSize(xmlPath) ||
+		header.xmlModified != (int64_t)Utils::FileSystem::getFileModificationDate(xmlPath).getTime() ||
+		system->getStartPath() != getString(header.startPath))
+	{
+		LOG(LogDebug) << "GamelistSnapshot::open\t" << path << " is out of date";
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void GamelistSnapshot::close()
+{
+	if (mData != nullptr)
+	{
+#if !WIN32
+		if (mMapped)
+			munmap(mData, mDataSize);
+		else
+#endif
+			delete[] mData;
+	}
+
+	mData = nullptr;
+	mDataSize = 0;
+	mMapped = false;
+	mCount = 0;
+	mSlots = 0;
+	mRecords = nullptr;
+	mStrings = nullptr;
+	mStringsSize = 0;
+}
+
+const unsigned int* GamelistSnapshot::getRecord(size_t index) const
+{
+	return (const unsigned int*)(mRecords + index * (2 + mSlots) * sizeof(uint32_t));
+}
+
+const char* GamelistSnapshot::getString(unsigned int offset) const
+{
+	if (offset >= mStringsSize)
+		return "";
+
+	return mStrings + offset;
+}
+
+FileType GamelistSnapshot::getType(size_t index) const
+{
+	return getRecord(index)[0] == FOLDER ? FOLDER : GAME;
+}
+
+std::string GamelistSnapshot::getPath(size_t index) const
+{
+	return getString(getRecord(index)[1]);
+}
+
+MetaDataList GamelistSnapshot::getMetadata(size_t index, SystemData* system) const
+{
+	const unsigned int* record = getRecord(index);
+
+	MetaDataList mdl(record[0] == FOLDER ? FOLDER_METADATA : GAME_METADATA);
+	mdl.mRelativeTo = system;
+
+	const unsigned int* values = record + 2;
+
+	if (values[0] != GAMELIST_SNAPSHOT_NONE)
+		mdl.mName = getString(values[0]);
+
+	// Values were already normalized by createFromXML when the snapshot was written
+	for (auto& mdd : mdl.getMDD())
+		if (mdd.id != 0 && mdd.id < mSlots && values[mdd.id] != GAMELIST_SNAPSHOT_NONE)
+			mdl.setRaw(mdd.id, getString(values[mdd.id]));
+
+	return mdl;
+}
+
+void GamelistSnapshot::save(SystemData* system, const std::string& xmlPath, const std::vector<Entry>& entries)
+{
+	std::string path = getSnapshotPath(system);
+
+	size_t slots = getSlotCount();
+
+	std::vector<uint32_t> records;
+	records.reserve(entries.size() * (2 + slots));
+
+	// Repeated values (developers, genres, ...) share the same string
+	std::string strings;
+	std::unordered_map<std::string, uint32_t> stringIndex;
+
+	auto addString = [&strings, &stringIndex](const std::string& value)
+	{
+		auto it = stringIndex.find(value);
+		if (it != stringIndex.cend())
+			return it->second;
+
+		uint32_t offset = (uint32_t)strings.size();
+		strings.append(value.c_str(), value.size() + 1);
+		stringIndex[value] = offset;
+		return offset;
+	};
+
+	GamelistSnapshotHeader header;
+	header.magic = GAMELIST_SNAPSHOT_MAGIC;
+	header.version = GAMELIST_SNAPSHOT_VERSION;
+	header.xmlSize = (uint64_t)Utils::FileSystem::getFileSize(xmlPath);
+	header.xmlModified = (int64_t)Utils::FileSystem::getFileModificationDate(xmlPath).getTime();
+	header.startPath = addString(system->getStartPath());
+	header.slots = (uint32_t)slots;
+	header.count = (uint32_t)entries.size();
+
+	for (auto& entry : entries)
+	{
+		const MetaDataList& mdl = entry.metadata;
+
+		records.push_back((uint32_t)entry.type);
+		records.push_back(addString(entry.path));
+
+		size_t start = records.size();
+		records.resize(start + slots, GAMELIST_SNAPSHOT_NONE);
+
+		records[start] = addString(mdl.mName);
+
+		for (unsigned char id = 1; id < slots; id++)
+			if (mdl.hasValue(id))
+				records[start + id] = addString(mdl.getRaw(id));
+	}
+
+	header.stringsSize = (uint32_t)strings.size();
+
+	Utils::FileSystem::createDirectory(Utils::FileSystem::getParent(path));
+
+	// Write to a temporary file first so a reader never sees a partial snapshot
+	std::string tempPath = path + ".tmp";
+
+	FILE* f = fopen(tempPath.c_str(), "wb");
+	if (f == nullptr)
+	{
+		LOG(LogWarning) << "GamelistSnapshot::save\tUnable to write " << tempPath;
+		return;
+	}
+
+	bool ok =
+		fwrite(&header, sizeof(header), 1, f) == 1 &&
+		(records.size() == 0 || fwrite(records.data(), sizeof(uint32_t), records.size(), f) == records.size()) &&
+		fwrite(strings.data(), 1, strings.size(), f) == strings.size();
+
+	fclose(f);
+
+	if (ok)
+	{
+#if WIN32
+		Utils::FileSystem::removeFile(path);
+#endif
+		ok = rename(tempPath.c_str(), path.c_str()) == 0;
+	}
+
+	if (!ok)
+		Utils::FileSystem::removeFile(tempPath);
+}
@@ -0,0 +1,65 @@
+#pragma once
+#ifndef ES_APP_GAMELIST_SNAPSHOT_H
+#define ES_APP_GAMELIST_SNAPSHOT_H
+
+#include "FileData.h"
+#include <string>
+#include <vector>
+
+class SystemData;
+
+//
+// Binary copy of a parsed gamelist.xml, stored under <EsConfigPath>/cache/gamelists.
+// The file is a header, fixed-width records (one string index per metadata slot) and a string table.
+// Every entry of gamelist.xml is kept, including the ones whose file is missing when the snapshot is written,
+// so it only depends on gamelist.xml : it is valid while its size & modification date are unchanged.
+// gamelist.xml stays the source of truth, a stale snapshot is ignored and rebuilt from XML
+//
+class GamelistSnapshot
+{
+public:
+	GamelistSnapshot();
+	~GamelistSnapshot();
+
+	struct Entry
+	{
+		Entry(FileType t, const std::string& p, const MetaDataList& m) : type(t), path(p), metadata(m) { }
+
+		FileType		type;
+		std::string		path;
+		MetaDataList	metadata;
+	};
+
+	static bool isEnabled();
+
+	// Maps the snapshot of the system. Returns false if there is none, or if it is stale
+	bool open(SystemData* system, const std::string& xmlPath);
+	void close();
+
+	size_t size() const { return mCount; }
+
+	FileType getType(size_t index) const;
+	std::string getPath(size_t index) const;
+	MetaDataList getMetadata(size_t index, SystemData* system) const;
+
+	static void save(SystemData* system, const std::string& xmlPath, const std::vector<Entry>& entries);
+
+private:
+	static std::string getSnapshotPath(SystemData* system);
+	static size_t getSlotCount();
+
+	const unsigned int* getRecord(size_t index) const;
+	const char* getString(unsigned int offset) const;
+
+	unsigned char*	mData;
+	size_t			mDataSize;
+	bool			mMapped;
+
+	size_t			mCount;
+	size_t			mSlots;
+	const unsigned char* mRecords;
+	const char*		mStrings;
+	size_t			mStringsSize;
+};
+
+#endif // ES_APP_GAMELIST_SNAPSHOT_H
@@ -0,0 +1,109 @@
+#include "LocalArtManifest.h"
+
+#include "utils/FileSystemUtil.h"
+#include "utils/StringUtil.h"
+#include "Log.h"
+#include <SDL_timer.h>
+
+#define MANIFEST_CHECK_DELAY 2 // seconds between two checks of the folder date
+
+static const struct { LocalArtManifest::Media media; const char* suffix; const char* extension; } mediaFiles[] =
+{
+	{ LocalArtManifest::THUMB_PNG,		"-thumb",	".png" },
+	{ LocalArtManifest::THUMB_JPG,		"-thumb",	".jpg" },
+	{ LocalArtManifest::IMAGE_PNG,		"-image",	".png" },
+	{ LocalArtManifest::IMAGE_JPG,		"-image",	".jpg" },
+	{ LocalArtManifest::PLAIN_PNG,		"",			".png" },
+	{ LocalArtManifest::PLAIN_JPG,		"",			".jpg" },
+	{ LocalArtManifest::MARQUEE_PNG,	"-marquee",	".png" },
+	{ LocalArtManifest::MARQUEE_JPG,	"-marquee",	".jpg" },
+	{ LocalArtManifest::VIDEO_MP4,		"-video",	".mp4" }
+};
+
+LocalArtManifest::LocalArtManifest(const std::string& folder) : mFolder(folder), mLoaded(false), mModificationTime(0), mListingTime(0), mLastCheck(0)
+{
+
+}
+
+std::string LocalArtManifest::find(const std::string& name, std::initializer_list<Media> medias)
+{
+	std::unique_lock<std::mutex> lock(mLock);
+
+	refresh();
+
+	auto it = mMedias.find(getKey(name));
+	if (it == mMedias.cend())
+		return "";
+
+	for (auto media : medias)
+		if (it->second & media)
+			return getPath(name, media);
+
+	return "";
+}
+
+std::string LocalArtManifest::getKey(const std::string& name)
+{
+#if defined(_WIN32)
+	return Utils::String::toLower(name);
+#else
+	return name;
+#endif
+}
+
+std::string LocalArtManifest::getPath(const std::string& name, Media media) const
+{
+	for (auto file : mediaFiles)
+		if (file.media == media)
+			return mFolder + "/" + name + file.suffix + file.extension;
+
+	return "";
+}
+
+void LocalArtManifest::refresh()
+{
+	time_t now = time(NULL);
+	if (mLoaded && now - mLastCheck < MANIFEST_CHECK_DELAY)
+		return;
+
+	mLastCheck = now;
+
+	// Adding, removing or renaming a file changes the date of the folder.
+	// The date only has a one second precision : a change made in the second of the listing keeps the same date, so that listing is not trusted
+	time_t modificationTime = Utils::FileSystem::getFileModificationDate(mFolder).getTime();
+	if (mLoaded && modificationTime == mModificationTime && modificationTime < mListingTime)
+		return;
+
+	mModificationTime = modificationTime;
+	mListingTime = now;
+	mLoaded = true;
+
+	load();
+}
+
+void LocalArtManifest::load()
+{
+	int startTime = SDL_GetTicks();
+
+	mMedias.clear();
+
+	for (auto file : Utils::FileSystem::getDirectoryFiles(mFolder))
+	{
+		if (file.directory)
+			continue;
+
+		std::string fileName = getKey(Utils::FileSystem::getFileName(file.path));
+
+		for (auto media : mediaFiles)
+		{
+			std::string suffix = std::string(media.suffix) + media.extension;
+			if (fileName.size() <= suffix.size() || !Utils::String::endsWith(fileName, suffix))
+				continue;
+
+			// "game-thumb.png" is also the plain image of a game named "game-thumb" : every suffix is tried
+			mMedias[fileName.substr(0, fileName.size() - suffix.size())] |= media.media;
+		}
+	}
+
+	LOG(LogDebug) << "LocalArtManifest : " << mMedias.size() << " names in " << mFolder << " listed in " << (SDL_GetTicks() - startTime) << "ms";
+}
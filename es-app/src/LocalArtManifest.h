@@ -0,0 +1,57 @@
+#pragma once
+#ifndef ES_APP_LOCAL_ART_MANIFEST_H
+#define ES_APP_LOCAL_ART_MANIFEST_H
+
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <time.h>
+#include <unordered_map>
+
+//
+// Medias of the "images" folder of a system, for the LocalArt setting.
+// The folder is listed once, then each game name maps to flags telling which "<name><suffix><ext>" files exist :
+// lookups don't stat files anymore. The listing is read again when the modification date of the folder changes.
+// Names are matched without case on Windows, like the file system does
+//
+class LocalArtManifest
+{
+public:
+	enum Media : unsigned int
+	{
+		THUMB_PNG	= 1 << 0,	// <name>-thumb.png
+		THUMB_JPG	= 1 << 1,
+		IMAGE_PNG	= 1 << 2,	// <name>-image.png
+		IMAGE_JPG	= 1 << 3,
+		PLAIN_PNG	= 1 << 4,	// <name>.png
+		PLAIN_JPG	= 1 << 5,
+		MARQUEE_PNG	= 1 << 6,	// <name>-marquee.png
+		MARQUEE_JPG	= 1 << 7,
+		VIDEO_MP4	= 1 << 8	// <name>-video.mp4
+	};
+
+	LocalArtManifest(const std::string& folder);
+
+	// Path of the first media of the list that exists for the game, empty if none
+	std::string find(const std::string& name, std::initializer_list<Media> medias);
+
+private:
+	void refresh();
+	void load();
+
+	std::string getPath(const std::string& name, Media media) const;
+
+	static std::string getKey(const std::string& name);
+
+	std::string		mFolder;
+	std::mutex		mLock;
+
+	bool			mLoaded;
+	time_t			mModificationTime;
+	time_t			mListingTime;
+	time_t			mLastCheck;
+
+	std::unordered_map<std::string, unsigned int> mMedias;
+};
+
+#endif // ES_APP_LOCAL_ART_MANIFEST_H
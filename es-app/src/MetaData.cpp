@@ -7,19 +7,37 @@
 #include "SystemData.h"
 #include "LocaleES.h"
 #include "Settings.h"
+#include <mutex>
+#include <string.h>
+#include <unordered_set>
 
 static std::vector<MetaDataDecl> gameMDD;
 static std::vector<MetaDataDecl> folderMDD;
 
-static std::string mDefaultGameMap[22];
-static std::string mDefaultFolderMap[14];
+static std::string mDefaultGameMap[MetaDataId::Max];
+static std::string mDefaultFolderMap[MetaDataId::Max];
 
-static MetaDataType mGameTypeMap[22];
-static MetaDataType mFolderTypeMap[14];
+static MetaDataType mGameTypeMap[MetaDataId::Max];
+static MetaDataType mFolderTypeMap[MetaDataId::Max];
 
 static std::map<std::string, unsigned char> mGameIdMap;
 static std::map<std::string, unsigned char> mFolderIdMap;
 
+// Interned values are never released : they only come from a small set of distinct genres, developers...
+static std::unordered_set<std::string> mInternedStrings;
+static std::mutex mInternedStringsLock;
+
+static const std::string* internString(const std::string& value)
+{
+	std::unique_lock<std::mutex> lock(mInternedStringsLock);
+	return &(*mInternedStrings.insert(value).first);
+}
+
+static bool isInterned(unsigned char id)
+{
+	return id == MetaDataId::Developer || id == MetaDataId::Publisher || id == MetaDataId::Genre || id == MetaDataId::ArcadeSystemName;
+}
+
 void MetaDataList::initMetadata()
 {
 	//								id,   key,         type,                   default,            statistic,          name in GuiMetaDataEd,          prompt in GuiMetaDataEd
@@ -50,16 +68,16 @@ void MetaDataList::initMetadata()
 	//  folderMDD.push_back(MetaDataDecl(1, "sortname",	MD_STRING,		"", 		false, _("sortname"),    _("enter game sort name")));
 	folderMDD.push_back(MetaDataDecl(2, "desc", MD_MULTILINE_STRING, "", false, _("description"), _("enter description")));
 	folderMDD.push_back(MetaDataDecl(3, "image", MD_PATH, "", false, _("image"), _("enter path to image")));
-	folderMDD.push_back(MetaDataDecl(4, "thumbnail", MD_PATH, "", false, _("thumbnail"), _("enter path to thumbnail")));
-	folderMDD.push_back(MetaDataDecl(5, "video", MD_PATH, "", false, _("video"), _("enter path to video")));
-	folderMDD.push_back(MetaDataDecl(6, "marquee", MD_PATH, "", false, _("marquee"), _("enter path to marquee")));
+	folderMDD.push_back(MetaDataDecl(6, "thumbnail", MD_PATH, "", false, _("thumbnail"), _("enter path to thumbnail")));
+	folderMDD.push_back(MetaDataDecl(4, "video", MD_PATH, "", false, _("video"), _("enter path to video")));
+	folderMDD.push_back(MetaDataDecl(5, "marquee", MD_PATH, "", false, _("marquee"), _("enter path to marquee")));
 	folderMDD.push_back(MetaDataDecl(7, "rating", MD_RATING, "0.000000", false, _("Rating"), _("enter rating")));
 	folderMDD.push_back(MetaDataDecl(8, "releasedate", MD_DATE, "not-a-date-time", false, _("Release date"), _("enter release date")));
 	folderMDD.push_back(MetaDataDecl(9, "developer", MD_STRING, "", false, _("Developer"), _("enter game developer")));
 	folderMDD.push_back(MetaDataDecl(10, "publisher", MD_STRING, "", false, _("Publisher"), _("enter game publisher")));
 	folderMDD.push_back(MetaDataDecl(11, "genre", MD_STRING, "", false, _("Genre"), _("enter game genre")));
 	folderMDD.push_back(MetaDataDecl(12, "players", MD_INT, "1", false, _("Players"), _("enter number of players")));
-	folderMDD.push_back(MetaDataDecl(13, "hidden", MD_BOOL, "false", false, _("Hidden"), _("set hidden")));
+	folderMDD.push_back(MetaDataDecl(14, "hidden", MD_BOOL, "false", false, _("Hidden"), _("set hidden")));
 
 	// Build Game maps
 	{
@@ -91,7 +109,13 @@ MetaDataType MetaDataList::getType(unsigned char id) const
 
 unsigned char MetaDataList::getId(const std::string& key) const
 {
-	return mType == GAME_METADATA ? mGameIdMap[key] : mFolderIdMap[key];
+	auto& map = mType == GAME_METADATA ? mGameIdMap : mFolderIdMap;
+
+	auto it = map.find(key);
+	if (it == map.cend())
+		return MetaDataId::Invalid;
+
+	return it->second;
 }
 
 const std::vector<MetaDataDecl>& getMDDByType(MetaDataListType type)
@@ -101,7 +125,158 @@ const std::vector<MetaDataDecl>& getMDDByType(MetaDataListType type)
 
 MetaDataList::MetaDataList(MetaDataListType type) : mType(type), mWasChanged(false), mRelativeTo(nullptr)
 {
+	memset(mKinds, SLOT_NONE, sizeof(mKinds));
+}
+
+MetaDataList::MetaDataList(const MetaDataList& other) : mName(other.mName), mType(other.mType), mWasChanged(other.mWasChanged), mRelativeTo(other.mRelativeTo)
+{
+	memset(mKinds, SLOT_NONE, sizeof(mKinds));
+	copySlots(other);
+}
+
+MetaDataList::MetaDataList(MetaDataList&& other) : mName(std::move(other.mName)), mType(other.mType), mWasChanged(other.mWasChanged), mRelativeTo(other.mRelativeTo)
+{
+	// Owned strings are taken over
+	memcpy(mKinds, other.mKinds, sizeof(mKinds));
+	memcpy(mSlots, other.mSlots, sizeof(mSlots));
+	memset(other.mKinds, SLOT_NONE, sizeof(other.mKinds));
+}
+
+MetaDataList::~MetaDataList()
+{
+	for (unsigned char id = 0; id < MetaDataId::Max; id++)
+		clearSlot(id);
+}
+
+MetaDataList& MetaDataList::operator=(const MetaDataList& other)
+{
+	if (this == &other)
+		return *this;
+
+	mName = other.mName;
+	mType = other.mType;
+	mWasChanged = other.mWasChanged;
+	mRelativeTo = other.mRelativeTo;
+	copySlots(other);
+	return *this;
+}
+
+MetaDataList& MetaDataList::operator=(MetaDataList&& other)
+{
+	if (this == &other)
+		return *this;
+
+	for (unsigned char id = 0; id < MetaDataId::Max; id++)
+		clearSlot(id);
+
+	mName = std::move(other.mName);
+	mType = other.mType;
+	mWasChanged = other.mWasChanged;
+	mRelativeTo = other.mRelativeTo;
+
+	memcpy(mKinds, other.mKinds, sizeof(mKinds));
+	memcpy(mSlots, other.mSlots, sizeof(mSlots));
+	memset(other.mKinds, SLOT_NONE, sizeof(other.mKinds));
+	return *this;
+}
+
+void MetaDataList::copySlots(const MetaDataList& other)
+{
+	for (unsigned char id = 0; id < MetaDataId::Max; id++)
+	{
+		clearSlot(id);
+
+		mKinds[id] = other.mKinds[id];
+		if (mKinds[id] == SLOT_STRING)
+			mSlots[id].str = new std::string(*other.mSlots[id].str);
+		else
+			mSlots[id] = other.mSlots[id];
+	}
+}
+
+void MetaDataList::clearSlot(unsigned char id)
+{
+	if (mKinds[id] == SLOT_STRING)
+		delete mSlots[id].str;
 
+	mKinds[id] = SLOT_NONE;
+}
+
+std::string MetaDataList::getRaw(unsigned char id) const
+{
+	switch (mKinds[id])
+	{
+	case SLOT_STRING:
+		return *mSlots[id].str;
+	case SLOT_INTERNED:
+		return *mSlots[id].interned;
+	case SLOT_BOOL:
+		return mSlots[id].boolValue ? "true" : "false";
+	case SLOT_INT:
+		return std::to_string(mSlots[id].intValue);
+	case SLOT_FLOAT:
+		return std::to_string(mSlots[id].floatValue);
+	default:
+		break;
+	}
+
+	return mType == GAME_METADATA ? mDefaultGameMap[id] : mDefaultFolderMap[id];
+}
+
+void MetaDataList::setRaw(unsigned char id, const std::string& value)
+{
+	clearSlot(id);
+
+	switch (getType(id))
+	{
+	case MD_BOOL:
+		if (value == "true" || value == "false")
+		{
+			mKinds[id] = SLOT_BOOL;
+			mSlots[id].boolValue = (value == "true");
+			return;
+		}
+		break;
+
+	case MD_INT:
+		{
+			int intValue = atoi(value.c_str());
+			if (std::to_string(intValue) == value)
+			{
+				mKinds[id] = SLOT_INT;
+				mSlots[id].intValue = intValue;
+				return;
+			}
+		}
+		break;
+
+	case MD_FLOAT:
+	case MD_RATING:
+		{
+			float floatValue = (float)atof(value.c_str());
+			if (std::to_string(floatValue) == value)
+			{
+				mKinds[id] = SLOT_FLOAT;
+				mSlots[id].floatValue = floatValue;
+				return;
+			}
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	if (isInterned(id))
+	{
+		mKinds[id] = SLOT_INTERNED;
+		mSlots[id].interned = internString(value);
+	}
+	else
+	{
+		mKinds[id] = SLOT_STRING;
+		mSlots[id].str = new std::string(value);
+	}
 }
 
 
@@ -157,16 +332,15 @@ void MetaDataList::appendToXML(pugi::xml_node& parent, bool ignoreDefaults, cons
 			continue;
 		}
 
-		auto mapIter = mMap.find(mddIter->id);
-		if(mapIter != mMap.cend())
+		if(hasValue(mddIter->id))
 		{
 			// we have this value!
 			// if it's just the default (and we ignore defaults), don't write it
-			if(ignoreDefaults && mapIter->second == mddIter->defaultValue)
+			std::string value = getRaw(mddIter->id);
+			if(ignoreDefaults && value == mddIter->defaultValue)
 				continue;
 			
 			// try and make paths relative if we can
-			std::string value = mapIter->second;
 			if (mddIter->type == MD_PATH)
 				value = Utils::FileSystem::createRelativePath(value, relativeTo, true);
 
@@ -183,6 +357,14 @@ const std::string& MetaDataList::getName() const
 void MetaDataList::set(const std::string& key, const std::string& value)
 {
 	if (key == "name")
+		set(MetaDataId::Name, value);
+	else
+		set((MetaDataId::Ids) getId(key), value);
+}
+
+void MetaDataList::set(MetaDataId::Ids id, const std::string& value)
+{
+	if (id == MetaDataId::Name)
 	{
 		if (mName == value)
 			return;
@@ -191,20 +373,20 @@ void MetaDataList::set(const std::string& key, const std::string& value)
 	}
 	else
 	{
-		auto id = getId(key);
-		
+		if (id >= MetaDataId::Max)
+			return;
+
 		// Players -> remove "1-"
-		if (mType == GAME_METADATA && id == 12 && Utils::String::startsWith(value, "1-")) // "players"
+		if (mType == GAME_METADATA && id == MetaDataId::Players && Utils::String::startsWith(value, "1-")) // "players"
 		{
-			mMap[id] = Utils::String::replace(value, "1-", "");
+			setRaw(id, Utils::String::replace(value, "1-", ""));
 			return;
 		}
 
-		auto prev = mMap.find(id);
-		if (prev != mMap.cend() && prev->second == value)
+		if (hasValue(id) && getRaw(id) == value)
 			return;
 
-		mMap[id] = value;
+		setRaw(id, value);
 	}
 
 	mWasChanged = true;
@@ -215,31 +397,55 @@ const std::string MetaDataList::get(const std::string& key) const
 	if (key == "name")
 		return mName;
 
-	auto id = getId(key);
+	return get((MetaDataId::Ids) getId(key));
+}
 
-	auto it = mMap.find(id);
-	if (it != mMap.end())
-	{
-		if (getType(id) == MD_PATH && mRelativeTo != nullptr) // if it's a path, resolve relative paths				
-			return Utils::FileSystem::resolveRelativePath(it->second, mRelativeTo->getStartPath(), true);
+const std::string MetaDataList::get(MetaDataId::Ids id) const
+{
+	if (id == MetaDataId::Name)
+		return mName;
 
-		return it->second;
-	}
+	if (id >= MetaDataId::Max)
+		return "";
 
-	if (mType == GAME_METADATA)
-		return mDefaultGameMap[id];
+	if (mKinds[id] == SLOT_STRING && getType(id) == MD_PATH && mRelativeTo != nullptr) // if it's a path, resolve relative paths
+		return Utils::FileSystem::resolveRelativePath(*mSlots[id].str, mRelativeTo->getStartPath(), true);
 
-	return mDefaultFolderMap[id];
+	return getRaw(id);
 }
 
 int MetaDataList::getInt(const std::string& key) const
 {
-	return atoi(get(key).c_str());
+	return getInt((MetaDataId::Ids) getId(key));
 }
 
 float MetaDataList::getFloat(const std::string& key) const
 {
-	return (float)atof(get(key).c_str());
+	return getFloat((MetaDataId::Ids) getId(key));
+}
+
+bool MetaDataList::getBool(MetaDataId::Ids id) const
+{
+	if (id < MetaDataId::Max && mKinds[id] == SLOT_BOOL)
+		return mSlots[id].boolValue;
+
+	return get(id) == "true";
+}
+
+int MetaDataList::getInt(MetaDataId::Ids id) const
+{
+	if (id < MetaDataId::Max && mKinds[id] == SLOT_INT)
+		return mSlots[id].intValue;
+
+	return atoi(get(id).c_str());
+}
+
+float MetaDataList::getFloat(MetaDataId::Ids id) const
+{
+	if (id < MetaDataId::Max && mKinds[id] == SLOT_FLOAT)
+		return mSlots[id].floatValue;
+
+	return (float)atof(get(id).c_str());
 }
 
 bool MetaDataList::wasChanged() const
@@ -5,6 +5,7 @@
 #include <map>
 #include <vector>
 #include <functional>
+#include <string>
 
 class SystemData;
 
@@ -39,6 +40,38 @@ namespace MetaDataImportType
 	};
 }
 
+// Metadata ids, shared by game and folder metadata. They index the value slots of MetaDataList
+namespace MetaDataId
+{
+	enum Ids : unsigned char
+	{
+		Name = 0,
+		Desc = 2,
+		Image = 3,
+		Video = 4,
+		Marquee = 5,
+		Thumbnail = 6,
+		Rating = 7,
+		ReleaseDate = 8,
+		Developer = 9,
+		Publisher = 10,
+		Genre = 11,
+		Players = 12,
+		Favorite = 13,
+		Hidden = 14,
+		KidGame = 15,
+		PlayCount = 16,
+		LastPlayed = 17,
+		Crc32 = 18,
+		Md5 = 19,
+		GameTime = 20,
+		ArcadeSystemName = 21,
+
+		Max = 22,
+		Invalid = 0xFF
+	};
+}
+
 struct MetaDataDecl
 {
 	unsigned char id;
@@ -90,13 +123,26 @@ public:
 	void appendToXML(pugi::xml_node& parent, bool ignoreDefaults, const std::string& relativeTo) const;
 
 	MetaDataList(MetaDataListType type);
+	MetaDataList(const MetaDataList& other);
+	MetaDataList(MetaDataList&& other);
+	~MetaDataList();
+
+	MetaDataList& operator=(const MetaDataList& other);
+	MetaDataList& operator=(MetaDataList&& other);
 	
 	void set(const std::string& key, const std::string& value);
+	void set(MetaDataId::Ids id, const std::string& value);
 
 	const std::string get(const std::string& key) const;
+	const std::string get(MetaDataId::Ids id) const;
 	int getInt(const std::string& key) const;
 	float getFloat(const std::string& key) const;
 
+	// Typed accessors : no key lookup, and no string conversion for values stored as bool/int/float
+	bool getBool(MetaDataId::Ids id) const;
+	int getInt(MetaDataId::Ids id) const;
+	float getFloat(MetaDataId::Ids id) const;
+
 	bool wasChanged() const;
 	void resetChangedFlag();
 	const void setDirty() 
@@ -112,14 +158,48 @@ public:
 	void importScrappedMetadata(const MetaDataList& source);
 
 private:
+	friend class GamelistSnapshot;
+
+	// How a value slot is stored. bool/int/float values are only stored typed when converting them back
+	// gives the exact same string, so the XML output never changes. Values shared by many games (genre,
+	// developer...) point to a global pool of interned strings
+	enum SlotKind : unsigned char
+	{
+		SLOT_NONE,
+		SLOT_STRING,
+		SLOT_INTERNED,
+		SLOT_BOOL,
+		SLOT_INT,
+		SLOT_FLOAT
+	};
+
+	union Slot
+	{
+		std::string*		str;
+		const std::string*	interned;
+		bool				boolValue;
+		int					intValue;
+		float				floatValue;
+	};
+
 	std::string		mName;
 	MetaDataListType mType;
-	std::map<unsigned char, std::string> mMap;
 	bool mWasChanged;
 	SystemData*		mRelativeTo;
 
+	unsigned char	mKinds[MetaDataId::Max];
+	Slot			mSlots[MetaDataId::Max];
+
 	inline MetaDataType getType(unsigned char id) const;
 	inline unsigned char getId(const std::string& key) const;
+
+	// Stored value, default value if not set. Paths are not resolved
+	std::string getRaw(unsigned char id) const;
+	void setRaw(unsigned char id, const std::string& value);
+	void clearSlot(unsigned char id);
+	void copySlots(const MetaDataList& other);
+
+	bool hasValue(unsigned char id) const { return id < MetaDataId::Max && mKinds[id] != SLOT_NONE; }
 };
 
 #endif // ES_APP_META_DATA_H
@@ -7,6 +7,7 @@
 #include "FileFilterIndex.h"
 #include "FileSorts.h"
 #include "Gamelist.h"
+#include "GamelistJournal.h"
 #include "Log.h"
 #include "platform.h"
 #include "Settings.h"
@@ -19,6 +20,7 @@
 #include "views/ViewController.h"
 #include "ThreadedHasher.h"
 #include <unordered_set>
+#include <chrono>
 
 using namespace Utils;
 
@@ -50,7 +52,13 @@ SystemData::SystemData(const std::string& name, const std::string& fullName, Sys
 
 		if (!Settings::getInstance()->getBool("ParseGamelistOnly"))
 		{
+			auto startTime = std::chrono::steady_clock::now();
+
 			populateFolder(mRootFolder, fileMap);
+
+			LOG(LogDebug) << "SystemData::populateFolder " << mName << " : " << fileMap.size() << " entries in " <<
+				std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count() << "ms";
+
 			if (mRootFolder->getChildren().size() == 0)
 				return;
 		}
@@ -113,6 +121,8 @@ void SystemData::populateFolder(FolderData* folder, std::unordered_map<std::stri
 	bool isGame;
 	bool showHidden = Settings::getInstance()->getBool("ShowHiddenFiles");
 
+	std::vector<FolderData*> subFolders;
+
 	Utils::FileSystem::fileList dirContent = Utils::FileSystem::getDirectoryFiles(folderPath);
 	for (auto fileInfo : dirContent)
 	{
@@ -163,22 +173,51 @@ void SystemData::populateFolder(FolderData* folder, std::unordered_map<std::stri
 
 				continue;
 
-			FolderData* newFolder = new FolderData(filePath, this);
-			populateFolder(newFolder, fileMap);
+			subFolders.push_back(new FolderData(filePath, this));
+		}
+	}
 
-			//ignore folders that do not contain games
-			if(newFolder->getChildren().size() == 0)
-				delete newFolder;
-			else 
-			{
-				const std::string& key = newFolder->getPath();
-				if (fileMap.find(key) == fileMap.end())
-				{
-					folder->addChild(newFolder);
-					fileMap[key] = newFolder;
-				}
-			}
+	if (subFolders.size() == 0)
+		return;
+
+	// When running inside the loading thread pool, sub folders are scanned as separate work items.
+	// Each one fills its own file map, merged below in directory order so the tree stays the same as a serial scan
+	Utils::ThreadPool* pool = subFolders.size() > 1 ? Utils::ThreadPool::getCurrent() : nullptr;
+
+	std::vector<std::unordered_map<std::string, FileData*>> subFolderMaps(pool != nullptr ? subFolders.size() : 0);
+
+	Utils::TaskGroup tasks(pool);
+
+	for (size_t i = 0; i < subFolders.size(); i++)
+	{
+		FolderData* newFolder = subFolders[i];
+		std::unordered_map<std::string, FileData*>* newFolderMap = (pool != nullptr ? &subFolderMaps[i] : &fileMap);
+
+		tasks.run([this, newFolder, newFolderMap] { populateFolder(newFolder, *newFolderMap); });
+	}
+
+	tasks.wait();
+
+	for (size_t i = 0; i < subFolders.size(); i++)
+	{
+		FolderData* newFolder = subFolders[i];
+
+		//ignore folders that do not contain games
+		if (newFolder->getChildren().size() == 0)
+		{
+			delete newFolder;
+			continue;
 		}
+
+		const std::string& key = newFolder->getPath();
+		if (fileMap.find(key) != fileMap.end())
+			continue;
+
+		folder->addChild(newFolder);
+		fileMap[key] = newFolder;
+
+		if (pool != nullptr)
+			fileMap.insert(subFolderMaps[i].cbegin(), subFolderMaps[i].cend());
 	}
 }
 
@@ -646,6 +685,9 @@ void SystemData::deleteSystems()
 	}
 
 	sSystemVector.clear();
+
+	if (saveOnExit)
+		GamelistJournal::flush();
 }
 
 std::string SystemData::getConfigPath(bool forWrite)
@@ -18,6 +18,7 @@ class FileData;
 class FolderData;
 class ThemeData;
 class Window;
+class LocalArtManifest;
 
 struct CoreData
 {
@@ -41,6 +42,9 @@ struct SystemEnvironmentData
 	std::vector<PlatformIds::PlatformId> mPlatformIds;
 	std::string mGroup;
 
+	// Files of <mStartPath>/images, listed on the first LocalArt lookup
+	std::shared_ptr<LocalArtManifest> mLocalArt;
+
 	bool isValidExtension(const std::string extension)
 	{
 		return std::find(mSearchExtensions.cbegin(), mSearchExtensions.cend(), extension) != mSearchExtensions.cend();
@@ -37,7 +37,8 @@ SystemScreenSaver::SystemScreenSaver(Window* window) :
 	mSystemName(""),
 	mGameName(""),
 	mCurrentGame(NULL),
-	mLoadingNext(false)
+	mLoadingNext(false),
+	mNextGame(NULL)
 {
 
 	mWindow->setScreenSaver(this);
@@ -92,8 +93,20 @@ void SystemScreenSaver::startScreenSaver()
 		else
 			mOpacity = 0.0f;
 			
-		// Load a random video
-		std::string path = pickRandomVideo();
+		// Load a random video, or the one opened ahead of time
+		std::string path;
+		if (loadingNext && !mNextVideoPath.empty() && Utils::FileSystem::exists(mNextVideoPath))
+		{
+			path = mNextVideoPath;
+			mCurrentGame = mNextGame;
+			mSystemName = mNextSystemName;
+			mGameName = mNextGameName;
+		}
+		else
+			path = pickRandomVideo();
+
+		mNextVideoPath = "";
+		mNextGame = nullptr;
 
 		int retry = 10;
 		while (retry > 0 && !Utils::FileSystem::exists(path))
@@ -110,6 +123,8 @@ void SystemScreenSaver::startScreenSaver()
 			mVideoScreensaver->setGame(mCurrentGame);
 			mVideoScreensaver->setVideo(path);
 
+			preloadNextVideo();
+
 			PowerSaver::runningScreenSaver(true);
 			mTimer = 0;
 			return;
@@ -175,6 +190,13 @@ void SystemScreenSaver::stopScreenSaver()
 	// so that we stop the background audio next time, unless we're restarting the screensaver
 	mLoadingNext = false;
 
+	if (isExitingScreenSaver && !mNextVideoPath.empty())
+	{
+		VideoVlcComponent::cancelPreload(mNextVideoPath);
+		mNextVideoPath = "";
+		mNextGame = nullptr;
+	}
+
 	mVideoScreensaver = nullptr;
 	mImageScreensaver = nullptr;
 
@@ -355,6 +377,32 @@ std::string SystemScreenSaver::pickRandomVideo()
 	return pickGameListNode(video, "video");
 }
 
+// Picks the video following the current one, and lets the video component open it while this one plays
+void SystemScreenSaver::preloadNextVideo()
+{
+#ifdef _RPI_
+	if (Settings::getInstance()->getBool("ScreenSaverOmxPlayer"))
+		return;
+#endif
+
+	// Picking sets the current game & names
+	FileData* currentGame = mCurrentGame;
+	std::string systemName = mSystemName;
+	std::string gameName = mGameName;
+
+	mNextVideoPath = pickRandomVideo();
+	mNextGame = mCurrentGame;
+	mNextSystemName = mSystemName;
+	mNextGameName = mGameName;
+
+	mCurrentGame = currentGame;
+	mSystemName = systemName;
+	mGameName = gameName;
+
+	if (!mNextVideoPath.empty())
+		VideoVlcComponent::preloadVideo(mNextVideoPath, Vector2f((float)Renderer::getScreenWidth(), (float)Renderer::getScreenHeight()));
+}
+
 std::string SystemScreenSaver::pickRandomGameListImage()
 {
 	countImages();
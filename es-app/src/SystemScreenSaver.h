@@ -91,6 +91,7 @@ private:
 
 	std::string pickGameListNode(unsigned long index, const char *nodeName);
 	std::string pickRandomVideo();
+	void preloadNextVideo();
 	std::string pickRandomGameListImage();
 	std::string pickRandomCustomImage();
 
@@ -125,6 +126,12 @@ private:
 	//std::shared_ptr<Sound>	mBackgroundAudio;
 	bool			mLoadingNext;
 
+	// Next random video, opened while the current one plays
+	std::string		mNextVideoPath;
+	FileData*		mNextGame;
+	std::string		mNextGameName;
+	std::string		mNextSystemName;
+
 };
 
 #endif // ES_APP_SYSTEM_SCREEN_SAVER_H
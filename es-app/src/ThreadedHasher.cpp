@@ -5,22 +5,88 @@
 #include "LocaleES.h"
 #include "guis/GuiMsgBox.h"
 #include "Gamelist.h"
+#include "Log.h"
 
 #include "SystemConf.h"
 #include "SystemData.h"
 #include "FileData.h"
+#include <algorithm>
 #include <unordered_set>
 #include <queue>
+#include <sys/stat.h>
 #include "ApiSystem.h"
+#include "utils/FileSystemUtil.h"
+#include "utils/HashUtil.h"
 #include "utils/StringUtil.h"
 
+#if defined(__linux__)
+#include <sys/statfs.h>
+#include <sys/sysmacros.h>
+#endif
+
 #define ICONINDEX _U("\uF1EC ")
 
 ThreadedHasher* ThreadedHasher::mInstance = nullptr;
 bool ThreadedHasher::mPaused = false;
+std::mutex ThreadedHasher::mPauseLock;
+std::condition_variable ThreadedHasher::mPauseChanged;
+
+static std::string getHashIndexPath()
+{
+	return Utils::FileSystem::getEsConfigPath() + "/hashes.cache";
+}
+
+// Number of files read at the same time on the device holding 'path'
+static int getStorageConcurrency(const std::string& path, unsigned long long& device)
+{
+	device = 0;
+
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0)
+		return 2;
+
+	device = (unsigned long long)info.st_dev;
+
+#if defined(__linux__)
+	// Network shares : latency bound, several requests in flight hide it
+	struct statfs fs;
+	if (statfs(path.c_str(), &fs) == 0)
+	{
+		switch ((unsigned int)fs.f_type)
+		{
+		case 0x6969:		// nfs
+		case 0xFF534D42:	// cifs
+		case 0xFE534D42:	// smb2
+		case 0x517B:		// smb
+		case 0x65735546:	// fuse (sshfs...)
+			return 4;
+		}
+	}
+
+	// Sd cards and emmc : a small queue is enough to keep them busy
+	if (major(info.st_dev) == 179)
+		return 2;
+
+	// Spinning disks : parallel reads only add seeks
+	char sysPath[64];
+	snprintf(sysPath, sizeof(sysPath), "/sys/dev/block/%u:%u", major(info.st_dev), minor(info.st_dev));
+
+	std::string queuePath = sysPath;
+	if (Utils::FileSystem::exists(queuePath + "/partition"))
+		queuePath += "/..";
+
+	if (Utils::String::trim(Utils::FileSystem::readAllText(queuePath + "/queue/rotational")) == "1")
+		return 1;
+
+	// Ssd
+	return 4;
+#else
+	return 2;
+#endif
+}
 
 ThreadedHasher::ThreadedHasher(Window* window, std::queue<FileData*> searchQueue)
-	: mWindow(window)
+	: mWindow(window), mLastFile(nullptr), mRunningWorkers(0), mProcessed(0), mBytes(0)
 {
 	mExit = false;
 
@@ -47,45 +113,146 @@ std::string ThreadedHasher::formatGameName(FileData* game)
 	return "[" + game->getSystemName() + "] " + game->getName();
 }
 
-void ThreadedHasher::hashFile(FileData* fileData)
+void ThreadedHasher::hashFiles(DeviceQueue* device)
 {
-	std::string systemName = fileData->getSystemName();
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mPauseLock);
+			mPauseChanged.wait(lock, [this] { return !mPaused || mExit; });
+		}
+
+		FileData* fileData = nullptr;
+
+		{
+			std::unique_lock<std::mutex> lock(mLock);
+			if (mExit || device->files.empty())
+				break;
+
+			fileData = device->files.front();
+			device->files.pop();
+		}
+
+		// Files unchanged since they were last hashed come from the hash index, without being read
+		long long bytesRead = 0;
+		auto crc = ApiSystem::getInstance()->getCRC32(fileData->getPath(), !fileData->isArcadeAsset(), &bytesRead);
 
-	std::string idx = std::to_string(mTotal + 1 - mSearchQueue.size()) + "/" + std::to_string(mTotal);
-	int percent = 100 - (mSearchQueue.size() * 100 / mTotal);
+		// Only the bytes actually hashed count in the throughput
+		mBytes += bytesRead;
+		mProcessed++;
 
-	
-	mWndNotification->updateText(formatGameName(fileData));
-	mWndNotification->updatePercent(percent);
+		std::unique_lock<std::mutex> lock(mLock);
+		mLastFile = fileData;
+
+		if (!crc.empty())
+			mResults.push_back(std::make_pair(fileData, Utils::String::toUpper(crc)));
+	}
+
+	std::unique_lock<std::mutex> lock(mLock);
+	mRunningWorkers--;
+	mWorkerDone.notify_one();
+}
+
+void ThreadedHasher::saveResults()
+{
+	std::vector<std::pair<FileData*, std::string>> results;
+	FileData* lastFile;
 
-	auto crc = ApiSystem::getInstance()->getCRC32(fileData->getPath(), !fileData->isArcadeAsset());
-	if (!crc.empty())
 	{
-		fileData->setMetadata("crc32", Utils::String::toUpper(crc));
+		std::unique_lock<std::mutex> lock(mLock);
+		results.swap(mResults);
+		lastFile = mLastFile;
+	}
+
+	for (auto& result : results)
+	{
+		result.first->setMetadata("crc32", result.second);
 
 #ifndef _DEBUG
-		saveToGamelistRecovery(fileData);
+		saveToGamelistRecovery(result.first);
 #endif
 	}
+
+	if (lastFile != nullptr && mTotal > 0)
+	{
+		mWndNotification->updateText(formatGameName(lastFile));
+		mWndNotification->updatePercent(mProcessed * 100 / mTotal);
+	}
 }
 
 void ThreadedHasher::run()
 {
-	while (!mExit && !mSearchQueue.empty())
+	auto startTime = std::chrono::steady_clock::now();
+
+	Utils::Hash::loadCache(getHashIndexPath());
+
+	// One queue per storage device, each with the number of workers the device can serve
+	std::map<SystemData*, unsigned long long> systemDevices;
+
+	while (!mSearchQueue.empty())
+	{
+		FileData* file = mSearchQueue.front();
+		mSearchQueue.pop();
+
+		SystemData* system = file->getSourceFileData()->getSystem();
+
+		auto it = systemDevices.find(system);
+		if (it == systemDevices.cend())
+		{
+			unsigned long long device;
+			int concurrency = getStorageConcurrency(system->getRootFolder()->getPath(), device);
+
+			it = systemDevices.insert(std::make_pair(system, device)).first;
+
+			if (mDevices.find(device) == mDevices.cend())
+				mDevices[device].concurrency = concurrency;
+		}
+
+		mDevices[it->second].files.push(file);
+	}
+
+	std::vector<std::thread> workers;
+
 	{
-		if (mPaused)
+		std::unique_lock<std::mutex> lock(mLock);
+
+		for (auto& it : mDevices)
 		{
-			while (!mExit && mPaused)
+			DeviceQueue* device = &it.second;
+			int count = std::min<int>(device->concurrency, device->files.size());
+
+			for (int i = 0; i < count; i++)
 			{
-				std::this_thread::yield();
-				std::this_thread::sleep_for(std::chrono::milliseconds(500));
+				mRunningWorkers++;
+				workers.push_back(std::thread(&ThreadedHasher::hashFiles, this, device));
 			}
 		}
+	}
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mLock);
+			mWorkerDone.wait_for(lock, std::chrono::milliseconds(500), [this] { return mRunningWorkers == 0; });
+			if (mRunningWorkers == 0)
+				break;
+		}
 
-		hashFile(mSearchQueue.front());
-		mSearchQueue.pop();
+		saveResults();
 	}
 
+	for (auto& worker : workers)
+		worker.join();
+
+	saveResults();
+	Utils::Hash::saveCache(getHashIndexPath());
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	double megabytes = mBytes / (1024.0 * 1024.0);
+
+	LOG(LogInfo) << "ThreadedHasher : " << mProcessed << " files, " << (int)megabytes << " MB hashed in " << seconds << "s, " << workers.size() << " workers : "
+		<< (seconds > 0 ? mProcessed / seconds : 0) << " files/s, " << (seconds > 0 ? megabytes / seconds : 0) << " MB/s";
+
 	delete this;
 	ThreadedHasher::mInstance = nullptr;
 }
@@ -104,9 +271,9 @@ void ThreadedHasher::start(Window* window, bool forceAllGames, bool silent)
 
 		return;
 	}
-	
+
 	std::queue<FileData*> searchQueue;
-	
+
 	for (auto sys : SystemData::sSystemVector)
 	{
 		if (!sys->isNetplaySupported())
@@ -136,8 +303,26 @@ void ThreadedHasher::stop()
 
 	try
 	{
+		std::unique_lock<std::mutex> lock(mPauseLock);
 		thread->mExit = true;
 	}
 	catch (...) {}
+
+	mPauseChanged.notify_all();
+}
+
+void ThreadedHasher::pause()
+{
+	std::unique_lock<std::mutex> lock(mPauseLock);
+	mPaused = true;
 }
 
+void ThreadedHasher::resume()
+{
+	{
+		std::unique_lock<std::mutex> lock(mPauseLock);
+		mPaused = false;
+	}
+
+	mPauseChanged.notify_all();
+}
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
 #include <thread>
 #include <queue>
 #include "components/AsyncNotificationComponent.h"
@@ -12,18 +16,27 @@ public:
 	static void start(Window* window, bool forceAllGames=false, bool silent=false);
 	static void stop();
 	static bool isRunning() { return mInstance != nullptr; }
-	
-	static void pause() { mPaused = true; }
-	static void resume() { mPaused = false; }
+
+	static void pause();
+	static void resume();
 
 private:
+	// Games stored on the same device, read by 'concurrency' workers at most
+	struct DeviceQueue
+	{
+		std::queue<FileData*>	files;
+		int						concurrency;
+	};
+
 	ThreadedHasher(Window* window, std::queue<FileData*> searchQueue);
 	~ThreadedHasher();
 
-	void hashFile(FileData* fileData);
+	void hashFiles(DeviceQueue* device);
+	void saveResults();
 	std::string formatGameName(FileData* game);
 
 	std::queue<FileData*> mSearchQueue;
+	std::map<unsigned long long, DeviceQueue> mDevices;
 
 	Window* mWindow;
 	AsyncNotificationComponent* mWndNotification;
@@ -36,9 +49,20 @@ private:
 	std::thread* mHandle;
 
 	int mTotal;
-	bool mExit;
+	std::atomic<bool> mExit; // Set by stop() under mPauseLock, read by the workers under mLock
+
+	// Workers hand their results to the hasher thread, which applies them in batches
+	std::mutex mLock;
+	std::condition_variable mWorkerDone;
+	std::vector<std::pair<FileData*, std::string>> mResults;
+	FileData* mLastFile;
+	int mRunningWorkers;
+
+	std::atomic<int> mProcessed;
+	std::atomic<unsigned long long> mBytes;
 
 	static bool mPaused;
+	static std::mutex mPauseLock;
+	static std::condition_variable mPauseChanged;
 	static ThreadedHasher* mInstance;
 };
-
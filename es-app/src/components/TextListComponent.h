@@ -7,14 +7,18 @@
 #include "utils/StringUtil.h"
 #include "Log.h"
 #include "Sound.h"
+#include <algorithm>
+#include <list>
 #include <memory>
 
+#define TEXTCACHE_MIN_COUNT 64 // text caches kept at least, more when more rows fit on screen
+
 class TextCache;
 
 struct TextListData
 {
 	unsigned int colorId;
-	std::shared_ptr<TextCache> textCache;
+	std::weak_ptr<TextCache> textCache; // owned by the text cache list of the component
 };
 
 //A graphical list. Supports multiple colors for rows and scrolling.
@@ -59,15 +63,13 @@ public:
 	inline void setFont(const std::shared_ptr<Font>& font)
 	{
 		mFont = font;
-		for(auto it = mEntries.begin(); it != mEntries.end(); it++)
-			it->data.textCache.reset();
+		mTextCaches.clear();
 	}
 
 	inline void setUppercase(bool /*uppercase*/) 
 	{
 		mUppercase = true;
-		for(auto it = mEntries.begin(); it != mEntries.end(); it++)
-			it->data.textCache.reset();
+		mTextCaches.clear();
 	}
 
 	inline void setSelectorHeight(float selectorScale) { mSelectorHeight = selectorScale; }
@@ -107,6 +109,10 @@ private:
 	unsigned int mColors[COLOR_ID_COUNT];
 
 	ImageComponent mSelectorImage;
+
+	// Text caches of the rows shown lately, most recently used first. Rows only keep a weak reference,
+	// so a long list doesn't keep the text of every row it has shown
+	std::list<std::shared_ptr<TextCache>> mTextCaches;
 };
 
 template <typename T>
@@ -197,10 +203,21 @@ void TextListComponent<T>::render(const Transform4x4f& parentTrans)
 		else
 			color = mColors[entry.data.colorId];
 
-		if(!entry.data.textCache)
-			entry.data.textCache = std::unique_ptr<TextCache>(font->buildTextCache(mUppercase ? Utils::String::toUpper(entry.name) : entry.name, 0, 0, 0x000000FF));
+		std::shared_ptr<TextCache> textCache = entry.data.textCache.lock();
+		if(!textCache)
+		{
+			textCache = std::shared_ptr<TextCache>(font->buildTextCache(mUppercase ? Utils::String::toUpper(entry.name) : entry.name, 0, 0, 0x000000FF));
+			entry.data.textCache = textCache;
+			mTextCaches.push_front(textCache);
+		}
+		else if(mTextCaches.front() != textCache)
+		{
+			auto it = std::find(mTextCaches.begin(), mTextCaches.end(), textCache);
+			if(it != mTextCaches.end())
+				mTextCaches.splice(mTextCaches.begin(), mTextCaches, it);
+		}
 
-		entry.data.textCache->setColor(color);
+		textCache->setColor(color);
 
 		Vector3f offset(0, y, 0);
 
@@ -210,12 +227,12 @@ void TextListComponent<T>::render(const Transform4x4f& parentTrans)
 			offset[0] = mHorizontalMargin;
 			break;
 		case ALIGN_CENTER:
-			offset[0] = (int)((mSize.x() - entry.data.textCache->metrics.size.x()) / 2);
+			offset[0] = (int)((mSize.x() - textCache->metrics.size.x()) / 2);
 			if(offset[0] < mHorizontalMargin)
 				offset[0] = mHorizontalMargin;
 			break;
 		case ALIGN_RIGHT:
-			offset[0] = (mSize.x() - entry.data.textCache->metrics.size.x());
+			offset[0] = (mSize.x() - textCache->metrics.size.x());
 			offset[0] -= mHorizontalMargin;
 			if(offset[0] < mHorizontalMargin)
 				offset[0] = mHorizontalMargin;
@@ -232,7 +249,7 @@ void TextListComponent<T>::render(const Transform4x4f& parentTrans)
 			drawTrans.translate(offset);
 
 		Renderer::setMatrix(drawTrans);
-		font->renderTextCache(entry.data.textCache.get());
+		font->renderTextCache(textCache.get());
 
 		// render currently selected item text again if
 		// marquee is scrolled far enough for it to repeat
@@ -241,7 +258,7 @@ void TextListComponent<T>::render(const Transform4x4f& parentTrans)
 			drawTrans = trans;
 			drawTrans.translate(offset - Vector3f((float)mMarqueeOffset2, 0, 0));
 			Renderer::setMatrix(drawTrans);
-			font->renderTextCache(entry.data.textCache.get());
+			font->renderTextCache(textCache.get());
 		}
 
 		y += entrySize;
@@ -249,6 +266,11 @@ void TextListComponent<T>::render(const Transform4x4f& parentTrans)
 
 	Renderer::popClipRect();
 
+	// Rows on screen were moved first : the ones shown the longest time ago are released
+	size_t maxTextCaches = Math::max(TEXTCACHE_MIN_COUNT, screenCount * 3);
+	while(mTextCaches.size() > maxTextCaches)
+		mTextCaches.pop_back();
+
 	listRenderTitleOverlay(trans);
 
 	GuiComponent::renderChildren(trans);
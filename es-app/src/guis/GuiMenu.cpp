@@ -685,6 +685,18 @@ void GuiMenu::openDeveloperSettings()
 	max_vram->setValue((float)(Settings::getInstance()->getInt("MaxVRAM")));
 	s->addWithLabel(_("VRAM LIMIT"), max_vram);
 	s->addSaveFunc([max_vram] { Settings::getInstance()->setInt("MaxVRAM", (int)round(max_vram->getValue())); });
+
+	// font vram
+	auto font_vram = std::make_shared<SliderComponent>(mWindow, 8.f, 128.f, 8.f, "Mb");
+	font_vram->setValue((float)(Settings::getInstance()->getInt("FontMaxVRAM")));
+	s->addWithLabel(_("FONT VRAM LIMIT"), font_vram);
+	s->addSaveFunc([font_vram] { Settings::getInstance()->setInt("FontMaxVRAM", (int)round(font_vram->getValue())); });
+
+	// distance field fonts, used by the fonts created after the change
+	auto distance_field = std::make_shared<SwitchComponent>(mWindow);
+	distance_field->setState(Settings::getInstance()->getBool("FontDistanceField"));
+	s->addWithLabel(_("SCALABLE FONT GLYPHS"), distance_field);
+	s->addSaveFunc([distance_field] { Settings::getInstance()->setBool("FontDistanceField", distance_field->getState()); });
 	
 	// framerate
 	auto framerate = std::make_shared<SwitchComponent>(mWindow);
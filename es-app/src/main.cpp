@@ -7,6 +7,7 @@
 #include "views/ViewController.h"
 #include "CollectionSystemManager.h"
 #include "EmulationStation.h"
+#include "GamelistJournal.h"
 #include "InputManager.h"
 #include "Log.h"
 #include "MameNames.h"
@@ -30,6 +31,7 @@
 #include "ThreadedHasher.h"
 #include <FreeImage.h>
 #include "ImageIO.h"
+#include "Benchmark.h"
 
 #ifdef WIN32
 #include <Windows.h>
@@ -39,6 +41,11 @@
 
 bool scrape_cmdline = false;
 
+std::string benchmarkScript;
+std::string benchmarkOutput;
+int benchmarkSystems = 0;
+int benchmarkGames = 0;
+
 bool parseArgs(int argc, char* argv[])
 {
 	Utils::FileSystem::setExePath(argv[0]);
@@ -161,6 +168,19 @@ bool parseArgs(int argc, char* argv[])
 			Settings::getInstance()->setString("LogPath", logPATH);
 		}
 #endif
+		else if (strcmp(argv[i], "--benchmark") == 0 && i < argc - 1)
+		{
+			benchmarkScript = argv[i + 1];
+		}
+		else if (strcmp(argv[i], "--benchmark-output") == 0 && i < argc - 1)
+		{
+			benchmarkOutput = argv[i + 1];
+		}
+		else if (strcmp(argv[i], "--benchmark-generate") == 0 && i < argc - 2)
+		{
+			benchmarkSystems = atoi(argv[i + 1]);
+			benchmarkGames = atoi(argv[i + 2]);
+		}
 		else if (strcmp(argv[i], "--force-kiosk") == 0)
 		{
 			Settings::getInstance()->setBool("ForceKiosk", true);
@@ -203,6 +223,10 @@ bool parseArgs(int argc, char* argv[])
 				"--force-kiosk		Force the UI mode to be Kiosk\n"
 				"--force-disable-filters		Force the UI to ignore applied filters in gamelist\n"
 				"--home [path]		Directory to use as home path\n"
+				"--benchmark [script]		replay an input script and write frame timings as JSON, then quit\n"
+				"--benchmark-output [file]	JSON file written by --benchmark (default: benchmark.json in the config folder)\n"
+				"--benchmark-generate [systems] [games]	write a synthetic es_systems.cfg and gamelists, then quit\n"
+				"				(use with --home on an empty folder, and SDL_VIDEODRIVER=dummy with the null renderer)\n"
 #ifdef _ENABLEEMUELEC
 				"--log-path [path]		Directory to use for log\n"
 #endif
@@ -370,6 +394,9 @@ int main(int argc, char* argv[])
 	//always close the log on exit
 	atexit(&onExit);
 
+	if (benchmarkSystems > 0 && benchmarkGames > 0)
+		return Benchmark::generate(benchmarkSystems, benchmarkGames) ? 0 : 1;
+
 	// Set locale
 	setLocale(argv[0]); // batocera
 
@@ -464,7 +491,8 @@ int main(int argc, char* argv[])
 	//choose which GUI to open depending on if an input configuration already exists
 	if(errorMsg == NULL)
 	{
-		if(Utils::FileSystem::exists(InputManager::getConfigPath()) && InputManager::getInstance()->getNumConfiguredDevices() > 0)
+		// The benchmark uses the default keyboard mapping
+		if(!benchmarkScript.empty() || (Utils::FileSystem::exists(InputManager::getConfigPath()) && InputManager::getInstance()->getNumConfiguredDevices() > 0))
 		{
 			ViewController::get()->goToStart(true);
 		}else{
@@ -490,6 +518,17 @@ int main(int argc, char* argv[])
 	else
 		AudioManager::getInstance()->playRandomMusic();
 
+	std::unique_ptr<Benchmark> benchmark;
+	if (!benchmarkScript.empty())
+	{
+		benchmark = std::unique_ptr<Benchmark>(new Benchmark(&window));
+		if (!benchmark->load(benchmarkScript))
+			return 1;
+
+		if (benchmarkOutput.empty())
+			benchmarkOutput = Utils::FileSystem::getEsConfigPath() + "/benchmark.json";
+	}
+
 	int lastTime = SDL_GetTicks();
 	int ps_time = SDL_GetTicks();
 
@@ -501,7 +540,7 @@ int main(int argc, char* argv[])
 	{
 		SDL_Event event;
 
-		bool ps_standby = PowerSaver::getState() && (int) SDL_GetTicks() - ps_time > PowerSaver::getMode();
+		bool ps_standby = !benchmark && PowerSaver::getState() && (int) SDL_GetTicks() - ps_time > PowerSaver::getMode();
 		if(ps_standby ? SDL_WaitEventTimeout(&event, PowerSaver::getTimeout()) : SDL_PollEvent(&event))
 		{
 			// PowerSaver can push events to exit SDL_WaitEventTimeout immediatly
@@ -552,7 +591,7 @@ int main(int argc, char* argv[])
 		//	ps_time = SDL_GetTicks();
 		}
 
-		if(window.isSleeping())
+		if(!benchmark && window.isSleeping())
 		{
 			lastTime = SDL_GetTicks();
 			SDL_Delay(1); // this doesn't need to be accurate, we're just giving up our CPU time until something wakes us up
@@ -567,11 +606,29 @@ int main(int argc, char* argv[])
 		if(deltaTime < 0)
 			deltaTime = 1000;
 
+		if (benchmark)
+		{
+			// Fixed frame time, the measure is the CPU time of the frame
+			deltaTime = Benchmark::FRAME_TIME;
+
+			// Script steps (image measures) run before the frame is timed
+			if (!benchmark->update())
+			{
+				benchmark->save(benchmarkOutput);
+				break;
+			}
+
+			benchmark->beginFrame();
+		}
+
 		TRYCATCH("Window.update" ,window.update(deltaTime))	
 		TRYCATCH("Window.render", window.render())
 
 		Renderer::swapBuffers();
 
+		if (benchmark)
+			benchmark->endFrame();
+
 		Log::flush();
 	}
 
@@ -588,6 +645,7 @@ int main(int argc, char* argv[])
 	MameNames::deinit();
 	CollectionSystemManager::deinit();
 	SystemData::deleteSystems();
+	GamelistJournal::deinit();
 
 	// call this ONLY when linking with FreeImage as a static library
 #ifdef FREEIMAGE_LIB
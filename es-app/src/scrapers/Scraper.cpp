@@ -3,6 +3,7 @@
 #include "FileData.h"
 #include "GamesDBJSONScraper.h"
 #include "ScreenScraper.h"
+#include "scrapers/ScraperRateLimiter.h"
 #include "Log.h"
 #include "Settings.h"
 #include "SystemData.h"
@@ -108,11 +109,10 @@ ScraperRequest::ScraperRequest(std::vector<ScraperSearchResult>& resultsWrite) :
 
 // ScraperHttpRequest
 ScraperHttpRequest::ScraperHttpRequest(std::vector<ScraperSearchResult>& resultsWrite, const std::string& url) 
-	: ScraperRequest(resultsWrite)
+	: ScraperRequest(resultsWrite), mUrl(url), mRequest(nullptr), mRetryCount(0)
 {
 	setStatus(ASYNC_IN_PROGRESS);
-	mRequest = new HttpReq(url);
-	mRetryCount = 0;
+	mLimiter = ScraperRateLimiter::getInstance();
 }
 
 ScraperHttpRequest::~ScraperHttpRequest()
@@ -120,8 +120,34 @@ ScraperHttpRequest::~ScraperHttpRequest()
 	delete mRequest;	
 }
 
+// Suspends the provider and sends the request again once it is allowed. Returns false after too many attempts
+bool ScraperHttpRequest::retry()
+{
+	mRetryCount++;
+	if (mRetryCount > 4)
+		return false;
+
+	LOG(LogDebug) << "REQ_429_TOOMANYREQUESTS : Retrying later";
+
+	mLimiter->throttle();
+
+	delete mRequest;
+	mRequest = nullptr;
+
+	setStatus(ASYNC_IN_PROGRESS);
+	return true;
+}
+
 void ScraperHttpRequest::update()
 {
+	if (mRequest == nullptr)
+	{
+		if (!mLimiter->tryAcquire())
+			return;
+
+		mRequest = new HttpReq(mUrl);
+	}
+
 	HttpReq::Status status = mRequest->status();
 
 	// not ready yet
@@ -131,30 +157,18 @@ void ScraperHttpRequest::update()
 	if(status == HttpReq::REQ_SUCCESS)
 	{
 		setStatus(ASYNC_DONE); // if process() has an error, status will be changed to ASYNC_ERROR
-		process(mRequest, mResults);
+		if (process(mRequest, mResults))
+			mLimiter->succeeded();
+		else if (!retry())
+			setStatus(ASYNC_DONE); // Ignore error
+
 		return;
 	}
 
 	if (status == HttpReq::REQ_429_TOOMANYREQUESTS)
 	{
-		mRetryCount++;
-		if (mRetryCount > 4)
-		{
+		if (!retry())
 			setStatus(ASYNC_DONE); // Ignore error
-			return;
-		}
-
-		setStatus(ASYNC_IN_PROGRESS);
-
-		LOG(LogDebug) << "REQ_429_TOOMANYREQUESTS : Wait before Retrying";
-
-		std::string url = mRequest->getUrl();
-		std::this_thread::sleep_for(std::chrono::seconds(mRetryCount < 3 ? 5 : 10));
-		
-		delete mRequest;
-		mRequest = new HttpReq(url);
-
-		LOG(LogDebug) << "REQ_429_TOOMANYREQUESTS : Retrying";
 
 		return;
 	}
@@ -382,9 +396,9 @@ std::unique_ptr<ImageDownloadHandle> downloadImageAsync(const std::string& url,
 }
 
 ImageDownloadHandle::ImageDownloadHandle(const std::string& url, const std::string& path, int maxWidth, int maxHeight) : 
-	mSavePath(path), mMaxWidth(maxWidth), mMaxHeight(maxHeight)
+	mUrl(url), mRequest(nullptr), mRetryCount(0), mSavePath(path), mMaxWidth(maxWidth), mMaxHeight(maxHeight)
 {
-	mRequest = new HttpReq(url, path);
+	mLimiter = ScraperRateLimiter::getInstance();
 }
 
 ImageDownloadHandle::~ImageDownloadHandle()
@@ -394,7 +408,7 @@ ImageDownloadHandle::~ImageDownloadHandle()
 
 int ImageDownloadHandle::getPercent()
 {
-	if (mRequest->status() == HttpReq::REQ_IN_PROGRESS)
+	if (mRequest != nullptr && mRequest->status() == HttpReq::REQ_IN_PROGRESS)
 		return mRequest->getPercent();
 
 	return -1;
@@ -402,6 +416,17 @@ int ImageDownloadHandle::getPercent()
 
 void ImageDownloadHandle::update()
 {
+	if (mStatus != ASYNC_IN_PROGRESS)
+		return;
+
+	if (mRequest == nullptr)
+	{
+		if (!mLimiter->tryAcquire())
+			return;
+
+		mRequest = new HttpReq(mUrl, mSavePath);
+	}
+
 	HttpReq::Status status = mRequest->status();
 
 	if (status == HttpReq::REQ_IN_PROGRESS)
@@ -416,17 +441,12 @@ void ImageDownloadHandle::update()
 			return;
 		}
 
-		setStatus(ASYNC_IN_PROGRESS);
-
-		LOG(LogDebug) << "REQ_429_TOOMANYREQUESTS : Wait before Retrying";
+		LOG(LogDebug) << "REQ_429_TOOMANYREQUESTS : Retrying later";
 
-		std::string url = mRequest->getUrl();
-		std::this_thread::sleep_for(std::chrono::seconds(mRetryCount < 3 ? 5 : 10));
+		mLimiter->throttle();
 
 		delete mRequest;
-		mRequest = new HttpReq(url, mSavePath);
-
-		LOG(LogDebug) << "REQ_429_TOOMANYREQUESTS : Retrying";
+		mRequest = nullptr;
 
 		return;
 	}
@@ -447,6 +467,8 @@ void ImageDownloadHandle::update()
 
 	if (status == HttpReq::REQ_SUCCESS && mStatus == ASYNC_IN_PROGRESS)
 	{
+		mLimiter->succeeded();
+
 		// It's an image ?
 		std::string ext = Utils::String::toLower(Utils::FileSystem::getExtension(mSavePath));
 		if (ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".bmp" || ext == ".gif")
@@ -14,6 +14,7 @@
 #define MAX_SCRAPER_RESULTS 7
 
 class FileData;
+class ScraperRateLimiter;
 class SystemData;
 
 struct ScraperSearchParams
@@ -88,6 +89,7 @@ protected:
 };
 
 // a single HTTP request that needs to be processed to get the results
+// the request is only sent when the rate limiter of the scraper allows it
 class ScraperHttpRequest : public ScraperRequest
 {
 public:
@@ -97,11 +99,16 @@ public:
 	virtual void update() override;
 
 protected:
+	// returns false if the provider refused the request (too many requests), it is sent again later
 	virtual bool process(HttpReq* request, std::vector<ScraperSearchResult>& results) = 0;
 
 private:
+	bool retry();
+
+	std::string mUrl;
 	HttpReq* mRequest;
 	int	mRetryCount;
+	ScraperRateLimiter* mLimiter;
 };
 
 // a request to get a list of results
@@ -202,8 +209,10 @@ public:
 	virtual int getPercent();
 
 private:
+	std::string mUrl;
 	HttpReq* mRequest;
 	int	mRetryCount;
+	ScraperRateLimiter* mLimiter;
 
 	std::string mSavePath;
 	int mMaxWidth;
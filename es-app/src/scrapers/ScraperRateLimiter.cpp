@@ -0,0 +1,113 @@
+#include "scrapers/ScraperRateLimiter.h"
+
+#include "Log.h"
+#include "Settings.h"
+#include <algorithm>
+
+// Suspension after a 429, doubled each time it happens again in a row
+#define THROTTLE_DELAY		5
+#define THROTTLE_MAX_DELAY	60
+
+std::mutex ScraperRateLimiter::sInstancesLock;
+std::map<std::string, ScraperRateLimiter*> ScraperRateLimiter::sInstances;
+
+ScraperRateLimiter* ScraperRateLimiter::getInstance()
+{
+	return getInstance(Settings::getInstance()->getString("Scraper"));
+}
+
+ScraperRateLimiter* ScraperRateLimiter::getInstance(const std::string& provider)
+{
+	std::unique_lock<std::mutex> lock(sInstancesLock);
+
+	auto it = sInstances.find(provider);
+	if (it != sInstances.cend())
+		return it->second;
+
+	// Until the provider tells the limits of the account : ScreenScraper gives a single thread to anonymous users
+	ScraperRateLimiter* limiter;
+	if (provider == "ScreenScraper")
+		limiter = new ScraperRateLimiter(1, 2.0);
+	else if (provider == "TheGamesDB")
+		limiter = new ScraperRateLimiter(4, 4.0);
+	else
+		limiter = new ScraperRateLimiter(1, 2.0);
+
+	sInstances[provider] = limiter;
+	return limiter;
+}
+
+ScraperRateLimiter::ScraperRateLimiter(int maxThreads, double requestsPerSecond)
+	: mMaxThreads(maxThreads), mRate(requestsPerSecond), mThrottleCount(0)
+{
+	mTokens = maxThreads * 2;
+	mLastRefill = std::chrono::steady_clock::now();
+	mSuspendedUntil = mLastRefill;
+}
+
+void ScraperRateLimiter::refill(const std::chrono::steady_clock::time_point& now)
+{
+	double elapsed = std::chrono::duration<double>(now - mLastRefill).count();
+	mLastRefill = now;
+
+	// Bursts of two requests per thread : a search and its first media
+	mTokens = std::min(mTokens + elapsed * mRate, (double)mMaxThreads * 2);
+}
+
+bool ScraperRateLimiter::tryAcquire()
+{
+	std::unique_lock<std::mutex> lock(mLock);
+
+	auto now = std::chrono::steady_clock::now();
+	if (now < mSuspendedUntil)
+		return false;
+
+	refill(now);
+
+	if (mTokens < 1.0)
+		return false;
+
+	mTokens -= 1.0;
+	return true;
+}
+
+void ScraperRateLimiter::succeeded()
+{
+	std::unique_lock<std::mutex> lock(mLock);
+	mThrottleCount = 0;
+}
+
+void ScraperRateLimiter::throttle()
+{
+	std::unique_lock<std::mutex> lock(mLock);
+
+	int delay = std::min(THROTTLE_DELAY << std::min(mThrottleCount, 4), THROTTLE_MAX_DELAY);
+	mThrottleCount++;
+
+	auto now = std::chrono::steady_clock::now();
+	mSuspendedUntil = std::max(mSuspendedUntil, now + std::chrono::seconds(delay));
+	mTokens = 0;
+	mLastRefill = mSuspendedUntil;
+
+	LOG(LogDebug) << "ScraperRateLimiter : too many requests, waiting " << delay << "s";
+}
+
+int ScraperRateLimiter::getMaxThreads()
+{
+	std::unique_lock<std::mutex> lock(mLock);
+	return mMaxThreads;
+}
+
+void ScraperRateLimiter::setLimits(int maxThreads, int requestsPerMinute)
+{
+	std::unique_lock<std::mutex> lock(mLock);
+
+	if (maxThreads > 0 && maxThreads != mMaxThreads)
+	{
+		LOG(LogDebug) << "ScraperRateLimiter : " << maxThreads << " threads allowed";
+		mMaxThreads = maxThreads;
+	}
+
+	if (requestsPerMinute > 0)
+		mRate = requestsPerMinute / 60.0;
+}
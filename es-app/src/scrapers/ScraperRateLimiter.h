@@ -0,0 +1,55 @@
+#pragma once
+#ifndef ES_APP_SCRAPERS_SCRAPER_RATE_LIMITER_H
+#define ES_APP_SCRAPERS_SCRAPER_RATE_LIMITER_H
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+
+//
+// Token bucket shared by all the requests sent to a scraping provider (searches and media downloads).
+// A request takes a token before being sent, and waits for the next poll when there is none.
+// A 429 answer, or a "too many requests" page, empties the bucket and suspends the provider for a while,
+// longer each time it happens again in a row.
+// Thread safe.
+//
+class ScraperRateLimiter
+{
+public:
+	// Limiter of the scraper selected in the settings
+	static ScraperRateLimiter* getInstance();
+	static ScraperRateLimiter* getInstance(const std::string& provider);
+
+	// Returns false if the request has to wait
+	bool tryAcquire();
+
+	void succeeded();
+	void throttle();
+
+	// Number of games the provider accepts to scrape at the same time
+	int getMaxThreads();
+
+	// Limits of the account, as given by the provider. Values <= 0 are ignored
+	void setLimits(int maxThreads, int requestsPerMinute);
+
+private:
+	ScraperRateLimiter(int maxThreads, double requestsPerSecond);
+
+	void refill(const std::chrono::steady_clock::time_point& now);
+
+	std::mutex	mLock;
+
+	int			mMaxThreads;
+	double		mRate;		// Tokens per second
+	double		mTokens;
+	int			mThrottleCount;
+
+	std::chrono::steady_clock::time_point mLastRefill;
+	std::chrono::steady_clock::time_point mSuspendedUntil;
+
+	static std::mutex								sInstancesLock;
+	static std::map<std::string, ScraperRateLimiter*>	sInstances;
+};
+
+#endif // ES_APP_SCRAPERS_SCRAPER_RATE_LIMITER_H
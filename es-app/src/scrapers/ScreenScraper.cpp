@@ -1,5 +1,7 @@
 #include "scrapers/ScreenScraper.h"
 
+#include "scrapers/ScraperRateLimiter.h"
+#include "utils/HashUtil.h"
 #include "utils/TimeUtil.h"
 #include "utils/StringUtil.h"
 #include "FileData.h"
@@ -10,7 +12,6 @@
 #include <pugixml/src/pugixml.hpp>
 #include <cstring>
 #include "SystemConf.h"
-#include "md5.h"
 #include <thread>
 
 using namespace PlatformIds;
@@ -207,41 +208,13 @@ void screenscraper_generate_scraper_requests(const ScraperSearchParams& params,
 		path = ssConfig.getGameSearchUrl(params.game->getFileName());
 		path += "&romtype=rom";
 
-		// Use md5 to search scrapped game
+		// Use md5 to search scrapped game. Cached if the hasher already read the file
 		int length = Utils::FileSystem::getFileSize(params.game->getFullPath());
 		if (length <= 131072 * 1024) // 128 Mb max
 		{
-			try
-			{
-				// 64 Kb blocks
-				#define MD5BUFFERSIZE 64 * 1024
-
-				char* buffer = new char[MD5BUFFERSIZE];
-				if (buffer)
-				{
-					size_t size;
-
-					FILE* file = fopen(params.game->getFullPath().c_str(), "rb");
-					if (file)
-					{
-						MD5 md5 = MD5();
-
-						while (size = fread(buffer, 1, MD5BUFFERSIZE, file))
-							md5.update(buffer, size);
-
-						md5.finalize();
-
-						std::string val = md5.hexdigest();
-						if (!val.empty())
-							path += "&md5=" + val;
-
-						fclose(file);
-					}
-
-					delete buffer;
-				}
-			}
-			catch (std::bad_alloc& ex) {}
+			Utils::Hash::Digest digest;
+			if (Utils::Hash::hashFile(params.game->getFullPath(), Utils::Hash::MD5, digest) && !digest.md5.empty())
+				path += "&md5=" + digest.md5;
 		}
 	}
 	else
@@ -385,6 +358,12 @@ void ScreenScraperRequest::processGame(const pugi::xml_document& xmldoc, std::ve
 	LOG(LogDebug) << "ScreenScraperRequest::processGame >>";
 
 	pugi::xml_node data = xmldoc.child("Data");
+
+	// Limits of the account, the threaded scraper adapts the number of games scraped at the same time
+	pugi::xml_node user = data.child("ssuser");
+	if (user)
+		ScraperRateLimiter::getInstance("ScreenScraper")->setLimits(user.child("maxthreads").text().as_int(), user.child("maxrequestspermin").text().as_int());
+
 	if (data.child("jeux"))
 		data = data.child("jeux");
 
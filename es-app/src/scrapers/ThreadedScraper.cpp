@@ -6,27 +6,41 @@
 #include "guis/GuiMsgBox.h"
 #include "Gamelist.h"
 #include "Log.h"
+#include "Settings.h"
+#include "scrapers/ScraperRateLimiter.h"
+#include <algorithm>
 
 #define GUIICON _U("\uF03E ")
 
+// Accepted results are handed to the ui thread, and the notification refreshed, at this interval
+#define BATCH_INTERVAL 500
+
 ThreadedScraper* ThreadedScraper::mInstance = nullptr;
 bool ThreadedScraper::mPaused = false;
+std::mutex ThreadedScraper::mPauseLock;
+std::condition_variable ThreadedScraper::mPauseChanged;
 
 ThreadedScraper::ThreadedScraper(Window* window, const std::queue<ScraperSearchParams>& searches)
 	: mSearchQueue(searches), mWindow(window)
 {
 	mExit = false;
+	mDone = 0;
 	mTotal = (int) mSearchQueue.size();
 
 	mWndNotification = new AsyncNotificationComponent(window);
 
 	mWindow->registerNotificationComponent(mWndNotification);
-	search(mSearchQueue.front());
-	mHandle = new std::thread(&ThreadedScraper::run, this);	
+	mHandle = new std::thread(&ThreadedScraper::run, this);
 }
 
 ThreadedScraper::~ThreadedScraper()
 {
+	for (auto job : mSearches)
+		delete job;
+
+	for (auto job : mDownloads)
+		delete job;
+
 	mWindow->unRegisterNotificationComponent(mWndNotification);
 	delete mWndNotification;
 
@@ -38,30 +52,31 @@ std::string ThreadedScraper::formatGameName(FileData* game)
 	return "["+game->getSystemName()+"] " + game->getName();
 }
 
-void ThreadedScraper::search(const ScraperSearchParams& params)
+int ThreadedScraper::getMaxThreads()
 {
-	LOG(LogDebug) << "ThreadedScraper::formatGameName";
-
-	std::string gameName = formatGameName(params.game);
+	int threads = ScraperRateLimiter::getInstance()->getMaxThreads();
 
-	LOG(LogInfo) << "ThreadedScraper::search >> " << gameName;
+	int setting = Settings::getInstance()->getInt("ScraperThreads");
+	if (setting > 0)
+		threads = std::min(threads, setting);
 
-	mCurrentAction = "";
-	mLastSearch = params;
-	mSearchHandle = startScraperSearch(params);
+	return std::max(threads, 1);
+}
 
-	std::string idx = std::to_string(mTotal + 1 - mSearchQueue.size()) + "/" + std::to_string(mTotal);
+void ThreadedScraper::search(const ScraperSearchParams& params)
+{
+	LOG(LogInfo) << "ThreadedScraper::search >> " << formatGameName(params.game);
 
-	mWndNotification->updateTitle(GUIICON + _("SCRAPING") + "... " + idx);
-	mWndNotification->updateText(gameName, _("Searching")+"...");
-	mWndNotification->updatePercent(-1);
+	ScrapingJob* job = new ScrapingJob(params);
+	job->search = startScraperSearch(params);
+	mSearches.push_back(job);
 
 	LOG(LogDebug) << "ThreadedScraper::search <<";
 }
 
 void ThreadedScraper::processError(int status, const std::string statusString)
 {
-	if (status == HttpReq::REQ_430_TOOMANYSCRAPS || status == HttpReq::REQ_430_TOOMANYFAILURES || 
+	if (status == HttpReq::REQ_430_TOOMANYSCRAPS || status == HttpReq::REQ_430_TOOMANYFAILURES ||
 		status == HttpReq::REQ_426_BLACKLISTED || status == HttpReq::REQ_FILESTREAM_ERROR || status == HttpReq::REQ_426_SERVERMAINTENANCE ||
 		status == HttpReq::REQ_403_BADLOGIN || status == HttpReq::REQ_401_FORBIDDEN)
 	{
@@ -72,125 +87,200 @@ void ThreadedScraper::processError(int status, const std::string statusString)
 		mErrors.push_back(statusString);
 }
 
-void ThreadedScraper::run()
+// Returns true when the game leaves the search stage
+bool ThreadedScraper::updateSearch(ScrapingJob* job)
 {
-	while (!mExit && !mSearchQueue.empty())
+	if (!job->searched)
 	{
-		if (mPaused)
+		if (job->search->status() == ASYNC_IN_PROGRESS)
+			return false;
+
+		auto status = job->search->status();
+		auto results = job->search->getResults();
+		auto statusString = job->search->getStatusString();
+		auto httpCode = job->search->getErrorCode();
+
+		LOG(LogDebug) << "ThreadedScraper::SearchResponse : " << httpCode << " " << statusString;
+
+		job->search.reset();
+
+		if (status == ASYNC_ERROR)
+			processError(httpCode, statusString);
+
+		if (status != ASYNC_DONE || results.size() == 0)
 		{
-			while (!mExit && mPaused)
-			{
-				std::this_thread::yield();
-				std::this_thread::sleep_for(std::chrono::milliseconds(500));
-			}
+			mDone++;
+			delete job;
+			return true;
 		}
 
-		if (mSearchHandle && mSearchHandle->status() != ASYNC_IN_PROGRESS)
+		job->searched = true;
+		job->result = results[0];
+
+		if (!job->result.hadMedia())
 		{
-			auto status = mSearchHandle->status();
-			auto results = mSearchHandle->getResults();
-			auto statusString = mSearchHandle->getStatusString();
-			auto httpCode = mSearchHandle->getErrorCode();
-
-			LOG(LogDebug) << "ThreadedScraper::SearchResponse : " << httpCode << " " << statusString;
-
-			mSearchHandle.reset();
-
-			if (status == ASYNC_DONE)
-			{
-				if (results.size() > 0)
-				{
-					if (results[0].hadMedia())
-						processMedias(results[0]);
-					else
-						acceptResult(results[0]);
-				}
-			}
-			else if (status == ASYNC_ERROR)
-				processError(httpCode, statusString);				
+			acceptResult(job, job->result);
+			return true;
 		}
+	}
 
-		if (mMDResolveHandle && mMDResolveHandle->status() != ASYNC_IN_PROGRESS)
-		{
-			auto status = mMDResolveHandle->status();
-			auto result = mMDResolveHandle->getResult();
-			auto statusString = mMDResolveHandle->getStatusString();
-			auto httpCode = mMDResolveHandle->getErrorCode();
+	// Waits for a download slot, searches don't get further ahead than that
+	if ((int)mDownloads.size() >= getMaxThreads())
+		return false;
 
-			LOG(LogDebug) << "ThreadedScraper::ResolveResponse : " << statusString;
+	LOG(LogDebug) << "ThreadedScraper::processMedias";
 
-			mCurrentAction = "";
-			mMDResolveHandle.reset();
+	job->resolve = resolveMetaDataAssets(job->result, job->params);
+	mDownloads.push_back(job);
+	return true;
+}
 
-			if (status == ASYNC_DONE)
-				acceptResult(result);
-			else if (status == ASYNC_ERROR)
-				processError(httpCode, statusString);
-		}
+// Returns true when the medias of the game are downloaded
+bool ThreadedScraper::updateDownload(ScrapingJob* job)
+{
+	if (job->resolve->status() == ASYNC_IN_PROGRESS)
+		return false;
+
+	auto status = job->resolve->status();
+	auto result = job->resolve->getResult();
+	auto statusString = job->resolve->getStatusString();
+	auto httpCode = job->resolve->getErrorCode();
+
+	LOG(LogDebug) << "ThreadedScraper::ResolveResponse : " << statusString;
+
+	job->resolve.reset();
 
-		if (mMDResolveHandle && mMDResolveHandle->status() == ASYNC_IN_PROGRESS)
+	if (status == ASYNC_DONE)
+	{
+		acceptResult(job, result);
+		return true;
+	}
+
+	if (status == ASYNC_ERROR)
+		processError(httpCode, statusString);
+
+	mDone++;
+	delete job;
+	return true;
+}
+
+void ThreadedScraper::acceptResult(ScrapingJob* job, const ScraperSearchResult& result)
+{
+	LOG(LogDebug) << "ThreadedScraper::acceptResult";
+
+	mResults.push_back(std::make_pair(job->params.game, result.mdl));
+
+	mDone++;
+	delete job;
+}
+
+void ThreadedScraper::saveResults()
+{
+	if (mResults.empty())
+		return;
+
+	std::vector<std::pair<FileData*, MetaDataList>> results;
+	results.swap(mResults);
+
+	// A single ui task imports the whole batch, the journal writes the records together
+	mWindow->postToUiThread([results](Window* w)
+	{
+		LOG(LogDebug) << "ThreadedScraper::importScrappedMetadata : " << results.size() << " games";
+
+		for (auto& result : results)
 		{
-			std::string action = mMDResolveHandle->getCurrentItem();
-			if (action != mCurrentAction)
-			{
-				mCurrentAction = action;
-				mWndNotification->updateText(formatGameName(mLastSearch.game), _("Downloading") + " " + mCurrentAction);
-			}
-
-			mWndNotification->updatePercent(mMDResolveHandle->getPercent());
+			result.first->getMetadata().importScrappedMetadata(result.second);
+			saveToGamelistRecovery(result.first);
 		}
+	});
+}
+
+void ThreadedScraper::updateNotification()
+{
+	std::string idx = std::to_string(std::min(mDone + 1, mTotal)) + "/" + std::to_string(mTotal);
+	mWndNotification->updateTitle(GUIICON + _("SCRAPING") + "... " + idx);
+
+	if (!mDownloads.empty())
+	{
+		ScrapingJob* job = mDownloads.front();
+
+		std::string action = job->resolve ? job->resolve->getCurrentItem() : "";
+		mWndNotification->updateText(formatGameName(job->params.game), _("Downloading") + " " + action);
+		mWndNotification->updatePercent(job->resolve ? job->resolve->getPercent() : -1);
+	}
+	else if (!mSearches.empty())
+	{
+		mWndNotification->updateText(formatGameName(mSearches.front()->params.game), _("Searching") + "...");
+		mWndNotification->updatePercent(-1);
+	}
+}
 
-		if (mSearchHandle == nullptr && mMDResolveHandle == nullptr)
+void ThreadedScraper::run()
+{
+	auto startTime = std::chrono::steady_clock::now();
+	auto lastBatch = startTime;
+
+	while (!mExit)
+	{
 		{
-			mSearchQueue.pop();
+			std::unique_lock<std::mutex> lock(mPauseLock);
+			mPauseChanged.wait(lock, [this] { return !mPaused || mExit; });
+		}
 
-			if (mSearchQueue.empty())
-			{
-				LOG(LogDebug) << "ThreadedScraper::finished";
-				break;
-			}
-			
+		int maxThreads = getMaxThreads();
+
+		// Searches and downloads share the slots, a game moving from one to the other keeps its slot
+		while (!mSearchQueue.empty() && (int)(mSearches.size() + mDownloads.size()) < maxThreads)
+		{
 			search(mSearchQueue.front());
+			mSearchQueue.pop();
 		}
-		else
+
+		if (mSearches.empty() && mDownloads.empty())
 		{
-			std::this_thread::yield();
-			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			LOG(LogDebug) << "ThreadedScraper::finished";
+			break;
 		}
-	}
-	
-	if (!mExit)
-		mWindow->displayNotificationMessage(GUIICON + _("SCRAPING FINISHED. REFRESH UPDATE GAMES LISTS TO APPLY CHANGES."));
 
-	delete this;
-	ThreadedScraper::mInstance = nullptr;
-}
+		for (auto it = mSearches.begin(); it != mSearches.end() && !mExit; )
+		{
+			if (updateSearch(*it))
+				it = mSearches.erase(it);
+			else
+				it++;
+		}
 
-void ThreadedScraper::processMedias(ScraperSearchResult result)
-{
-	LOG(LogDebug) << "ThreadedScraper::processMedias >>";
-	mMDResolveHandle = resolveMetaDataAssets(result, mLastSearch);
-	LOG(LogDebug) << "ThreadedScraper::processMedias <<";
-}
+		for (auto it = mDownloads.begin(); it != mDownloads.end() && !mExit; )
+		{
+			if (updateDownload(*it))
+				it = mDownloads.erase(it);
+			else
+				it++;
+		}
 
-void ThreadedScraper::acceptResult(const ScraperSearchResult& result)
-{
-	LOG(LogDebug) << "ThreadedScraper::acceptResult >>";
+		auto now = std::chrono::steady_clock::now();
+		if (std::chrono::duration_cast<std::chrono::milliseconds>(now - lastBatch).count() >= BATCH_INTERVAL)
+		{
+			lastBatch = now;
+			saveResults();
+			updateNotification();
+		}
 
-	ScraperSearchParams& search = mSearchQueue.front();
+		std::this_thread::yield();
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
 
-	auto game = search.game;
+	saveResults();
 
-	mWindow->postToUiThread([game, result](Window* w)
-	{
-		LOG(LogDebug) << "ThreadedScraper::importScrappedMetadata";
-		game->getMetadata().importScrappedMetadata(result.mdl);
+	double minutes = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count() / 60.0;
+	LOG(LogInfo) << "ThreadedScraper : " << mDone << " of " << mTotal << " games in " << minutes << " min, up to " << getMaxThreads() << " at once : "
+		<< (minutes > 0 ? mDone / minutes : 0) << " games/min, " << mErrors.size() << " errors";
 
-		LOG(LogDebug) << "ThreadedScraper::saveToGamelistRecovery";
-		saveToGamelistRecovery(game);
-	});
+	if (!mExit)
+		mWindow->displayNotificationMessage(GUIICON + _("SCRAPING FINISHED. REFRESH UPDATE GAMES LISTS TO APPLY CHANGES."));
 
-	LOG(LogDebug) << "ThreadedScraper::acceptResult <<";
+	delete this;
+	ThreadedScraper::mInstance = nullptr;
 }
 
 void ThreadedScraper::start(Window* window, const std::queue<ScraperSearchParams>& searches)
@@ -209,8 +299,26 @@ void ThreadedScraper::stop()
 
 	try
 	{
+		std::unique_lock<std::mutex> lock(mPauseLock);
 		thread->mExit = true;
 	}
 	catch (...) {}
+
+	mPauseChanged.notify_all();
+}
+
+void ThreadedScraper::pause()
+{
+	std::unique_lock<std::mutex> lock(mPauseLock);
+	mPaused = true;
 }
 
+void ThreadedScraper::resume()
+{
+	{
+		std::unique_lock<std::mutex> lock(mPauseLock);
+		mPaused = false;
+	}
+
+	mPauseChanged.notify_all();
+}
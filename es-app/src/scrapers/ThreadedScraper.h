@@ -1,5 +1,8 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <thread>
 #include "Scraper.h"
 #include "components/AsyncNotificationComponent.h"
@@ -10,11 +13,24 @@ public:
 	static void start(Window* window, const std::queue<ScraperSearchParams>& searches);
 	static void stop();
 	static bool isRunning() { return mInstance != nullptr; }
-	
-	static void pause() { mPaused = true; }
-	static void resume() { mPaused = false; }
+
+	static void pause();
+	static void resume();
 
 private:
+	// A game being scraped : its search first, then the download of its medias
+	struct ScrapingJob
+	{
+		ScrapingJob(const ScraperSearchParams& searchParams) : params(searchParams), searched(false) { }
+
+		ScraperSearchParams params;
+		std::unique_ptr<ScraperSearchHandle> search;
+
+		bool searched;
+		ScraperSearchResult result;
+		std::unique_ptr<MDResolveHandle> resolve;
+	};
+
 	ThreadedScraper(Window* window, const std::queue<ScraperSearchParams>& searches);
 	~ThreadedScraper();
 
@@ -29,21 +45,30 @@ private:
 	std::thread* mHandle;
 	std::queue<ScraperSearchParams> mSearchQueue;
 
-	ScraperSearchParams mLastSearch;
-	std::unique_ptr<ScraperSearchHandle> mSearchHandle;
-	std::unique_ptr<MDResolveHandle> mMDResolveHandle;
+	// Searches and media downloads are separate stages, each with as many games in flight as the scraper allows
+	std::vector<ScrapingJob*> mSearches;
+	std::vector<ScrapingJob*> mDownloads;
+
+	// Accepted results, imported by the ui thread in batches
+	std::vector<std::pair<FileData*, MetaDataList>> mResults;
 
 	void search(const ScraperSearchParams& params);
-	void processMedias(ScraperSearchResult result);
-	void acceptResult(const ScraperSearchResult& result);
+	bool updateSearch(ScrapingJob* job);
+	bool updateDownload(ScrapingJob* job);
+	void acceptResult(ScrapingJob* job, const ScraperSearchResult& result);
+	void saveResults();
 	void processError(int status, const std::string statusString);
+	void updateNotification();
+	int getMaxThreads();
 
 	std::string formatGameName(FileData* game);
 
 	int mTotal;
-	bool mExit;
+	int mDone;
+	std::atomic<bool> mExit; // Set by stop() from the UI thread, read by the scraper thread without lock
 
 	static bool mPaused;
+	static std::mutex mPauseLock;
+	static std::condition_variable mPauseChanged;
 	static ThreadedScraper* mInstance;
 };
-
@@ -20,6 +20,7 @@
 #include "SystemConf.h"
 #include "AudioManager.h"
 #include "FileSorts.h"
+#include "resources/TextureAtlas.h"
 
 #ifdef _ENABLEEMUELEC
 #include "ApiSystem.h"
@@ -728,6 +729,10 @@ void ViewController::reloadAll(Window* window, bool reloadTheme)
 		mCurrentView->onShow();
 
 	updateHelpPrompts();
+
+	// The pictures of the previous theme left holes in the atlas pages
+	if (reloadTheme)
+		TextureAtlas::repack();
 }
 
 std::vector<HelpPrompt> ViewController::getHelpPrompts()
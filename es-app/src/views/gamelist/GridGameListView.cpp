@@ -36,6 +36,16 @@ GridGameListView::GridGameListView(Window* window, FolderData* root, const std::
 	mGrid.setPosition(mSize.x() * 0.1f, mSize.y() * 0.1f);
 	mGrid.setDefaultZIndex(20);
 	mGrid.setCursorChangedCallback([&](const CursorState& /*state*/) { updateInfoPanel(); });
+	mGrid.setDataLoader([this](FileData* const& file, ImageGridData& data)
+	{
+		// Media lookups are done for the tiles being shown only
+		data.texturePath = getImagePath(file);
+		data.videoPath = file->getVideoPath();
+		data.marqueePath = file->getMarqueePath();
+		data.favorite = file->getFavorite();
+		data.folder = file->getType() != GAME;
+		data.virtualFolder = isVirtualFolder(file);
+	});
 	addChild(&mGrid);
 
 	// metadata labels + values
@@ -325,7 +335,7 @@ void GridGameListView::populateList(const std::vector<FileData*>& files)
 			for (auto file : files)
 			{
 				if (file->getFavorite() && showFavoriteIcon)
-					mGrid.add(file->getName(), getImagePath(file), file->getVideoPath(), file->getMarqueePath(), true, file->getType() != GAME, isVirtualFolder(file), file);
+					mGrid.add(file->getName(), file);
 			}
 		}
 
@@ -338,15 +348,15 @@ void GridGameListView::populateList(const std::vector<FileData*>& files)
 
 				if (showFavoriteIcon)
 				{
-					mGrid.add(_U("\uF006 ") + file->getName(), getImagePath(file), file->getVideoPath(), file->getMarqueePath(), true, file->getType() != GAME, isVirtualFolder(file), file);
+					mGrid.add(_U("\uF006 ") + file->getName(), file);
 					continue;
 				}
 			}
 
 			if (file->getType() == FOLDER && Utils::FileSystem::exists(getImagePath(file)))
-				mGrid.add(_U("\uF114 ") + file->getName(), getImagePath(file), file->getVideoPath(), file->getMarqueePath(), file->getFavorite(), file->getType() != GAME, isVirtualFolder(file), file);
+				mGrid.add(_U("\uF114 ") + file->getName(), file);
 			else
-				mGrid.add(file->getName(), getImagePath(file), file->getVideoPath(), file->getMarqueePath(), file->getFavorite(), file->getType() != GAME, isVirtualFolder(file), file);
+				mGrid.add(file->getName(), file);
 		}
 
 		// if we have the ".." PLACEHOLDER, then select the first game instead of the placeholder
@@ -5,21 +5,36 @@
 #include <string.h>
 #include "utils/FileSystemUtil.h"
 #include "utils/StringUtil.h"
+#include "math/Misc.h"
+#include <algorithm>
+#include <chrono>
 #include <sstream>
 #include <fstream>
 #include <map>
 #include <mutex>
 
-unsigned char* ImageIO::loadFromMemoryRGBA32(const unsigned char * data, const size_t size, size_t & width, size_t & height, MaxSizeInfo* maxSize, Vector2i* baseSize, Vector2i* packedSize)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define IMAGEIO_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define IMAGEIO_NEON
+#endif
+
+unsigned char* ImageIO::loadFromMemoryRGBA32(const unsigned char * data, const size_t size, size_t & width, size_t & height, MaxSizeInfo* maxSize, Vector2i* baseSize, Vector2i* packedSize, bool flipVertical)
 {
 	LOG(LogDebug) << "ImageIO::loadFromMemoryRGBA32";
 
+	auto startTime = std::chrono::steady_clock::now();
+
 	if (baseSize != nullptr)
 		*baseSize = Vector2i(0, 0);
 
-	if (baseSize != nullptr)
+	if (packedSize != nullptr)
 		*packedSize = Vector2i(0, 0);
 
+	bool hasMaxSize = maxSize != nullptr && maxSize->x() > 0 && maxSize->y() > 0;
+
 	std::vector<unsigned char> rawData;
 	width = 0;
 	height = 0;
@@ -30,12 +45,58 @@ unsigned char* ImageIO::loadFromMemoryRGBA32(const unsigned char * data, const s
 		FREE_IMAGE_FORMAT format = FreeImage_GetFileTypeFromMemory(fiMemory);
 		if (format != FIF_UNKNOWN && FreeImage_FIFSupportsReading(format))
 		{
+			int flags = 0;
+			size_t sourceWidth = 0;
+			size_t sourceHeight = 0;
+
+#ifdef FIF_LOAD_NOPIXELS
+			// JPEG can be decoded directly at 1/2, 1/4 or 1/8 of its size (DCT scaling) : read the header
+			// to know the target size, then ask the decoder for the smallest scale that is still larger
+			if (format == FIF_JPEG && hasMaxSize)
+			{
+				FIBITMAP* fiHeader = FreeImage_LoadFromMemory(format, fiMemory, FIF_LOAD_NOPIXELS);
+				if (fiHeader != nullptr)
+				{
+					sourceWidth = FreeImage_GetWidth(fiHeader);
+					sourceHeight = FreeImage_GetHeight(fiHeader);
+					FreeImage_Unload(fiHeader);
+
+					if (sourceWidth > maxSize->x() || sourceHeight > maxSize->y())
+					{
+						Vector2i sz = adjustPictureSize(Vector2i(sourceWidth, sourceHeight), Vector2i(maxSize->x(), maxSize->y()), maxSize->externalZoom());
+						int requestedSize = Math::max(sz.x(), sz.y());
+						if (requestedSize > 0 && requestedSize < 0xFFFF)
+							flags = requestedSize << 16;
+					}
+				}
+
+				FreeImage_SeekMemory(fiMemory, 0, SEEK_SET);
+			}
+#endif
+
 			//file type is supported. load image
-			FIBITMAP * fiBitmap = FreeImage_LoadFromMemory(format, fiMemory);
+			FIBITMAP * fiBitmap = FreeImage_LoadFromMemory(format, fiMemory, flags);
 			if (fiBitmap != nullptr)
 			{
-				//loaded. convert to 32bit if necessary
-				if (FreeImage_GetBPP(fiBitmap) != 32)
+				width = FreeImage_GetWidth(fiBitmap);
+				height = FreeImage_GetHeight(fiBitmap);
+
+				// The decoder may already have reduced the picture : the base size is the one of the file
+				if (sourceWidth == 0 || sourceHeight == 0)
+				{
+					sourceWidth = width;
+					sourceHeight = height;
+				}
+
+				if (baseSize != nullptr)
+					*baseSize = Vector2i(sourceWidth, sourceHeight);
+
+				// Truecolor pictures are downscaled straight from their 24 or 32 bits pixels, no conversion is needed.
+				// Palettized ones are converted first to keep their transparency
+				unsigned int bpp = FreeImage_GetBPP(fiBitmap);
+				bool rescaleFirst = (bpp == 24 || bpp == 32);
+
+				if (!rescaleFirst)
 				{
 					FIBITMAP * fiConverted = FreeImage_ConvertTo32Bits(fiBitmap);
 					if (fiConverted != nullptr)
@@ -45,53 +106,76 @@ unsigned char* ImageIO::loadFromMemoryRGBA32(const unsigned char * data, const s
 						fiBitmap = fiConverted;
 					}
 				}
-				if (fiBitmap != nullptr)
-				{
-					width = FreeImage_GetWidth(fiBitmap);
-					height = FreeImage_GetHeight(fiBitmap);
 
-					if (baseSize != nullptr)
-						*baseSize = Vector2i(width, height);
+				unsigned char* tempData = nullptr;
 
-					if (maxSize != nullptr && maxSize->x() > 0 && maxSize->y() > 0 && (width > maxSize->x() || height > maxSize->y()))
+				if (hasMaxSize && (width > maxSize->x() || height > maxSize->y() || sourceWidth != width || sourceHeight != height))
+				{
+					Vector2i sz = adjustPictureSize(Vector2i(sourceWidth, sourceHeight), Vector2i(maxSize->x(), maxSize->y()), maxSize->externalZoom());
+					if (sz.x() > 0 && sz.y() > 0 && (sz.x() != width || sz.y() != height))
 					{
-						Vector2i sz = adjustPictureSize(Vector2i(width, height), Vector2i(maxSize->x(), maxSize->y()), maxSize->externalZoom());
-						if (sz.x() != width || sz.y() != height)
+						LOG(LogDebug) << "ImageIO : rescaling image from " << std::string(std::to_string(width) + "x" + std::to_string(height)).c_str() << " to " << std::string(std::to_string(sz.x()) + "x" + std::to_string(sz.y())).c_str();
+
+						unsigned int fiBpp = FreeImage_GetBPP(fiBitmap);
+
+						if (FreeImage_GetImageType(fiBitmap) == FIT_BITMAP && (fiBpp == 24 || fiBpp == 32) && (size_t)sz.x() <= width && (size_t)sz.y() <= height)
 						{
-							LOG(LogDebug) << "ImageIO : rescaling image from " << std::string(std::to_string(width) + "x" + std::to_string(height)).c_str() << " to " << std::string(std::to_string(sz.x()) + "x" + std::to_string(sz.y())).c_str();
+							// Downscale, swizzle and flip in one pass from the decoded pixels
+							tempData = new unsigned char[sz.x() * sz.y() * 4];
+							downscaleBGRA(FreeImage_GetBits(fiBitmap), width, height, FreeImage_GetPitch(fiBitmap), fiBpp / 8, (unsigned int*)tempData, sz.x(), sz.y(), flipVertical);
 
+							width = sz.x();
+							height = sz.y();
+						}
+						else
+						{
 							FIBITMAP* imageRescaled = FreeImage_Rescale(fiBitmap, sz.x(), sz.y(), FILTER_BOX);
-							FreeImage_Unload(fiBitmap);
-							fiBitmap = imageRescaled;
+							if (imageRescaled != nullptr)
+							{
+								FreeImage_Unload(fiBitmap);
+								fiBitmap = imageRescaled;
+							}
 
 							width = FreeImage_GetWidth(fiBitmap);
 							height = FreeImage_GetHeight(fiBitmap);
-
-							if (packedSize != nullptr)
-								*packedSize = Vector2i(width, height);
 						}
 					}
 
-					unsigned char* tempData = new unsigned char[width * height * 4];
-
-					int w = (int)width;
+					if (packedSize != nullptr && (width != sourceWidth || height != sourceHeight))
+						*packedSize = Vector2i(width, height);
+				}
 
-					for (int y = (int)height; --y >= 0; )
+				if (tempData == nullptr)
+				{
+					//convert to 32bit if necessary
+					if (FreeImage_GetBPP(fiBitmap) != 32)
 					{
-						unsigned int* argb = (unsigned int*)FreeImage_GetScanLine(fiBitmap, y);
-						unsigned int* abgr = (unsigned int*)(tempData + (y * width * 4));
-						for (int x = w; --x >= 0;)
+						FIBITMAP * fiConverted = FreeImage_ConvertTo32Bits(fiBitmap);
+						if (fiConverted != nullptr)
 						{
-							unsigned int c = argb[x];
-							abgr[x] = (c & 0xFF00FF00) | ((c & 0xFF) << 16) | ((c >> 16) & 0xFF);
+							//free original bitmap data
+							FreeImage_Unload(fiBitmap);
+							fiBitmap = fiConverted;
 						}
 					}
 
-					FreeImage_Unload(fiBitmap);
-					FreeImage_CloseMemory(fiMemory);
+					tempData = new unsigned char[width * height * 4];
 
-					return tempData;
+					// FreeImage scanlines are bottom-up : the swizzle writes each one where it belongs, so flipping doesn't need another pass
+					for (int y = (int)height; --y >= 0; )
+					{
+						size_t row = flipVertical ? height - 1 - y : y;
+						swizzleBGRA((const unsigned int*)FreeImage_GetScanLine(fiBitmap, y), (unsigned int*)(tempData + (row * width * 4)), width);
+					}
 				}
+
+				FreeImage_Unload(fiBitmap);
+				FreeImage_CloseMemory(fiMemory);
+
+				LOG(LogDebug) << "ImageIO : decoded " << std::string(std::to_string(sourceWidth) + "x" + std::to_string(sourceHeight)).c_str() << " to " << std::string(std::to_string(width) + "x" + std::to_string(height)).c_str() << 
+					" in " << std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count() << "us";
+
+				return tempData;
 			}
 			else
 			{
@@ -109,18 +193,145 @@ unsigned char* ImageIO::loadFromMemoryRGBA32(const unsigned char * data, const s
 	return nullptr;
 }
 
-void ImageIO::flipPixelsVert(unsigned char* imagePx, const size_t& width, const size_t& height)
+void ImageIO::swizzleBGRA(const unsigned int* src, unsigned int* dst, size_t count)
 {
-	unsigned int temp;
-	unsigned int* arr = (unsigned int*)imagePx;
-	for(size_t y = 0; y < height / 2; y++)
+	size_t i = 0;
+
+#if defined(IMAGEIO_SSE2)
+	const __m128i maskAG = _mm_set1_epi32(0xFF00FF00);
+	const __m128i maskLow = _mm_set1_epi32(0x000000FF);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i c = _mm_loadu_si128((const __m128i*)(src + i));
+		__m128i ag = _mm_and_si128(c, maskAG);
+		__m128i r = _mm_slli_epi32(_mm_and_si128(c, maskLow), 16);
+		__m128i b = _mm_and_si128(_mm_srli_epi32(c, 16), maskLow);
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(ag, _mm_or_si128(r, b)));
+	}
+#elif defined(IMAGEIO_NEON)
+	for (; i + 16 <= count; i += 16)
 	{
-		for(size_t x = 0; x < width; x++)
+		uint8x16x4_t px = vld4q_u8((const uint8_t*)(src + i));
+		uint8x16_t temp = px.val[0];
+		px.val[0] = px.val[2];
+		px.val[2] = temp;
+		vst4q_u8((uint8_t*)(dst + i), px);
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		unsigned int c = src[i];
+		dst[i] = (c & 0xFF00FF00) | ((c & 0xFF) << 16) | ((c >> 16) & 0xFF);
+	}
+}
+
+void ImageIO::downscaleBGRA(const unsigned char* src, size_t srcWidth, size_t srcHeight, size_t pitch, int bytesPerPixel, unsigned int* dst, size_t dstWidth, size_t dstHeight, bool flipVertical)
+{
+	if (dstWidth == 0 || dstHeight == 0 || dstWidth > srcWidth || dstHeight > srcHeight)
+		return;
+
+	// First source column of each destination column : boxes are 1 or 2 columns wider than the exact ratio at most
+	std::vector<size_t> columns(dstWidth + 1);
+	for (size_t x = 0; x <= dstWidth; x++)
+		columns[x] = x * srcWidth / dstWidth;
+
+	// B, G, R, A sums of the current destination row
+	std::vector<unsigned int> sums(dstWidth * 4);
+
+	for (size_t y = 0; y < dstHeight; y++)
+	{
+		size_t firstRow = y * srcHeight / dstHeight;
+		size_t lastRow = (y + 1) * srcHeight / dstHeight;
+
+		std::fill(sums.begin(), sums.end(), 0);
+
+		for (size_t sy = firstRow; sy < lastRow; sy++)
 		{
-			temp = arr[x + (y * width)];
-			arr[x + (y * width)] = arr[x + (height * width) - ((y + 1) * width)];
-			arr[x + (height * width) - ((y + 1) * width)] = temp;
+			const unsigned char* row = src + sy * pitch;
+			unsigned int* sum = sums.data();
+
+			if (bytesPerPixel == 4)
+			{
+				for (size_t x = 0; x < dstWidth; x++, sum += 4)
+				{
+					const unsigned char* px = row + columns[x] * 4;
+					const unsigned char* end = row + columns[x + 1] * 4;
+
+#if defined(IMAGEIO_SSE2)
+					// One pixel widened to 4 x 32 bits per add
+					const __m128i zero = _mm_setzero_si128();
+					__m128i acc = _mm_loadu_si128((const __m128i*)sum);
+
+					for (; px < end; px += 4)
+					{
+						int value;
+						memcpy(&value, px, 4);
+						acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(value), zero), zero));
+					}
+
+					_mm_storeu_si128((__m128i*)sum, acc);
+#else
+					for (; px < end; px += 4)
+					{
+						sum[0] += px[0];
+						sum[1] += px[1];
+						sum[2] += px[2];
+						sum[3] += px[3];
+					}
+#endif
+				}
+			}
+			else
+			{
+				for (size_t x = 0; x < dstWidth; x++, sum += 4)
+				{
+					const unsigned char* end = row + columns[x + 1] * 3;
+					for (const unsigned char* px = row + columns[x] * 3; px < end; px += 3)
+					{
+						sum[0] += px[0];
+						sum[1] += px[1];
+						sum[2] += px[2];
+					}
+				}
+			}
 		}
+
+		// Averages, written as RGBA where the row belongs
+		unsigned int* out = dst + (flipVertical ? dstHeight - 1 - y : y) * dstWidth;
+		const unsigned int* sum = sums.data();
+		const unsigned int rows = (unsigned int)(lastRow - firstRow);
+
+		for (size_t x = 0; x < dstWidth; x++, sum += 4)
+		{
+			unsigned int count = rows * (unsigned int)(columns[x + 1] - columns[x]);
+			unsigned int half = count / 2;
+
+			unsigned int b = (sum[0] + half) / count;
+			unsigned int g = (sum[1] + half) / count;
+			unsigned int r = (sum[2] + half) / count;
+			unsigned int a = bytesPerPixel == 4 ? (sum[3] + half) / count : 0xFF;
+
+			out[x] = r | (g << 8) | (b << 16) | (a << 24);
+		}
+	}
+}
+
+void ImageIO::flipPixelsVert(unsigned char* imagePx, const size_t& width, const size_t& height)
+{
+	// Swap whole rows, memcpy is vectorised by the C library
+	size_t rowSize = width * 4;
+	std::vector<unsigned char> temp(rowSize);
+
+	for (size_t y = 0; y < height / 2; y++)
+	{
+		unsigned char* top = imagePx + (y * rowSize);
+		unsigned char* bottom = imagePx + ((height - y - 1) * rowSize);
+
+		memcpy(temp.data(), top, rowSize);
+		memcpy(top, bottom, rowSize);
+		memcpy(bottom, temp.data(), rowSize);
 	}
 }
 
@@ -43,8 +43,14 @@ private:
 class ImageIO
 {
 public:
-	static unsigned char*  loadFromMemoryRGBA32(const unsigned char * data, const size_t size, size_t & width, size_t & height, MaxSizeInfo* maxSize = nullptr, Vector2i* baseSize = nullptr, Vector2i* packedSize = nullptr);
+	// Rows are bottom-up, as textures want them. flipVertical gives top-down rows (SDL surfaces) in the same pass
+	static unsigned char*  loadFromMemoryRGBA32(const unsigned char * data, const size_t size, size_t & width, size_t & height, MaxSizeInfo* maxSize = nullptr, Vector2i* baseSize = nullptr, Vector2i* packedSize = nullptr, bool flipVertical = false);
 	static void flipPixelsVert(unsigned char* imagePx, const size_t& width, const size_t& height);
+	// Converts FreeImage BGRA pixels to RGBA (SSE2/NEON when available). src and dst may be the same buffer
+	static void swizzleBGRA(const unsigned int* src, unsigned int* dst, size_t count);
+	// Box-filters a BGR / BGRA picture (bytesPerPixel 3 or 4) down to dstWidth x dstHeight RGBA pixels, swizzle and
+	// optional vertical flip in the same pass. Rows of src are 'pitch' bytes apart. dst can't be larger than src
+	static void downscaleBGRA(const unsigned char* src, size_t srcWidth, size_t srcHeight, size_t pitch, int bytesPerPixel, unsigned int* dst, size_t dstWidth, size_t dstHeight, bool flipVertical = false);
 
 	// batocera
 	static Vector2f getPictureMinSize(Vector2f imageSize, Vector2f maxSize);
@@ -62,6 +62,9 @@ public:
 	static void runningScreenSaver(bool state);
 	static bool isScreenSaverActive();
 
+	// Opening videos ahead of time (grid, screensaver) keeps a decoder busy : not in enhanced mode
+	static bool isPreloadAllowed() { return mMode != ENHANCED; }
+
 private:
 	static void setState(bool state);
 
@@ -2,9 +2,26 @@
 #include "Log.h"
 #include "platform.h"
 #include "utils/FileSystemUtil.h"
+#include <thread>
 
 namespace Scripting
 {
+	// Joined on exit, so a running script isn't killed with the process
+	struct AsyncEvent
+	{
+		std::thread thread;
+
+		~AsyncEvent() { join(); }
+
+		void join()
+		{
+			if (thread.joinable())
+				thread.join();
+		}
+	};
+
+	static AsyncEvent sAsyncEvent;
+
 	void fireEvent(const std::string& eventName, const std::string& arg1, const std::string& arg2)
 	{
 		LOG(LogDebug) << "fireEvent: " << eventName << " " << arg1 << " " << arg2;
@@ -33,4 +50,15 @@ namespace Scripting
         }
 	}
 
+	void fireEventAsync(const std::string& eventName, const std::string& arg1, const std::string& arg2)
+	{
+		sAsyncEvent.join();
+		sAsyncEvent.thread = std::thread([eventName, arg1, arg2] { fireEvent(eventName, arg1, arg2); });
+	}
+
+	void waitForAsyncEvents()
+	{
+		sAsyncEvent.join();
+	}
+
 } // Scripting::
@@ -7,6 +7,10 @@
 namespace Scripting
 {
 	void fireEvent(const std::string& eventName, const std::string& arg1="", const std::string& arg2="");
+
+	// Runs the scripts on a background thread. Async events run one after the other, in the order they were fired
+	void fireEventAsync(const std::string& eventName, const std::string& arg1="", const std::string& arg2="");
+	void waitForAsyncEvents();
 } // Scripting::
 
 #endif //ES_CORE_SCRIPTING_H
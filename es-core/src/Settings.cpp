@@ -131,6 +131,7 @@ void Settings::setDefaults()
 	mStringMap["ScrapperThumbSrc"] = "box-2D";
 	mStringMap["ScrapperLogoSrc"] = "wheel";
 	mBoolMap["ScrapeVideos"] = false;
+	mIntMap["ScraperThreads"] = 0; // Games scraped at the same time, 0 : as many as the scraper account allows
 
 	mBoolMap["ScreenSaverMarquee"] = true;
 	mBoolMap["ScreenSaverControls"] = true;
@@ -207,7 +208,19 @@ void Settings::setDefaults()
 	mBoolMap["AsyncImages"] = true;	
 	mBoolMap["PreloadUI"] = false;
 	mBoolMap["OptimizeVRAM"] = true;
+	mBoolMap["TextureDiskCache"] = true;
+	mIntMap["TextureDiskCacheMaxSize"] = 256; // Mb, entries used the longest time ago are removed over it. 0 disables the limit
+	mIntMap["TextureAtlasMaxSize"] = 128; // px, theme pictures up to this size share atlas pages. 0 disables the atlas
+	mIntMap["FontMaxVRAM"] = 32; // Mb, glyph textures used the longest time ago are evicted over it
+	mBoolMap["FontDistanceField"] = false;
+	mBoolMap["GamelistSnapshot"] = true;
+	mBoolMap["FastGameLaunch"] = true;
 	mBoolMap["OptimizeVideo"] = true;
+#ifdef _RPI_
+	mIntMap["VideoPreloadMaxMemory"] = 32; // Mb, videos opened ahead of time (grid, screensaver). 0 disables
+#else
+	mIntMap["VideoPreloadMaxMemory"] = 64; // Mb, videos opened ahead of time (grid, screensaver). 0 disables
+#endif
 
 	mBoolMap["ShowFilenames"] = false;
 	
@@ -22,6 +22,7 @@
 #include "components/BatteryIndicatorComponent.h"
 #include "guis/GuiMsgBox.h"
 #include "components/VolumeInfoComponent.h"
+#include "components/VideoVlcComponent.h"
 #ifdef _ENABLEEMUELEC
 #include "utils/FileSystemUtil.h"
 #endif
@@ -32,6 +33,9 @@ Window::Window() : mNormalizeNextUpdate(false), mFrameTimeElapsed(0), mFrameCoun
 	mTransiting = nullptr;
 	mTransitionOffset = 0;
 
+	mMeasureStartTime = 0;
+	mMeasureFirstFrame = false;
+
 	mHelp = new HelpComponent(this);
 	mBackgroundOverlay = new ImageComponent(this);
 	mBackgroundOverlay->setImage(":/scroll_gradient.png"); // batocera
@@ -230,6 +234,7 @@ void Window::deinit()
 	InputManager::getInstance()->deinit();
 	TextureResource::clearQueue();
 	ResourceManager::getInstance()->unloadAll();
+	VideoVlcComponent::clearPreloadedVideos();
 	Renderer::deinit();
 }
 
@@ -405,6 +410,13 @@ void Window::update(int deltaTime)
 
 			ss << "\nFont VRAM: " << fontVramUsageMb << " Tex VRAM: " << textureVramUsageMb <<
 				" Tex Max: " << textureTotalUsageMb;
+
+			// async texture loader
+			ss << "\nTex Loaded: " << TextureResource::getLoadedCount() << " Tex Cancelled: " << TextureResource::getCancelledCount();
+
+			// renderer batching, counters of the previous frame
+			const Renderer::FrameStats& frameStats = Renderer::getFrameStats();
+			ss << "\nDraws: " << frameStats.draws << " Draw calls: " << frameStats.drawCalls << " State changes: " << frameStats.stateChanges << " Texture binds: " << frameStats.textureBinds;
 			mFrameDataText = std::unique_ptr<TextCache>(mDefaultFonts.at(1)->buildTextCache(ss.str(), 50.f, 50.f, 0xFF00FFFF));
 		}
 
@@ -541,6 +553,23 @@ void Window::render()
 	if (mVolumeInfo && Settings::getInstance()->getBool("VolumePopup"))
 		mVolumeInfo->render(transform);
 
+	if (mMeasureStartTime != 0)
+	{
+		unsigned int elapsed = SDL_GetTicks() - mMeasureStartTime;
+
+		if (mMeasureFirstFrame)
+		{
+			LOG(LogInfo) << "Window : first frame after " << elapsed << "ms";
+			mMeasureFirstFrame = false;
+		}
+
+		if (!TextureResource::isLoading())
+		{
+			LOG(LogInfo) << "Window : first fully textured frame after " << elapsed << "ms";
+			mMeasureStartTime = 0;
+		}
+	}
+
 	if(mTimeSinceLastInput >= screensaverTime && screensaverTime != 0)
 	{
 		if (!isProcessing() && mAllowSleep && (!mScreenSaver || mScreenSaver->allowSleep()))
@@ -559,6 +588,15 @@ void Window::normalizeNextUpdate()
 	mNormalizeNextUpdate = true;
 }
 
+void Window::measureTexturedFrame()
+{
+	mMeasureStartTime = SDL_GetTicks();
+	if (mMeasureStartTime == 0)
+		mMeasureStartTime = 1;
+
+	mMeasureFirstFrame = true;
+}
+
 bool Window::getAllowSleep()
 {
 	return mAllowSleep;
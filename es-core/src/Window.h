@@ -63,6 +63,9 @@ public:
 
 	void normalizeNextUpdate();
 
+	// Logs the time from now to the first frame, and to the first frame with no texture left to load (game return)
+	void measureTexturedFrame();
+
 	inline bool isSleeping() const { return mSleeping; }
 	bool getAllowSleep();
 	void setAllowSleep(bool sleep);
@@ -139,6 +142,9 @@ private:
 
 	bool mNormalizeNextUpdate;
 
+	unsigned int mMeasureStartTime;
+	bool mMeasureFirstFrame;
+
 	bool mAllowSleep;
 	bool mSleeping;
 	unsigned int mTimeSinceLastInput;
@@ -903,6 +903,15 @@ void GridTileComponent::setVideo(const std::string& path, float defaultDelay)
 	resize();
 }
 
+// Opens the video of a tile that is likely to be selected next, at the size it will play
+void GridTileComponent::preloadVideo(const std::string& path)
+{
+	if (mSelectedProperties.Image.sizeMode == "minSize")
+		VideoVlcComponent::preloadVideo(path);
+	else
+		VideoVlcComponent::preloadVideo(path, mSelectedProperties.Size);
+}
+
 void GridTileComponent::onShow()
 {
 	GuiComponent::onShow();
@@ -200,6 +200,7 @@ public:
 
 	void setLabel(std::string name);
 	void setVideo(const std::string& path, float defaultDelay = -1.0);
+	void preloadVideo(const std::string& path);
 
 	void setImage(const std::string& path, bool isDefaultImage = false);
 	void setMarquee(const std::string& path);
@@ -54,11 +54,17 @@ class IList : public GuiComponent
 public:
 	struct Entry
 	{
+		Entry() : loaded(true) { }
+
 		std::string name;
 		UserData object;
 		EntryData data;
+		bool loaded; // false until the data loader has filled data
 	};
 
+	// Fills the data of an entry added with its name & object only
+	typedef std::function<void(const UserData& object, EntryData& data)> DataLoader;
+
 protected:
 	int mCursor;
 
@@ -77,6 +83,7 @@ protected:
 	const ListLoopType mLoopType;
 
 	std::vector<Entry> mEntries;
+	DataLoader mDataLoader;
 	
 public:
 	IList(Window* window, const ScrollTierList& tierList = LIST_SCROLL_STYLE_QUICK, const ListLoopType& loopType = LIST_PAUSE_AT_END) : GuiComponent(window), 
@@ -183,6 +190,19 @@ public:
 		mEntries.push_back(e);
 	}
 
+	// Adds an entry without its data : the loader fills it the first time it is needed,
+	// so a large list only builds the data of the entries that are shown
+	void add(const std::string& name, const UserData& obj)
+	{
+		Entry e;
+		e.name = name;
+		e.object = obj;
+		e.loaded = (mDataLoader == nullptr);
+		mEntries.push_back(e);
+	}
+
+	void setDataLoader(const DataLoader& loader) { mDataLoader = loader; }
+
 	bool remove(const UserData& obj)
 	{
 		for(auto it = mEntries.cbegin(); it != mEntries.cend(); it++)
@@ -209,6 +229,18 @@ public:
 	}
 
 protected:
+	EntryData& getEntryData(int index)
+	{
+		Entry& entry = mEntries.at(index);
+		if (!entry.loaded)
+		{
+			entry.loaded = true;
+			mDataLoader(entry.object, entry.data);
+		}
+
+		return entry.data;
+	}
+
 	void remove(typename std::vector<Entry>::const_iterator& it)
 	{
 		if(mCursor > 0 && it - mEntries.cbegin() <= mCursor)
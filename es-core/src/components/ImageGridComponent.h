@@ -38,6 +38,8 @@ enum CenterSelection
 
 struct ImageGridData
 {
+	ImageGridData() : favorite(false), folder(false), virtualFolder(false) { }
+
 	std::string texturePath;
 	std::string marqueePath;
 	std::string videoPath;
@@ -51,6 +53,7 @@ class ImageGridComponent : public IList<ImageGridData, T>
 {
 protected:
 	using IList<ImageGridData, T>::mEntries;
+	using IList<ImageGridData, T>::getEntryData;
 	using IList<ImageGridData, T>::mScrollTier;
 	using IList<ImageGridData, T>::listUpdate;
 	using IList<ImageGridData, T>::listInput;
@@ -69,6 +72,7 @@ public:
 	ImageGridComponent(Window* window);
 
 	void add(const std::string& name, const std::string& imagePath, const std::string& videoPath, const std::string& marqueePath, bool favorite, bool folder, bool virtualFolder, const T& obj);
+	void add(const std::string& name, const T& obj); // data filled by the loader when the tile is shown, see setDataLoader
 
 	bool input(InputConfig* config, Input input) override;
 	void update(int deltaTime) override;
@@ -107,8 +111,11 @@ private:
 	
 	bool isVertical() { return mScrollDirection == SCROLL_VERTICALLY; };
 
+	void preloadNextVideo();
+
 	bool mEntriesDirty;
 	int mLastCursor;
+	int mCursorMove;
 	std::string mDefaultGameTexture;
 	std::string mDefaultFolderTexture;
 
@@ -167,6 +174,7 @@ ImageGridComponent<T>::ImageGridComponent(Window* window) : IList<ImageGridData,
 	mStartPosition = 0;	
 	mEntriesDirty = true;
 	mLastCursor = 0;
+	mCursorMove = 0;
 	mDefaultGameTexture = ":/cartridge.svg";
 	mDefaultFolderTexture = ":/folder.svg";
 
@@ -202,6 +210,13 @@ void ImageGridComponent<T>::add(const std::string& name, const std::string& imag
 	mEntriesDirty = true;
 }
 
+template<typename T>
+void ImageGridComponent<T>::add(const std::string& name, const T& obj)
+{
+	static_cast<IList< ImageGridData, T >*>(this)->add(name, obj);
+	mEntriesDirty = true;
+}
+
 template<typename T>
 bool ImageGridComponent<T>::input(InputConfig* config, Input input)
 {
@@ -560,7 +575,7 @@ void ImageGridComponent<T>::applyTheme(const std::shared_ptr<ThemeData>& theme,
 				// so we need to update them with new game image texture
 				for (auto it = mEntries.begin(); it != mEntries.end(); it++)
 				{
-					if ((*it).data.texturePath == oldDefaultGameTexture)
+					if ((*it).loaded && (*it).data.texturePath == oldDefaultGameTexture)
 						(*it).data.texturePath = mDefaultGameTexture;
 				}
 			}
@@ -581,7 +596,7 @@ void ImageGridComponent<T>::applyTheme(const std::shared_ptr<ThemeData>& theme,
 				// so we need to update them with new folder image texture
 				for (auto it = mEntries.begin(); it != mEntries.end(); it++)
 				{
-					if ((*it).data.texturePath == oldDefaultFolderTexture)
+					if ((*it).loaded && (*it).data.texturePath == oldDefaultFolderTexture)
 						(*it).data.texturePath = mDefaultFolderTexture;
 				}
 			}
@@ -625,8 +640,13 @@ void ImageGridComponent<T>::onCursorChanged(const CursorState& state)
 {
 	if (mLastCursor == mCursor)
 	{
-		if (state == CURSOR_STOPPED && mCursorChangedCallback)
-			mCursorChangedCallback(state);
+		if (state == CURSOR_STOPPED)
+		{
+			preloadNextVideo();
+
+			if (mCursorChangedCallback)
+				mCursorChangedCallback(state);
+		}
 
 		return;
 	}	
@@ -751,6 +771,18 @@ void ImageGridComponent<T>::onCursorChanged(const CursorState& state)
 	auto lastCursor = mLastCursor;
 	mLastCursor = mCursor;
 
+	if (lastCursor >= 0)
+	{
+		mCursorMove = mCursor - lastCursor;
+
+		// Looping from one end to the other is a move of one
+		if (mScrollLoop && mEntries.size() > 1 && abs(mCursorMove) == (int)mEntries.size() - 1)
+			mCursorMove = mCursorMove > 0 ? -1 : 1;
+	}
+
+	if (state == CURSOR_STOPPED)
+		preloadNextVideo();
+
 	mCameraDirection = direction ? -1.0 : 1.0;
 	mCamera = 0;
 
@@ -788,6 +820,25 @@ void ImageGridComponent<T>::onCursorChanged(const CursorState& state)
 }
 
 
+// The video of the tile the cursor is likely to go to next is opened while the current one plays
+template<typename T>
+void ImageGridComponent<T>::preloadNextVideo()
+{
+	if (!mAllowVideo || mTiles.empty() || mCursorMove == 0)
+		return;
+
+	int next = mCursor + mCursorMove;
+	if (mScrollLoop && mEntries.size() > 0)
+		next = (next + (int)mEntries.size()) % (int)mEntries.size();
+
+	if (next < 0 || next >= (int)mEntries.size() || next == mCursor)
+		return;
+
+	std::string videoPath = getEntryData(next).videoPath;
+	if (!videoPath.empty() && ResourceManager::getInstance()->fileExists(videoPath))
+		mTiles.front()->preloadVideo(videoPath);
+}
+
 template<typename T>
 void ImageGridComponent<T>::updateTiles(bool allowAnimation, bool updateSelectedState)
 {
@@ -833,14 +884,33 @@ void ImageGridComponent<T>::updateTiles(bool allowAnimation, bool updateSelected
 		i++; img++;
 	}
 	
-	// Collect new textures
+	// Collect new textures, and load them by distance from the cursor so visible tiles are sharp first
+	int dimOpposite = isVertical() ? mGridDimension.x() : mGridDimension.y();
+	if (dimOpposite < 1)
+		dimOpposite = 1;
+
+	int cursorTile = mCursor - mStartPosition + EXTRAITEMS * dimOpposite;
+
 	std::vector<std::shared_ptr<TextureResource>> newTextures;
+	std::vector<std::pair<std::shared_ptr<TextureResource>, int>> priorities;
 	for (int ti = 0; ti < (int)mTiles.size(); ti++)
 	{
-		newTextures.push_back(mTiles.at(ti)->getTexture(true));
-		newTextures.push_back(mTiles.at(ti)->getTexture(false));
+		int distance = std::max(std::abs(ti / dimOpposite - cursorTile / dimOpposite), std::abs(ti % dimOpposite - cursorTile % dimOpposite));
+
+		auto marquee = mTiles.at(ti)->getTexture(true);
+		auto image = mTiles.at(ti)->getTexture(false);
+
+		newTextures.push_back(marquee);
+		newTextures.push_back(image);
+
+		if (image != nullptr)
+			priorities.push_back(std::make_pair(image, distance * 2));
+		if (marquee != nullptr)
+			priorities.push_back(std::make_pair(marquee, distance * 2 + 1));
 	}
 
+	TextureResource::setLoadPriorities(priorities);
+
 	// Compare old texture with new textures -> Remove missing from async queue if existing
 	for (auto tex : previousTextures)
 	{
@@ -901,40 +971,41 @@ void ImageGridComponent<T>::updateTileAtPos(int tilePos, int imgPos, bool allowA
 		tile->setVisible(true);
 
 		std::string name = mEntries.at(imgPos).name;
+		const ImageGridData& data = getEntryData(imgPos);
 
-		if (!mEntries.at(imgPos).data.favorite || tile->hasFavoriteMedia())
+		if (!data.favorite || tile->hasFavoriteMedia())
 			tile->setLabel(name);
 		else
 			tile->setLabel(_U("\uF006 ") + name);
 
-		std::string imagePath = mEntries.at(imgPos).data.texturePath;
+		std::string imagePath = data.texturePath;
 
 		if (ResourceManager::getInstance()->fileExists(imagePath))
 		{
-			if (mEntries.at(imgPos).data.virtualFolder)
+			if (data.virtualFolder)
 				tile->setLabel(""); // _U("\uF114"));
 
-			tile->setImage(imagePath, mEntries.at(imgPos).data.virtualFolder);
+			tile->setImage(imagePath, data.virtualFolder);
 		}
-		else if (mEntries.at(imgPos).data.folder)
+		else if (data.folder)
 			tile->setImage(mDefaultFolderTexture, mDefaultFolderTexture == ":/folder.svg");
 		else
 			tile->setImage(mDefaultGameTexture, mDefaultGameTexture == ":/cartridge.svg");
 		
 		// Marquee
-		std::string marqueePath = mEntries.at(imgPos).data.marqueePath;
+		std::string marqueePath = data.marqueePath;
 
 		if (!marqueePath.empty() && ResourceManager::getInstance()->fileExists(marqueePath))
 			tile->setMarquee(marqueePath);
 		else
 			tile->setMarquee("");
 
-		tile->setFavorite(mEntries.at(imgPos).data.favorite);
+		tile->setFavorite(data.favorite);
 
 		// Video
 		if (mAllowVideo && imgPos == mCursor)
 		{			
-			std::string videoPath = mEntries.at(imgPos).data.videoPath;
+			std::string videoPath = data.videoPath;
 
 			if (!videoPath.empty() && ResourceManager::getInstance()->fileExists(videoPath))
 				tile->setVideo(videoPath, mVideoDelay);
@@ -8,10 +8,17 @@
 #include <vlc/vlc.h>
 #include <SDL_mutex.h>
 #include <cmath>
+#include <string.h>
 #include "SystemConf.h"
 #include "ThemeData.h"
 #include <SDL_timer.h>
 #include "AudioManager.h"
+#include "Log.h"
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <thread>
 
 #ifdef WIN32
 #include <codecvt>
@@ -23,16 +30,106 @@
 
 libvlc_instance_t* VideoVlcComponent::mVLC = NULL;
 
+// I420 surfaces : the Y plane, then the U & V planes at half the size
+static void getPlaneSize(const VideoContext* c, int plane, unsigned int& width, unsigned int& height)
+{
+	width = (plane == 0 ? c->width : (c->width + 1) / 2);
+	height = (plane == 0 ? c->height : (c->height + 1) / 2);
+}
+
+static size_t getSurfaceSize(const VideoContext* c)
+{
+	if (!c->yuv)
+		return c->width * c->height * 4;
+
+	unsigned int width, height;
+	getPlaneSize(c, 1, width, height);
+	return c->width * c->height + 2 * width * height;
+}
+
+VideoContext::VideoContext(unsigned int videoWidth, unsigned int videoHeight)
+{
+	// I420 is 1.5 bytes per pixel instead of 4 : less to copy for vlc and less to upload, the renderer converts it to RGB
+	yuv = Renderer::supportsYUV();
+	width = videoWidth;
+	height = videoHeight;
+
+	if (yuv)
+	{
+		// Chroma planes are subsampled by 2
+		width &= ~1;
+		height &= ~1;
+	}
+
+	size_t size = getSurfaceSize(this);
+	for (int i = 0; i < VIDEO_SURFACES; i++)
+		surfaces[i] = new unsigned char[size];
+
+	writing = -1;
+	ready = -1;
+	reading = -1;
+	component = nullptr;
+}
+
+VideoContext::~VideoContext()
+{
+	for (int i = 0; i < VIDEO_SURFACES; i++)
+		delete[] surfaces[i];
+}
+
+// VLC asks for the format of the frames. Returns the number of picture buffers
+static unsigned setup(void** data, char* chroma, unsigned* width, unsigned* height, unsigned* pitches, unsigned* lines)
+{
+	struct VideoContext *c = (struct VideoContext *)*data;
+
+	// VLC scales the video to the size we ask for
+	*width = c->width;
+	*height = c->height;
+
+	if (c->yuv)
+	{
+		memcpy(chroma, "I420", 4);
+
+		for (int plane = 0; plane < 3; plane++)
+			getPlaneSize(c, plane, pitches[plane], lines[plane]);
+	}
+	else
+	{
+		memcpy(chroma, "RGBA", 4);
+		pitches[0] = c->width * 4;
+		lines[0] = c->height;
+	}
+
+	return 1;
+}
+
 // VLC prepares to render a video frame.
 static void *lock(void *data, void **p_pixels) 
 {
 	struct VideoContext *c = (struct VideoContext *)data;
-	
-	int frame = (c->surfaceId ^ 1);
-	
-	c->mutexes[frame].lock();
-	c->hasFrame[frame] = false;
-	*p_pixels = c->surfaces[frame];
+
+	{
+		std::unique_lock<std::mutex> indexLock(c->mutex);
+
+		int frame = 0;
+		while (frame == c->ready || frame == c->reading)
+			frame++;
+
+		c->writing = frame;
+	}
+
+	unsigned char* surface = c->surfaces[c->writing];
+	p_pixels[0] = surface;
+
+	if (c->yuv)
+	{
+		unsigned int width, height;
+		getPlaneSize(c, 1, width, height);
+
+		p_pixels[1] = surface + c->width * c->height;
+		p_pixels[2] = surface + c->width * c->height + width * height;
+	}
+
 	return NULL; // Picture identifier, not needed here.
 }
 
@@ -41,11 +138,10 @@ static void unlock(void *data, void* /*id*/, void *const* /*p_pixels*/)
 {
 	struct VideoContext *c = (struct VideoContext *)data;
 
-	int frame = (c->surfaceId ^ 1);	
-
-	c->surfaceId = frame;
-	c->hasFrame[frame] = true;
-	c->mutexes[frame].unlock();
+	// A frame the ui thread didn't take in time is dropped
+	std::unique_lock<std::mutex> indexLock(c->mutex);
+	c->ready = c->writing;
+	c->writing = -1;
 }
 
 // VLC wants to display a video frame.
@@ -55,14 +151,402 @@ static void display(void* data, void* id)
 		return;
 
 	struct VideoContext *c = (struct VideoContext *)data;
-	if (c->valid && c->component != NULL && !c->component->isPlaying() && c->component->isWaitingForVideoToStart())
+	if (c->component != NULL && !c->component->isPlaying() && c->component->isWaitingForVideoToStart())
 		c->component->onVideoStarted();
 }
 
+// Video properties read by libvlc_media_parse, kept for the session : parsing reads the file and is the slowest part of the start
+struct VideoInfo
+{
+	VideoInfo() : width(0), height(0), hasAudio(false), duration(-1) { }
+
+	unsigned		width;
+	unsigned		height;
+	bool			hasAudio;
+	libvlc_time_t	duration;
+};
+
+static std::mutex sVideoInfosLock;
+static std::map<std::string, VideoInfo> sVideoInfos;
+
+// Media and player opened in background for a component.
+// The component leaves it when stopped before it's done, the opener then releases what it has created
+struct VideoOpenRequest
+{
+	VideoOpenRequest() : vlc(nullptr), preroll(false), maxWidth(0), maxHeight(0), memory(0), done(false), cancelled(false), media(nullptr), player(nullptr), context(nullptr) { }
+
+	libvlc_instance_t*			vlc;
+	std::string					path;
+	std::vector<std::string>	options;
+
+	// Pool requests : the player is started paused, its first frame is decoded in the context
+	bool						preroll;
+	unsigned int				maxWidth;	// 0 to keep the size of the video
+	unsigned int				maxHeight;
+	size_t						memory;
+
+	std::mutex					lock;
+	bool						done;
+	bool						cancelled;
+
+	libvlc_media_t*				media;
+	libvlc_media_player_t*		player;
+	VideoContext*				context;
+	VideoInfo					info;
+};
+
+// Releases what the request holds, or lets the opener do it when it's not done yet
+static void releaseRequest(const std::shared_ptr<VideoOpenRequest>& request)
+{
+	std::unique_lock<std::mutex> lock(request->lock);
+
+	if (!request->done)
+	{
+		request->cancelled = true;
+		return;
+	}
+
+	if (request->player)
+	{
+		// A pre-rolled player writes in the context until it's stopped
+		if (request->context)
+			libvlc_media_player_stop(request->player);
+
+		libvlc_media_player_release(request->player);
+	}
+
+	if (request->media)
+		libvlc_media_release(request->media);
+
+	delete request->context;
+
+	request->player = nullptr;
+	request->media = nullptr;
+	request->context = nullptr;
+}
+
+// Single thread opening the medias one after the other, so scrolling a list doesn't start a parse per item at the same time
+class VideoOpener
+{
+public:
+	static VideoOpener& getInstance()
+	{
+		static VideoOpener instance;
+		return instance;
+	}
+
+	// Videos to show now go before the ones opened ahead of time
+	void open(const std::shared_ptr<VideoOpenRequest>& request, bool urgent = true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mLock);
+
+			if (urgent)
+				mRequests.push_front(request);
+			else
+				mRequests.push_back(request);
+
+			if (!mThread.joinable())
+				mThread = std::thread(&VideoOpener::run, this);
+		}
+
+		mEvent.notify_one();
+	}
+
+private:
+	VideoOpener() : mExit(false) { }
+
+	~VideoOpener()
+	{
+		{
+			std::unique_lock<std::mutex> lock(mLock);
+			mExit = true;
+		}
+
+		mEvent.notify_one();
+
+		if (mThread.joinable())
+			mThread.join();
+	}
+
+	void run()
+	{
+		while (true)
+		{
+			std::shared_ptr<VideoOpenRequest> request;
+
+			{
+				std::unique_lock<std::mutex> lock(mLock);
+				mEvent.wait(lock, [this] { return mExit || !mRequests.empty(); });
+				if (mExit)
+					break;
+
+				request = mRequests.front();
+				mRequests.pop_front();
+			}
+
+			process(request);
+		}
+	}
+
+	static libvlc_media_t* createMedia(const std::shared_ptr<VideoOpenRequest>& request, bool startPaused)
+	{
+		libvlc_media_t* media = libvlc_media_new_path(request->vlc, request->path.c_str());
+		if (media)
+		{
+			for (auto option : request->options)
+				libvlc_media_add_option(media, option.c_str());
+
+			if (startPaused)
+				libvlc_media_add_option(media, ":start-paused");
+		}
+
+		return media;
+	}
+
+	void process(const std::shared_ptr<VideoOpenRequest>& request)
+	{
+		{
+			// Pool requests are queued again when a component needs them : the first pass did the job
+			std::unique_lock<std::mutex> lock(request->lock);
+			if (request->cancelled || request->done)
+				return;
+		}
+
+		int startTime = SDL_GetTicks();
+
+		VideoInfo info;
+		libvlc_media_player_t* player = nullptr;
+		VideoContext* context = nullptr;
+
+		libvlc_media_t* media = createMedia(request, false);
+		if (media)
+		{
+			bool parsed = false;
+
+			{
+				std::unique_lock<std::mutex> lock(sVideoInfosLock);
+
+				auto it = sVideoInfos.find(request->path);
+				if (it != sVideoInfos.cend())
+				{
+					info = it->second;
+					parsed = true;
+				}
+			}
+
+			if (!parsed)
+			{
+				// Get the media metadata so we can find the aspect ratio
+				libvlc_media_parse(media);
+
+				libvlc_media_track_t** tracks;
+				unsigned track_count = libvlc_media_tracks_get(media, &tracks);
+				for (unsigned track = 0; track < track_count; ++track)
+				{
+					if (tracks[track]->i_type == libvlc_track_audio)
+						info.hasAudio = true;
+					else if (tracks[track]->i_type == libvlc_track_video && info.width == 0)
+					{
+						info.width = tracks[track]->video->i_width;
+						info.height = tracks[track]->video->i_height;
+					}
+				}
+				libvlc_media_tracks_release(tracks, track_count);
+
+				info.duration = libvlc_media_get_duration(media);
+
+				std::unique_lock<std::mutex> lock(sVideoInfosLock);
+				sVideoInfos[request->path] = info;
+			}
+
+			// Make sure we found a valid video track
+			if (info.width > 0 && info.height > 0 && request->preroll)
+			{
+				// The player gets a media of its own, started paused : the decoders are created and the first frame decoded, without any sound.
+				// The first media is kept for the loops
+				libvlc_media_t* prerollMedia = createMedia(request, true);
+				if (prerollMedia)
+				{
+					player = libvlc_media_player_new_from_media(prerollMedia);
+					libvlc_media_release(prerollMedia);
+				}
+
+				if (player)
+				{
+					Vector2i size(info.width, info.height);
+					if (request->maxWidth > 0 && request->maxHeight > 0)
+					{
+						auto sz = ImageIO::adjustPictureSize(size, Vector2i(request->maxWidth, request->maxHeight), false);
+						if (sz.x() < size.x() || sz.y() < size.y())
+							size = sz;
+					}
+
+					context = new VideoContext(size.x(), size.y());
+
+					libvlc_video_set_callbacks(player, lock, unlock, display, (void*)context);
+					libvlc_video_set_format_callbacks(player, setup, nullptr);
+					libvlc_media_player_play(player);
+				}
+			}
+			else if (info.width > 0 && info.height > 0)
+				player = libvlc_media_player_new_from_media(media);
+		}
+
+		LOG(LogDebug) << "VideoVlcComponent : opened " << request->path << (request->preroll ? " ahead" : "") << " in " << (SDL_GetTicks() - startTime) << "ms";
+
+		std::unique_lock<std::mutex> lock(request->lock);
+
+		if (request->cancelled)
+		{
+			if (player)
+			{
+				if (context)
+					libvlc_media_player_stop(player);
+
+				libvlc_media_player_release(player);
+			}
+
+			if (media)
+				libvlc_media_release(media);
+
+			delete context;
+			return;
+		}
+
+		request->media = media;
+		request->player = player;
+		request->context = context;
+		request->info = info;
+		request->done = true;
+	}
+
+	std::mutex									mLock;
+	std::condition_variable						mEvent;
+	std::list<std::shared_ptr<VideoOpenRequest>> mRequests;
+	std::thread									mThread;
+	bool										mExit;
+};
+
+// Videos opened ahead of time, oldest first. Only used by the ui thread
+#define VIDEO_POOL_SIZE 2
+
+static std::list<std::shared_ptr<VideoOpenRequest>> sVideoPool;
+
+void VideoVlcComponent::preloadVideo(const std::string& path, const Vector2f& maxSize)
+{
+	// Decoding ahead costs cpu while the user may do nothing : not when the power saver is at its strongest
+	if (mVLC == nullptr || path.empty() || !PowerSaver::isPreloadAllowed())
+		return;
+
+#ifdef WIN32
+	std::string vlcPath(Utils::String::replace(path, "/", "\\"));
+#else
+	std::string vlcPath(path);
+#endif
+
+	for (auto it = sVideoPool.begin(); it != sVideoPool.end(); ++it)
+	{
+		if ((*it)->path == vlcPath)
+		{
+			// Most recent last
+			auto request = *it;
+			sVideoPool.erase(it);
+			sVideoPool.push_back(request);
+			return;
+		}
+	}
+
+	Vector2f size = maxSize;
+	if (size.x() <= 0 || size.y() <= 0)
+		size = Vector2f(Renderer::getScreenWidth(), Renderer::getScreenHeight());
+
+	// Surfaces of the largest picture it can be, the decoder buffers are counted as much again
+	size_t memory = (size_t)(size.x() * size.y() * (Renderer::supportsYUV() ? 1.5 : 4)) * VIDEO_SURFACES * 2;
+	size_t maxMemory = (size_t)Math::max(0, Settings::getInstance()->getInt("VideoPreloadMaxMemory")) * 1024 * 1024;
+
+	if (memory > maxMemory)
+		return;
+
+	size_t used = memory;
+	for (auto request : sVideoPool)
+		used += request->memory;
+
+	while (!sVideoPool.empty() && (used > maxMemory || sVideoPool.size() >= VIDEO_POOL_SIZE))
+	{
+		used -= sVideoPool.front()->memory;
+		releaseRequest(sVideoPool.front());
+		sVideoPool.pop_front();
+	}
+
+	auto request = std::make_shared<VideoOpenRequest>();
+	request->vlc = mVLC;
+	request->path = vlcPath;
+	request->preroll = true;
+	request->memory = memory;
+
+	if (Settings::getInstance()->getBool("OptimizeVideo"))
+	{
+		request->maxWidth = (unsigned int)size.x();
+		request->maxHeight = (unsigned int)size.y();
+	}
+
+	std::string options = SystemConf::getInstance()->get("vlc.options");
+	if (!options.empty())
+		request->options = Utils::String::split(options, ' ');
+
+	sVideoPool.push_back(request);
+	VideoOpener::getInstance().open(request, false);
+}
+
+void VideoVlcComponent::cancelPreload(const std::string& path)
+{
+#ifdef WIN32
+	std::string vlcPath(Utils::String::replace(path, "/", "\\"));
+#else
+	std::string vlcPath(path);
+#endif
+
+	for (auto it = sVideoPool.begin(); it != sVideoPool.end(); ++it)
+	{
+		if ((*it)->path == vlcPath)
+		{
+			releaseRequest(*it);
+			sVideoPool.erase(it);
+			return;
+		}
+	}
+}
+
+void VideoVlcComponent::clearPreloadedVideos()
+{
+	for (auto request : sVideoPool)
+		releaseRequest(request);
+
+	sVideoPool.clear();
+}
+
+// Takes the request of a video opened ahead of time, nullptr if there is none
+static std::shared_ptr<VideoOpenRequest> takePreloadedVideo(const std::string& path)
+{
+	for (auto it = sVideoPool.begin(); it != sVideoPool.end(); ++it)
+	{
+		if ((*it)->path == path)
+		{
+			auto request = *it;
+			sVideoPool.erase(it);
+			return request;
+		}
+	}
+
+	return nullptr;
+}
+
 VideoVlcComponent::VideoVlcComponent(Window* window, std::string subtitles) :
 	VideoComponent(window),
 	mMediaPlayer(nullptr), 
-	mMedia(nullptr)
+	mMedia(nullptr),
+	mContext(nullptr)
 {
 	mElapsed = 0;
 	mColorShift = 0xFFFFFFFF;
@@ -70,6 +554,9 @@ VideoVlcComponent::VideoVlcComponent(Window* window, std::string subtitles) :
 	mLoops = -1;
 	mCurrentLoop = 0;
 
+	mUploadedFrames = 0;
+	mUploadTime = 0;
+
 	// Get an empty texture for rendering the video
 	mTexture = nullptr;// TextureResource::get("");
 	mEffect = VideoVlcFlags::VideoVlcEffect::BUMP;
@@ -203,11 +690,13 @@ void VideoVlcComponent::render(const Transform4x4f& parentTrans)
 	if (!isVisible())
 		return;
 
+	completeVideoStart();
+
 	VideoComponent::render(parentTrans);
 
 	bool initFromPixels = true;
 
-	if (!mIsPlaying || !mContext.valid)
+	if (!mIsPlaying || mContext == nullptr)
 	{
 		// If video is still attached to the path & texture is initialized, we suppose it had just been stopped (onhide, ondisable, screensaver...)
 		// still render the last frame
@@ -240,30 +729,13 @@ void VideoVlcComponent::render(const Transform4x4f& parentTrans)
 
 	// Build a texture for the video frame
 	if (initFromPixels)
-	{		
-		int frame = mContext.surfaceId;
-		if (mContext.hasFrame[frame])
-		{
-			if (mTexture == nullptr)
-			{
-				mTexture = TextureResource::get("");
-				resize();
-			}
-
+	{
 #ifdef _RPI_
-			// Rpi : A lot of videos are encoded in 60fps on screenscraper
-			// Try to limit transfert to opengl textures to 30fps to save CPU
-			if (!Settings::getInstance()->getBool("OptimizeVideo") || mElapsed >= 40) // 40ms = 25fps, 33.33 = 30 fps
+		// Rpi : A lot of videos are encoded in 60fps on screenscraper
+		// Try to limit transfert to opengl textures to 30fps to save CPU
+		if (!Settings::getInstance()->getBool("OptimizeVideo") || mElapsed >= 40) // 40ms = 25fps, 33.33 = 30 fps
 #endif
-			{
-				mContext.mutexes[frame].lock();
-				mTexture->initFromExternalPixels(mContext.surfaces[frame], mVideoWidth, mVideoHeight);
-				mContext.hasFrame[frame] = false;
-				mContext.mutexes[frame].unlock();
-
-				mElapsed = 0;
-			}
-		}
+			uploadFrame();
 	}
 
 	if (mTexture == nullptr)
@@ -337,7 +809,7 @@ void VideoVlcComponent::render(const Transform4x4f& parentTrans)
 	for(int i = 0; i < 4; ++i)
 		vertices[i].pos.round();
 	
-	if (mTexture->bind())
+	if (bindFrame())
 	{
 		Vector2f targetSizePos = (mTargetSize - mSize) * mOrigin * -1;
 
@@ -366,7 +838,7 @@ void VideoVlcComponent::render(const Transform4x4f& parentTrans)
 			float radius = Math::max(size_x, size_y) * mRoundCorners;
 			Renderer::enableRoundCornerStencil(x, y, size_x, size_y, radius);
 
-			mTexture->bind();
+			bindFrame();
 		}
 
 		// Render it
@@ -382,40 +854,108 @@ void VideoVlcComponent::render(const Transform4x4f& parentTrans)
 	}
 }
 
+void VideoVlcComponent::uploadFrame()
+{
+	int frame;
+
+	{
+		std::unique_lock<std::mutex> lock(mContext->mutex);
+		if (mContext->ready < 0)
+			return;
+
+		frame = mContext->reading = mContext->ready;
+		mContext->ready = -1;
+	}
+
+	if (mTexture == nullptr)
+	{
+		mTexture = TextureResource::get("");
+		resize();
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+
+	unsigned char* surface = mContext->surfaces[frame];
+
+	if (mContext->yuv)
+	{
+		for (int i = 0; i < 2; i++)
+			if (mChroma[i] == nullptr)
+				mChroma[i] = TextureResource::get("");
+
+		unsigned int width, height;
+		getPlaneSize(mContext, 1, width, height);
+
+		mTexture->initFromExternalPixels(surface, mContext->width, mContext->height, Renderer::Texture::ALPHA);
+		mChroma[0]->initFromExternalPixels(surface + mContext->width * mContext->height, width, height, Renderer::Texture::ALPHA);
+		mChroma[1]->initFromExternalPixels(surface + mContext->width * mContext->height + width * height, width, height, Renderer::Texture::ALPHA);
+	}
+	else
+		mTexture->initFromExternalPixels(surface, mContext->width, mContext->height);
+
+	{
+		std::unique_lock<std::mutex> lock(mContext->mutex);
+		mContext->reading = -1;
+	}
+
+	mUploadedFrames++;
+	mUploadTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+	mElapsed = 0;
+}
+
+bool VideoVlcComponent::bindFrame()
+{
+	if (mChroma[0] == nullptr || mChroma[1] == nullptr)
+		return mTexture->bind();
+
+	unsigned int y = mTexture->getTextureId();
+	unsigned int u = mChroma[0]->getTextureId();
+	unsigned int v = mChroma[1]->getTextureId();
+
+	if (y == 0 || u == 0 || v == 0)
+		return false;
+
+	Renderer::bindYUVTextures(y, u, v);
+	return true;
+}
+
 void VideoVlcComponent::setupContext()
 {
-	if (mContext.valid)
+	if (mContext != nullptr)
 		return;
-	
-	// Create an RGBA surface to render the video into
-	mContext.surfaces[0] = new unsigned char[mVideoWidth * mVideoHeight * 4];
-	mContext.surfaces[1] = new unsigned char[mVideoWidth * mVideoHeight * 4];
-	mContext.hasFrame[0] = false;	
-	mContext.hasFrame[1] = false;
-	mContext.component = this;
-	mContext.valid = true;	
+
+	// Create the surfaces to render the video into
+	mContext = new VideoContext(mVideoWidth, mVideoHeight);
+	mContext->component = this;
+
+	mUploadedFrames = 0;
+	mUploadTime = 0;
+
 	resize();	
 }
 
 void VideoVlcComponent::freeContext()
 {
-	if (!mContext.valid)
+	if (mContext == nullptr)
 		return;
 
+	if (mUploadedFrames > 0)
+	{
+		LOG(LogDebug) << "VideoVlcComponent : " << mUploadedFrames << " frames of " << mContext->width << "x" << mContext->height << (mContext->yuv ? " I420" : " RGBA")
+			<< ", " << (mUploadTime / mUploadedFrames) << "ms per upload";
+	}
+
 	if (!mDisable)
 	{
 		// Release texture memory -> except if mDisable by topWindow ( ex: menu was poped )
 		mTexture = nullptr;
+		mChroma[0] = nullptr;
+		mChroma[1] = nullptr;
 	}
 
-	delete[] mContext.surfaces[0];
-	delete[] mContext.surfaces[1];
-	mContext.surfaces[0] = nullptr;
-	mContext.surfaces[1] = nullptr;	
-	mContext.hasFrame[0] = false;
-	mContext.hasFrame[1] = false;
-	mContext.component = NULL;
-	mContext.valid = false;			
+	delete mContext;
+	mContext = nullptr;
 }
 
 void VideoVlcComponent::setupVLC(std::string subtitles)
@@ -527,7 +1067,7 @@ void VideoVlcComponent::handleLooping()
 
 void VideoVlcComponent::startVideo()
 {
-	if (mIsPlaying)
+	if (mIsPlaying || mOpenRequest != nullptr)
 		return;
 
 	mCurrentLoop = 0;
@@ -545,126 +1085,164 @@ void VideoVlcComponent::startVideo()
 		// Set the video that we are going to be playing so we don't attempt to restart it
 		mPlayingVideoPath = mVideoPath;
 
-		// Open the media
-		mMedia = libvlc_media_new_path(mVLC, path.c_str());
-		if (mMedia)
-		{			
-			// use : vlc long-help
-			// WIN32 ? libvlc_media_add_option(mMedia, ":avcodec-hw=dxva2");
-			// RPI/OMX ? libvlc_media_add_option(mMedia, ":codec=mediacodec,iomx,all"); .
+		// Opened ahead of time by the grid or the screensaver : its first frame may already be decoded
+		auto preloaded = mPlaylist == nullptr ? takePreloadedVideo(path) : nullptr;
+		if (preloaded != nullptr)
+		{
+			// Keep the snapshot until the first frame is decoded
+			mFadeIn = 0.0f;
+
+			mOpenRequest = preloaded;
+
+			bool done;
 
-			std::string options = SystemConf::getInstance()->get("vlc.options");
-			if (!options.empty())
 			{
-				std::vector<std::string> tokens = Utils::String::split(options, ' ');
-				for (auto token : tokens)
-					libvlc_media_add_option(mMedia, token.c_str());
+				std::unique_lock<std::mutex> lock(preloaded->lock);
+				done = preloaded->done;
 			}
-			
-			// If we have a playlist : most videos have a fader, skip it 1 second
-			if (mPlaylist != nullptr && mConfig.startDelay == 0 && !mConfig.showSnapshotDelay && !mConfig.showSnapshotNoVideo)
-				libvlc_media_add_option(mMedia, ":start-time=0.7");			
-
-			bool hasAudioTrack = false;
-
-			unsigned track_count;
-			// Get the media metadata so we can find the aspect ratio
-			libvlc_media_parse(mMedia);
-			libvlc_media_track_t** tracks;
-			track_count = libvlc_media_tracks_get(mMedia, &tracks);
-			for (unsigned track = 0; track < track_count; ++track)
-			{
-				if (tracks[track]->i_type == libvlc_track_audio)
-					hasAudioTrack = true;
-				else if (tracks[track]->i_type == libvlc_track_video)
-				{
-					mVideoWidth = tracks[track]->video->i_width;
-					mVideoHeight = tracks[track]->video->i_height;		
 
-					if (hasAudioTrack)
-						break;
-				}
-			}
-			libvlc_media_tracks_release(tracks, track_count);
+			if (done)
+				completeVideoStart();
+			else
+				VideoOpener::getInstance().open(preloaded);
 
-			// Make sure we found a valid video track
-			if ((mVideoWidth > 0) && (mVideoHeight > 0))
-			{			
-				if (Settings::getInstance()->getBool("OptimizeVideo"))
-				{
-					// Avoid videos bigger than resolution
-					Vector2f maxSize(Renderer::getScreenWidth(), Renderer::getScreenHeight());
-										
-#ifdef _RPI_
-					// Temporary -> RPI -> Try to limit videos to 400x300 for performance benchmark
-					if (!Renderer::isSmallScreen())
-						maxSize = Vector2f(400, 300);
-#endif
+			return;
+		}
 
-					if (!mTargetSize.empty() && (mTargetSize.x() < maxSize.x() || mTargetSize.y() < maxSize.y()))
-						maxSize = mTargetSize;
+		// The media is opened & parsed by the opener thread, completeVideoStart plays it when it's ready
+		auto request = std::make_shared<VideoOpenRequest>();
+		request->vlc = mVLC;
+		request->path = path;
 
-					
+		// use : vlc --long-help
+		// WIN32 ? libvlc_media_add_option(mMedia, ":avcodec-hw=dxva2");
+		// RPI/OMX ? libvlc_media_add_option(mMedia, ":codec=mediacodec,iomx,all"); .
 
-					// If video is bigger than display, ask VLC for a smaller image
-					auto sz = ImageIO::adjustPictureSize(Vector2i(mVideoWidth, mVideoHeight), Vector2i(maxSize.x(), maxSize.y()), mTargetIsMin);
-					if (sz.x() < mVideoWidth || sz.y() < mVideoHeight)
-					{
-						mVideoWidth = sz.x();
-						mVideoHeight = sz.y();
-					}
-				}
+		std::string options = SystemConf::getInstance()->get("vlc.options");
+		if (!options.empty())
+			request->options = Utils::String::split(options, ' ');
 
-				PowerSaver::pause();
-				setupContext();
+		// If we have a playlist : most videos have a fader, skip it 1 second
+		if (mPlaylist != nullptr && mConfig.startDelay == 0 && !mConfig.showSnapshotDelay && !mConfig.showSnapshotNoVideo)
+			request->options.push_back(":start-time=0.7");
 
-				// Setup the media player
-				mMediaPlayer = libvlc_media_player_new_from_media(mMedia);
-			
-				if (hasAudioTrack)
-				{
-					if (!Settings::getInstance()->getBool("VideoAudio"))
-						libvlc_audio_set_mute(mMediaPlayer, 1);
-					else
-						AudioManager::setVideoPlaying(true);
-				}
+		// Keep the snapshot until the first frame is decoded
+		mFadeIn = 0.0f;
 
-				libvlc_media_player_play(mMediaPlayer);
-				libvlc_video_set_callbacks(mMediaPlayer, lock, unlock, display, (void*)&mContext);
-				libvlc_video_set_format(mMediaPlayer, "RGBA", (int)mVideoWidth, (int)mVideoHeight, (int)mVideoWidth * 4);
-				/*
-				if (true) // test wait video stream
-				{
-					int ps_time = SDL_GetTicks();
+		mOpenRequest = request;
+		VideoOpener::getInstance().open(request);
+	}
+}
 
-					int frame = mContext.surfaceId;
+void VideoVlcComponent::completeVideoStart()
+{
+	if (mOpenRequest == nullptr)
+		return;
 
-					int cnt = 0;
-					while (cnt < 5)
-					{
-						int id = mContext.surfaceId;
+	VideoInfo info;
 
-						if (frame != id)
-						{
-							cnt++;
-							frame = id;
-						}
-						::_sleep(2);
+	{
+		std::unique_lock<std::mutex> lock(mOpenRequest->lock);
+		if (!mOpenRequest->done)
+			return;
 
-						if (SDL_GetTicks() - ps_time > 300)
-							break;
-					}
+		mMedia = mOpenRequest->media;
+		mMediaPlayer = mOpenRequest->player;
+		mContext = mOpenRequest->context;
+		info = mOpenRequest->info;
 
-					mFadeIn = 1.0f;
-					mElapsed = 1000;
-				}*/
+		mOpenRequest->media = nullptr;
+		mOpenRequest->player = nullptr;
+		mOpenRequest->context = nullptr;
+	}
 
-				// Update the playing state -> Useless now set by display() & onVideoStarted
-				//mIsPlaying = true;
-				//mFadeIn = 0.0f;
-			}
+	mOpenRequest = nullptr;
+
+	// Make sure we found a valid video track
+	if (mMediaPlayer == nullptr)
+		return;
+
+	if (mContext != nullptr)
+	{
+		// Pre-rolled : the player is paused on its first frame, already sized
+		mContext->component = this;
+		mVideoWidth = mContext->width;
+		mVideoHeight = mContext->height;
+
+		mUploadedFrames = 0;
+		mUploadTime = 0;
+
+		PowerSaver::pause();
+		resize();
+
+		if (info.hasAudio)
+		{
+			if (!Settings::getInstance()->getBool("VideoAudio"))
+				libvlc_audio_set_mute(mMediaPlayer, 1);
+			else
+				AudioManager::setVideoPlaying(true);
+		}
+
+		libvlc_media_player_set_pause(mMediaPlayer, 0);
+
+		bool ready;
+
+		{
+			std::unique_lock<std::mutex> lock(mContext->mutex);
+			ready = mContext->ready >= 0;
 		}
+
+		// display() was called before there was a component to notify
+		if (ready && !isPlaying() && isWaitingForVideoToStart())
+			onVideoStarted();
+
+		return;
 	}
+
+	mVideoWidth = info.width;
+	mVideoHeight = info.height;
+
+	if (Settings::getInstance()->getBool("OptimizeVideo"))
+	{
+		// Avoid videos bigger than resolution
+		Vector2f maxSize(Renderer::getScreenWidth(), Renderer::getScreenHeight());
+
+#ifdef _RPI_
+		// Temporary -> RPI -> Try to limit videos to 400x300 for performance benchmark
+		if (!Renderer::isSmallScreen())
+			maxSize = Vector2f(400, 300);
+#endif
+
+		if (!mTargetSize.empty() && (mTargetSize.x() < maxSize.x() || mTargetSize.y() < maxSize.y()))
+			maxSize = mTargetSize;
+
+		// If video is bigger than display, ask VLC for a smaller image
+		auto sz = ImageIO::adjustPictureSize(Vector2i(mVideoWidth, mVideoHeight), Vector2i(maxSize.x(), maxSize.y()), mTargetIsMin);
+		if (sz.x() < mVideoWidth || sz.y() < mVideoHeight)
+		{
+			mVideoWidth = sz.x();
+			mVideoHeight = sz.y();
+		}
+	}
+
+	PowerSaver::pause();
+	setupContext();
+
+	if (info.hasAudio)
+	{
+		if (!Settings::getInstance()->getBool("VideoAudio"))
+			libvlc_audio_set_mute(mMediaPlayer, 1);
+		else
+			AudioManager::setVideoPlaying(true);
+	}
+
+	libvlc_video_set_callbacks(mMediaPlayer, lock, unlock, display, (void*)mContext);
+	libvlc_video_set_format_callbacks(mMediaPlayer, setup, nullptr);
+	libvlc_media_player_play(mMediaPlayer);
+
+	// Update the playing state -> Useless now set by display() & onVideoStarted
+	//mIsPlaying = true;
+	//mFadeIn = 0.0f;
 }
 
 void VideoVlcComponent::stopVideo()
@@ -673,6 +1251,12 @@ void VideoVlcComponent::stopVideo()
 	mIsWaitingForVideoToStart = false;
 	mStartDelayed = false;
 
+	// Leave the media being opened, the opener releases it
+	if (mOpenRequest != nullptr)
+		releaseRequest(mOpenRequest);
+
+	mOpenRequest = nullptr;
+
 	// Release the media player so it stops calling back to us
 	if (mMediaPlayer)
 	{
@@ -731,6 +1315,8 @@ void VideoVlcComponent::update(int deltaTime)
 {
 	mElapsed += deltaTime;
 	VideoComponent::update(deltaTime);	
+
+	completeVideoStart();
 }
 
 void VideoVlcComponent::onHide()
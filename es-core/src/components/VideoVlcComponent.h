@@ -3,32 +3,35 @@
 #define ES_CORE_COMPONENTS_VIDEO_VLC_COMPONENT_H
 
 #include "VideoComponent.h"
+#include <memory>
 #include <mutex>
 
 struct libvlc_instance_t;
 struct libvlc_media_t;
 struct libvlc_media_player_t;
+struct VideoOpenRequest;
+
+// Frames are decoded into a ring of surfaces : vlc takes one that is neither the last complete frame nor the one being uploaded,
+// so the decoder and the ui thread never wait for each other. The mutex only guards the indexes
+#define VIDEO_SURFACES 3
 
 struct VideoContext 
 {
-	VideoContext()
-	{
-		surfaces[0] = nullptr;
-		surfaces[1] = nullptr;
-		component = nullptr;
-		valid = false;
-		hasFrame[0] = false;
-		hasFrame[1] = false;
-		surfaceId = 0;
-	}
-
-	int					surfaceId;
-	unsigned char*		surfaces[2];	
-	std::mutex			mutexes[2];
-	bool				hasFrame[2];
-
-	VideoComponent*		component;
-	bool				valid;	
+	// Allocates the surfaces, I420 when the renderer can convert it
+	VideoContext(unsigned int videoWidth, unsigned int videoHeight);
+	~VideoContext();
+
+	unsigned char*		surfaces[VIDEO_SURFACES];
+	int					writing;
+	int					ready;		// Last complete frame, -1 once taken by the ui thread
+	int					reading;
+	std::mutex			mutex;
+
+	bool				yuv;		// I420 planes instead of RGBA pixels
+	unsigned int		width;
+	unsigned int		height;
+
+	VideoComponent*		component;	// nullptr while pre-rolled in the pool
 };
 
 
@@ -57,6 +60,12 @@ class VideoVlcComponent : public VideoComponent
 public:
 	static void setupVLC(std::string subtitles);
 
+	// Opens a video, up to its first frame, so a component showing it next starts at once. Kept in a small pool, within "VideoPreloadMaxMemory".
+	// maxSize : size it will be displayed at, empty for the screen
+	static void preloadVideo(const std::string& path, const Vector2f& maxSize = Vector2f(0, 0));
+	static void cancelPreload(const std::string& path);
+	static void clearPreloadedVideos();
+
 	VideoVlcComponent(Window* window, std::string subtitles="");
 	virtual ~VideoVlcComponent();
 
@@ -94,17 +103,26 @@ private:
 
 	virtual void onVideoStarted();
 
+	// Plays the media opened in background once it's ready. Called each frame while waiting for it
+	void completeVideoStart();
+
 	void setupContext();
 	void freeContext();
 
+	// Uploads the frame last decoded by vlc, if any
+	void uploadFrame();
+	bool bindFrame();
+
 	void setEffect(VideoVlcFlags::VideoVlcEffect effect) { mEffect = effect; }
 
 private:
 	static libvlc_instance_t*		mVLC;
 	libvlc_media_t*					mMedia;
 	libvlc_media_player_t*			mMediaPlayer;
-	VideoContext					mContext;
-	std::shared_ptr<TextureResource> mTexture;
+	std::shared_ptr<VideoOpenRequest> mOpenRequest;
+	VideoContext*					mContext;
+	std::shared_ptr<TextureResource> mTexture;		// Rgba frame, or the Y plane
+	std::shared_ptr<TextureResource> mChroma[2];	// U & V planes of yuv frames
 
 	std::string					    mSubtitlePath;
 	std::string					    mSubtitleTmpFile;
@@ -116,6 +134,9 @@ private:
 
 	int								mCurrentLoop;
 	int								mLoops;
+
+	int								mUploadedFrames;
+	double							mUploadTime;
 };
 
 #endif // ES_CORE_COMPONENTS_VIDEO_VLC_COMPONENT_H
@@ -1,5 +1,6 @@
 #include "renderers/Renderer.h"
 
+#include "math/Misc.h"
 #include "math/Transform4x4f.h"
 #include "math/Vector2i.h"
 #include "resources/ResourceManager.h"
@@ -8,7 +9,9 @@
 #include "Settings.h"
 
 #include <SDL.h>
+#include <cmath>
 #include <stack>
+#include <vector>
 
 namespace Renderer
 {
@@ -25,16 +28,38 @@ namespace Renderer
 	static int              screenRotate       = 0;
 	static bool             initialCursorState = 1;
 
+	static Transform4x4f    currentMatrix      = Transform4x4f::Identity();
+	static bool             currentIdentity    = true;
+	static unsigned int     currentTexture     = 0;
+	static Vector4f         currentRegion      = Vector4f(0, 0, 1, 1);
+	static bool             currentFullRegion  = true;
+	static unsigned int     currentChromaU     = 0;
+	static unsigned int     currentChromaV     = 0;
+
+	static std::vector<Vertex> batchVertices;
+	static std::vector<Vertex> transformedVertices;
+	static Primitive::Type  batchType          = Primitive::TRIANGLES;
+	static unsigned int     batchTexture       = 0;
+	static Blend::Factor    batchSrcBlend      = Blend::SRC_ALPHA;
+	static Blend::Factor    batchDstBlend      = Blend::ONE_MINUS_SRC_ALPHA;
+	static unsigned int     batchChromaU       = 0;
+	static unsigned int     batchChromaV       = 0;
+
+	static FrameStats       frameStats;
+	static FrameStats       lastFrameStats;
+	static unsigned int     frameCount         = 0;
+
+	#define MAX_BATCH_VERTICES 65535
+
 	static void setIcon()
 	{
 		size_t                     width   = 0;
 		size_t                     height  = 0;
 		ResourceData               resData = ResourceManager::getInstance()->getFileData(":/window_icon_256.png");
-		unsigned char*             rawData = ImageIO::loadFromMemoryRGBA32(resData.ptr.get(), resData.length, width, height);
+		unsigned char*             rawData = ImageIO::loadFromMemoryRGBA32(resData.ptr.get(), resData.length, width, height, nullptr, nullptr, nullptr, true);
 
 		if(rawData != nullptr)
 		{
-			ImageIO::flipPixelsVert(rawData, width, height);
 
 #if SDL_BYTEORDER == SDL_BIG_ENDIAN
 			unsigned int rmask = 0xFF000000;
@@ -242,6 +267,204 @@ namespace Renderer
 
 	} // popClipRect
 
+	void bindTexture(const unsigned int _texture)
+	{
+		// Only applied when something is drawn
+		currentTexture    = _texture;
+		currentRegion     = Vector4f(0, 0, 1, 1);
+		currentFullRegion = true;
+		currentChromaU    = 0;
+		currentChromaV    = 0;
+
+	} // bindTexture
+
+	void bindTexture(const unsigned int _texture, const Vector4f& _region)
+	{
+		currentTexture    = _texture;
+		currentRegion     = _region;
+		currentFullRegion = (_region.x() == 0 && _region.y() == 0 && _region.z() == 1 && _region.w() == 1);
+		currentChromaU    = 0;
+		currentChromaV    = 0;
+
+	} // bindTexture
+
+	void bindYUVTextures(const unsigned int _y, const unsigned int _u, const unsigned int _v)
+	{
+		currentTexture    = _y;
+		currentRegion     = Vector4f(0, 0, 1, 1);
+		currentFullRegion = true;
+		currentChromaU    = _u;
+		currentChromaV    = _v;
+
+	} // bindYUVTextures
+
+	void setMatrix(const Transform4x4f& _matrix)
+	{
+		currentMatrix = _matrix;
+		currentMatrix.round();
+
+		const float* tm = (float*)&currentMatrix;
+		currentIdentity = (tm[0] == 1 && tm[1] == 0 && tm[4] == 0 && tm[5] == 1 && tm[12] == 0 && tm[13] == 0);
+
+	} // setMatrix
+
+	static const Vertex* transformVertices(const Vertex* _vertices, const unsigned int _numVertices)
+	{
+		if(currentIdentity && currentFullRegion)
+			return _vertices;
+
+		// 2D transform only : components never rotate around X or Y, so z stays 0 with the orthographic projection
+		const float* tm = (float*)&currentMatrix;
+
+		transformedVertices.resize(_numVertices);
+
+		for(unsigned int i = 0; i < _numVertices; ++i)
+		{
+			const Vertex& vertex = _vertices[i];
+			Vertex&       target = transformedVertices[i];
+
+			target.pos = Vector2f(tm[0] * vertex.pos.x() + tm[4] * vertex.pos.y() + tm[12], tm[1] * vertex.pos.x() + tm[5] * vertex.pos.y() + tm[13]);
+			target.tex = currentFullRegion ? vertex.tex : Vector2f(currentRegion.x() + vertex.tex.x() * currentRegion.z(), currentRegion.y() + vertex.tex.y() * currentRegion.w());
+			target.col = vertex.col;
+		}
+
+		return &transformedVertices[0];
+
+	} // transformVertices
+
+	static void beginBatch(const Primitive::Type _type, const unsigned int _numVertices, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
+	{
+		if(batchVertices.size() && (batchType != _type || batchTexture != currentTexture || batchChromaU != currentChromaU || batchChromaV != currentChromaV || batchSrcBlend != _srcBlendFactor || batchDstBlend != _dstBlendFactor || batchVertices.size() + _numVertices > MAX_BATCH_VERTICES))
+			flush();
+
+		batchType     = _type;
+		batchTexture  = currentTexture;
+		batchChromaU  = currentChromaU;
+		batchChromaV  = currentChromaV;
+		batchSrcBlend = _srcBlendFactor;
+		batchDstBlend = _dstBlendFactor;
+
+		frameStats.draws++;
+
+	} // beginBatch
+
+	void flush()
+	{
+		if(batchVertices.empty())
+			return;
+
+		setYUVPlanes(batchChromaU, batchChromaV);
+		drawArrays(batchType, &batchVertices[0], (unsigned int)batchVertices.size(), batchTexture, batchSrcBlend, batchDstBlend);
+		batchVertices.clear();
+
+	} // flush
+
+	void drawLines(const Vertex* _vertices, const unsigned int _numVertices, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
+	{
+		const unsigned int numVertices = _numVertices & ~1;
+		if(numVertices == 0)
+			return;
+
+		beginBatch(Primitive::LINES, numVertices, _srcBlendFactor, _dstBlendFactor);
+
+		const Vertex* vertices = transformVertices(_vertices, numVertices);
+		batchVertices.insert(batchVertices.end(), vertices, vertices + numVertices);
+
+	} // drawLines
+
+	void drawTriangleStrips(const Vertex* _vertices, const unsigned int _numVertices, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
+	{
+		if(_numVertices < 3)
+			return;
+
+		beginBatch(Primitive::TRIANGLES, (_numVertices - 2) * 3, _srcBlendFactor, _dstBlendFactor);
+
+		const Vertex* vertices = transformVertices(_vertices, _numVertices);
+
+		// Strips are split into separate triangles so consecutive strips can share a draw call.
+		// Degenerate triangles, used to join strips, are dropped
+		for(unsigned int i = 2; i < _numVertices; ++i)
+		{
+			const Vertex& v0 = vertices[(i & 1) ? i - 1 : i - 2];
+			const Vertex& v1 = vertices[(i & 1) ? i - 2 : i - 1];
+			const Vertex& v2 = vertices[i];
+
+			if(v0.pos == v1.pos || v1.pos == v2.pos || v0.pos == v2.pos)
+				continue;
+
+			batchVertices.push_back(v0);
+			batchVertices.push_back(v1);
+			batchVertices.push_back(v2);
+		}
+
+	} // drawTriangleStrips
+
+	const FrameStats& getFrameStats()        { return lastFrameStats; }
+	FrameStats&       getCurrentFrameStats() { return frameStats; }
+
+	void endFrame()
+	{
+		lastFrameStats = frameStats;
+		frameStats     = FrameStats();
+		frameCount++;
+
+	} // endFrame
+
+	unsigned int getFrameCount() { return frameCount; }
+
+	#define ROUNDING_PIECES 8.0f
+
+	static void drawGLRoundedCorner(float x, float y, double sa, double arc, float r, unsigned int color, std::vector<Vertex> &vertex)
+	{
+		// centre of the arc, for clockwise sense
+		float cent_x = x + r * Math::cosf(sa + ES_PI / 2.0f);
+		float cent_y = y + r * Math::sinf(sa + ES_PI / 2.0f);
+
+		// build up piecemeal including end of the arc
+		int n = ceil(ROUNDING_PIECES * arc / ES_PI * 2.0f);
+		for (int i = 0; i <= n; i++)
+		{
+			float ang = sa + arc * (double)i / (double)n;
+
+			// compute the next point
+			float next_x = cent_x + r * Math::sinf(ang);
+			float next_y = cent_y - r * Math::cosf(ang);
+
+			Vertex vx;
+			vx.pos = Vector2f(next_x, next_y);
+			vx.tex = Vector2f(0, 0);
+			vx.col = color;
+			vertex.push_back(vx);
+		}
+	}
+
+	void drawRoundRect(float x, float y, float width, float height, float radius, unsigned int color, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
+	{
+		auto finalColor = convertColor(color);
+
+		std::vector<Vertex> vertex;
+		drawGLRoundedCorner(x, y + radius, 3.0f * ES_PI / 2.0f, ES_PI / 2.0f, radius, finalColor, vertex);
+		drawGLRoundedCorner(x + width - radius, y, 0.0, ES_PI / 2.0f, radius, finalColor, vertex);
+		drawGLRoundedCorner(x + width, y + height - radius, ES_PI / 2.0f, ES_PI / 2.0f, radius, finalColor, vertex);
+		drawGLRoundedCorner(x + radius, y + height, ES_PI, ES_PI / 2.0f, radius, finalColor, vertex);
+
+		if(vertex.size() < 3)
+			return;
+
+		// The outline is convex : the fan becomes a list of triangles, batched like any other draw
+		bindTexture(0);
+		beginBatch(Primitive::TRIANGLES, (unsigned int)(vertex.size() - 2) * 3, _srcBlendFactor, _dstBlendFactor);
+
+		const Vertex* vertices = transformVertices(&vertex[0], (unsigned int)vertex.size());
+
+		for(size_t i = 2; i < vertex.size(); ++i)
+		{
+			batchVertices.push_back(vertices[0]);
+			batchVertices.push_back(vertices[i - 1]);
+			batchVertices.push_back(vertices[i]);
+		}
+	}
+
 	void drawRect(const float _x, const float _y, const float _w, const float _h, const unsigned int _color, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
 	{
 		drawRect(_x, _y, _w, _h, _color, _color, true, _srcBlendFactor, _dstBlendFactor);
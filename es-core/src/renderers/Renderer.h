@@ -3,6 +3,7 @@
 #define ES_CORE_RENDERER_RENDERER_H
 
 #include "math/Vector2f.h"
+#include "math/Vector4f.h"
 
 class  Transform4x4f;
 class  Vector2i;
@@ -29,6 +30,17 @@ namespace Renderer
 
 	} // Blend::
 
+	namespace Primitive
+	{
+		enum Type
+		{
+			TRIANGLES = 0,
+			LINES     = 1
+
+		}; // Type
+
+	} // Primitive::
+
 	namespace Texture
 	{
 		enum Type
@@ -62,6 +74,18 @@ namespace Renderer
 
 	}; // Vertex
 
+	struct FrameStats
+	{
+		FrameStats() : draws(0), drawCalls(0), stateChanges(0), textureBinds(0), textureUploads(0) { }
+
+		unsigned int draws;        // drawTriangleStrips / drawLines / drawRoundRect requests
+		unsigned int drawCalls;    // draw calls sent to the GPU after batching
+		unsigned int stateChanges; // texture, blend & scissor changes sent to the GPU
+		unsigned int textureBinds; // texture changes sent to the GPU
+		unsigned int textureUploads; // createTexture / updateTexture calls
+
+	}; // FrameStats
+
  	bool        init            ();
  	void        deinit          ();
 	void        pushClipRect    (const Vector2i& _pos, const Vector2i& _size);
@@ -78,6 +102,24 @@ namespace Renderer
 	int         getScreenOffsetY();
 	int         getScreenRotate ();
 
+	// Draws are transformed on the CPU and merged while they share the same primitive, texture and blend mode.
+	// flush() sends the pending batch, it is called before any other GL state change
+	void        bindTexture       (const unsigned int _texture);
+	// Binds a part of a texture (x, y, width, height in texture coordinates) : the 0..1 coordinates of the next draws are remapped to it
+	void        bindTexture       (const unsigned int _texture, const Vector4f& _region);
+	// Binds the Y, U & V planes of a picture, ALPHA textures : the next draws convert them to RGB. Only when supportsYUV()
+	void        bindYUVTextures   (const unsigned int _y, const unsigned int _u, const unsigned int _v);
+	void        drawLines         (const Vertex* _vertices, const unsigned int _numVertices, const Blend::Factor _srcBlendFactor = Blend::SRC_ALPHA, const Blend::Factor _dstBlendFactor = Blend::ONE_MINUS_SRC_ALPHA);
+	void        drawTriangleStrips(const Vertex* _vertices, const unsigned int _numVertices, const Blend::Factor _srcBlendFactor = Blend::SRC_ALPHA, const Blend::Factor _dstBlendFactor = Blend::ONE_MINUS_SRC_ALPHA);
+	void        setMatrix         (const Transform4x4f& _matrix);
+	void        flush             ();
+
+	// Counters of the last complete frame
+	const FrameStats& getFrameStats    ();
+	FrameStats&       getCurrentFrameStats();
+	void              endFrame         ();
+	unsigned int      getFrameCount    (); // Number of frames ended so far
+
 	// API specific
 	unsigned int convertColor      (const unsigned int _color);
 	unsigned int getWindowFlags    ();
@@ -87,13 +129,14 @@ namespace Renderer
 	unsigned int createTexture     (const Texture::Type _type, const bool _linear, const bool _repeat, const unsigned int _width, const unsigned int _height, void* _data);
 	void         destroyTexture    (const unsigned int _texture);
 	void         updateTexture     (const unsigned int _texture, const Texture::Type _type, const unsigned int _x, const unsigned _y, const unsigned int _width, const unsigned int _height, void* _data);
-	void         bindTexture       (const unsigned int _texture);
-	void         drawLines         (const Vertex* _vertices, const unsigned int _numVertices, const Blend::Factor _srcBlendFactor = Blend::SRC_ALPHA, const Blend::Factor _dstBlendFactor = Blend::ONE_MINUS_SRC_ALPHA);
-	void         drawTriangleStrips(const Vertex* _vertices, const unsigned int _numVertices, const Blend::Factor _srcBlendFactor = Blend::SRC_ALPHA, const Blend::Factor _dstBlendFactor = Blend::ONE_MINUS_SRC_ALPHA);
+	void         streamTexture     (const unsigned int _texture, const Texture::Type _type, const unsigned int _width, const unsigned int _height, void* _data); // Whole content replaced every frame, same size
+	bool         supportsYUV       ();
+	void         setYUVPlanes      (const unsigned int _u, const unsigned int _v); // U & V planes of the next drawArrays, 0 for plain textures
+	void         drawArrays        (const Primitive::Type _type, const Vertex* _vertices, const unsigned int _numVertices, const unsigned int _texture, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor);
 	void         setProjection     (const Transform4x4f& _projection);
-	void         setMatrix         (const Transform4x4f& _matrix);
 	void         setViewport       (const Rect& _viewport);
 	void         setScissor        (const Rect& _scissor);
+	void         setAlphaTest      (const float _threshold); // Fragments with a lower alpha are discarded, 0 disables the test
 	void         setSwapInterval   ();
 	void         swapBuffers       ();
 
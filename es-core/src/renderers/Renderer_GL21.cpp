@@ -7,12 +7,78 @@
 
 #include <SDL_opengl.h>
 #include <SDL.h>
+#include <stddef.h>
+#include <stdlib.h>
 #include <vector>
 
 namespace Renderer
 {
 	static SDL_GLContext sdlContext = nullptr;
 
+	// Streaming vertex buffer, orphaned when full. Buffer objects are GL 1.5, they're loaded at runtime
+	#define VERTEX_BUFFER_SIZE (1024 * 1024)
+
+	static PFNGLGENBUFFERSPROC    glGenBuffersProc    = nullptr;
+	static PFNGLDELETEBUFFERSPROC glDeleteBuffersProc = nullptr;
+	static PFNGLBINDBUFFERPROC    glBindBufferProc    = nullptr;
+	static PFNGLBUFFERDATAPROC    glBufferDataProc    = nullptr;
+	static PFNGLBUFFERSUBDATAPROC glBufferSubDataProc = nullptr;
+
+	static GLuint       vertexBuffer       = 0;
+	static size_t       vertexBufferOffset = 0;
+
+	// Video frames are copied to a ring of pixel unpack buffers, the texture upload then runs without the caller waiting for it
+	#define PIXEL_BUFFERS 3
+
+	#ifndef GL_PIXEL_UNPACK_BUFFER
+	#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+	#endif
+
+	static GLuint       pixelBuffers[PIXEL_BUFFERS] = { 0 };
+	static int          pixelBufferIndex   = 0;
+
+	// Y, U & V planes converted to RGB by a fragment shader, the vertices still go through the fixed pipeline. Shaders are GL 2.0, loaded at runtime
+	static PFNGLACTIVETEXTUREPROC     glActiveTextureProc     = nullptr;
+	static PFNGLCREATESHADERPROC      glCreateShaderProc      = nullptr;
+	static PFNGLSHADERSOURCEPROC      glShaderSourceProc      = nullptr;
+	static PFNGLCOMPILESHADERPROC     glCompileShaderProc     = nullptr;
+	static PFNGLGETSHADERIVPROC       glGetShaderivProc       = nullptr;
+	static PFNGLDELETESHADERPROC      glDeleteShaderProc      = nullptr;
+	static PFNGLCREATEPROGRAMPROC     glCreateProgramProc     = nullptr;
+	static PFNGLATTACHSHADERPROC      glAttachShaderProc      = nullptr;
+	static PFNGLLINKPROGRAMPROC       glLinkProgramProc       = nullptr;
+	static PFNGLGETPROGRAMIVPROC      glGetProgramivProc      = nullptr;
+	static PFNGLDELETEPROGRAMPROC     glDeleteProgramProc     = nullptr;
+	static PFNGLUSEPROGRAMPROC        glUseProgramProc        = nullptr;
+	static PFNGLGETUNIFORMLOCATIONPROC glGetUniformLocationProc = nullptr;
+	static PFNGLUNIFORM1IPROC         glUniform1iProc         = nullptr;
+
+	static GLuint       yuvProgram         = 0;
+
+	// BT.601, limited range : what the decoders give for most scraped videos
+	static const char*  yuvShaderSource    =
+		"uniform sampler2D planeY;\n"
+		"uniform sampler2D planeU;\n"
+		"uniform sampler2D planeV;\n"
+		"void main()\n"
+		"{\n"
+		"	float y = 1.1643 * (texture2D(planeY, gl_TexCoord[0].st).a - 0.0625);\n"
+		"	float u = texture2D(planeU, gl_TexCoord[0].st).a - 0.5;\n"
+		"	float v = texture2D(planeV, gl_TexCoord[0].st).a - 0.5;\n"
+		"	gl_FragColor = vec4(y + 1.5958 * v, y - 0.39173 * u - 0.8129 * v, y + 2.017 * u, 1.0) * gl_Color;\n"
+		"}\n";
+
+	// GL state cache, so only actual changes reach the driver
+	static unsigned int boundTexture       = 0;
+	static bool         textureEnabled     = false;
+	static GLenum       blendSrc           = GL_ONE;
+	static GLenum       blendDst           = GL_ZERO;
+	static GLuint       boundBuffer        = 0;
+	static Rect         scissorRect        = Rect(0, 0, 0, 0);
+	static float        alphaTest          = 0.0f;
+	static unsigned int boundChromaU       = 0;
+	static unsigned int boundChromaV       = 0;
+
 	static GLenum convertBlendFactor(const Blend::Factor _blendFactor)
 	{
 		switch(_blendFactor)
@@ -43,6 +109,112 @@ namespace Renderer
 
 	} // convertTextureType
 
+	static void applyTexture(const unsigned int _texture)
+	{
+		if(boundTexture != _texture)
+		{
+			glBindTexture(GL_TEXTURE_2D, _texture);
+			boundTexture = _texture;
+			getCurrentFrameStats().stateChanges++;
+			getCurrentFrameStats().textureBinds++;
+		}
+
+		if(textureEnabled != (_texture != 0))
+		{
+			textureEnabled = (_texture != 0);
+			if(textureEnabled) glEnable(GL_TEXTURE_2D);
+			else               glDisable(GL_TEXTURE_2D);
+			getCurrentFrameStats().stateChanges++;
+		}
+
+	} // applyTexture
+
+	static void applyBlend(const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
+	{
+		const GLenum src = convertBlendFactor(_srcBlendFactor);
+		const GLenum dst = convertBlendFactor(_dstBlendFactor);
+
+		if((blendSrc != src) || (blendDst != dst))
+		{
+			glBlendFunc(src, dst);
+			blendSrc = src;
+			blendDst = dst;
+			getCurrentFrameStats().stateChanges++;
+		}
+
+	} // applyBlend
+
+	static void bindBuffer(const GLuint _buffer)
+	{
+		if(boundBuffer != _buffer)
+		{
+			glBindBufferProc(GL_ARRAY_BUFFER, _buffer);
+			boundBuffer = _buffer;
+		}
+
+	} // bindBuffer
+
+	static void createYUVProgram()
+	{
+		// The entry points may be found on older contexts too
+		const char* version = (const char*)glGetString(GL_VERSION);
+		if(version == nullptr || atoi(version) < 2)
+			return;
+
+		glActiveTextureProc      = (PFNGLACTIVETEXTUREPROC)SDL_GL_GetProcAddress("glActiveTexture");
+		glCreateShaderProc       = (PFNGLCREATESHADERPROC)SDL_GL_GetProcAddress("glCreateShader");
+		glShaderSourceProc       = (PFNGLSHADERSOURCEPROC)SDL_GL_GetProcAddress("glShaderSource");
+		glCompileShaderProc      = (PFNGLCOMPILESHADERPROC)SDL_GL_GetProcAddress("glCompileShader");
+		glGetShaderivProc        = (PFNGLGETSHADERIVPROC)SDL_GL_GetProcAddress("glGetShaderiv");
+		glDeleteShaderProc       = (PFNGLDELETESHADERPROC)SDL_GL_GetProcAddress("glDeleteShader");
+		glCreateProgramProc      = (PFNGLCREATEPROGRAMPROC)SDL_GL_GetProcAddress("glCreateProgram");
+		glAttachShaderProc       = (PFNGLATTACHSHADERPROC)SDL_GL_GetProcAddress("glAttachShader");
+		glLinkProgramProc        = (PFNGLLINKPROGRAMPROC)SDL_GL_GetProcAddress("glLinkProgram");
+		glGetProgramivProc       = (PFNGLGETPROGRAMIVPROC)SDL_GL_GetProcAddress("glGetProgramiv");
+		glDeleteProgramProc      = (PFNGLDELETEPROGRAMPROC)SDL_GL_GetProcAddress("glDeleteProgram");
+		glUseProgramProc         = (PFNGLUSEPROGRAMPROC)SDL_GL_GetProcAddress("glUseProgram");
+		glGetUniformLocationProc = (PFNGLGETUNIFORMLOCATIONPROC)SDL_GL_GetProcAddress("glGetUniformLocation");
+		glUniform1iProc          = (PFNGLUNIFORM1IPROC)SDL_GL_GetProcAddress("glUniform1i");
+
+		if(!glActiveTextureProc || !glCreateShaderProc || !glShaderSourceProc || !glCompileShaderProc || !glGetShaderivProc || !glDeleteShaderProc ||
+			!glCreateProgramProc || !glAttachShaderProc || !glLinkProgramProc || !glGetProgramivProc || !glDeleteProgramProc || !glUseProgramProc ||
+			!glGetUniformLocationProc || !glUniform1iProc)
+			return;
+
+		GLint  status = GL_FALSE;
+		GLuint shader = glCreateShaderProc(GL_FRAGMENT_SHADER);
+		glShaderSourceProc(shader, 1, &yuvShaderSource, nullptr);
+		glCompileShaderProc(shader);
+		glGetShaderivProc(shader, GL_COMPILE_STATUS, &status);
+
+		if(status != GL_TRUE)
+		{
+			glDeleteShaderProc(shader);
+			return;
+		}
+
+		yuvProgram = glCreateProgramProc();
+		glAttachShaderProc(yuvProgram, shader);
+		glLinkProgramProc(yuvProgram);
+		glDeleteShaderProc(shader);
+		glGetProgramivProc(yuvProgram, GL_LINK_STATUS, &status);
+
+		if(status != GL_TRUE)
+		{
+			glDeleteProgramProc(yuvProgram);
+			yuvProgram = 0;
+			return;
+		}
+
+		// The planes always use the same texture units
+		glUseProgramProc(yuvProgram);
+		glUniform1iProc(glGetUniformLocationProc(yuvProgram, "planeY"), 0);
+		glUniform1iProc(glGetUniformLocationProc(yuvProgram, "planeU"), 1);
+		glUniform1iProc(glGetUniformLocationProc(yuvProgram, "planeV"), 2);
+		glUseProgramProc(0);
+
+	} // createYUVProgram
+
 	unsigned int convertColor(const unsigned int _color)
 	{
 		// convert from rgba to abgr
@@ -90,10 +262,73 @@ namespace Renderer
 		LOG(LogInfo) << "Checking available OpenGL extensions...";
 		LOG(LogInfo) << " ARB_texture_non_power_of_two: " << (glExts.find("ARB_texture_non_power_of_two") != std::string::npos ? "ok" : "MISSING");
 
+		glGenBuffersProc    = (PFNGLGENBUFFERSPROC)SDL_GL_GetProcAddress("glGenBuffers");
+		glDeleteBuffersProc = (PFNGLDELETEBUFFERSPROC)SDL_GL_GetProcAddress("glDeleteBuffers");
+		glBindBufferProc    = (PFNGLBINDBUFFERPROC)SDL_GL_GetProcAddress("glBindBuffer");
+		glBufferDataProc    = (PFNGLBUFFERDATAPROC)SDL_GL_GetProcAddress("glBufferData");
+		glBufferSubDataProc = (PFNGLBUFFERSUBDATAPROC)SDL_GL_GetProcAddress("glBufferSubData");
+
+		if(glGenBuffersProc && glDeleteBuffersProc && glBindBufferProc && glBufferDataProc && glBufferSubDataProc)
+		{
+			glGenBuffersProc(1, &vertexBuffer);
+			bindBuffer(vertexBuffer);
+			glBufferDataProc(GL_ARRAY_BUFFER, VERTEX_BUFFER_SIZE, nullptr, GL_STREAM_DRAW);
+			vertexBufferOffset = 0;
+		}
+
+		LOG(LogInfo) << " Vertex buffer objects: " << (vertexBuffer != 0 ? "ok" : "MISSING");
+
+		if((vertexBuffer != 0) && (glExts.find("pixel_buffer_object") != std::string::npos))
+			glGenBuffersProc(PIXEL_BUFFERS, pixelBuffers);
+
+		LOG(LogInfo) << " Pixel buffer objects: " << (pixelBuffers[0] != 0 ? "ok" : "MISSING");
+
+		createYUVProgram();
+
+		LOG(LogInfo) << " YUV shader: " << (yuvProgram != 0 ? "ok" : "MISSING");
+
+		// Blending and vertex arrays are always on, the other states are cached
+		glEnable(GL_BLEND);
+		glBlendFunc(blendSrc, blendDst);
+
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glEnableClientState(GL_COLOR_ARRAY);
+
 	} // createContext
 
 	void destroyContext()
 	{
+		if(vertexBuffer != 0)
+		{
+			bindBuffer(0);
+			glDeleteBuffersProc(1, &vertexBuffer);
+			vertexBuffer = 0;
+		}
+
+		if(pixelBuffers[0] != 0)
+		{
+			glDeleteBuffersProc(PIXEL_BUFFERS, pixelBuffers);
+			for(int i = 0; i < PIXEL_BUFFERS; ++i)
+				pixelBuffers[i] = 0;
+		}
+
+		if(yuvProgram != 0)
+		{
+			glUseProgramProc(0);
+			glDeleteProgramProc(yuvProgram);
+			yuvProgram = 0;
+		}
+
+		boundTexture   = 0;
+		textureEnabled = false;
+		blendSrc       = GL_ONE;
+		blendDst       = GL_ZERO;
+		scissorRect    = Rect(0, 0, 0, 0);
+		alphaTest      = 0.0f;
+		boundChromaU   = 0;
+		boundChromaV   = 0;
+
 		SDL_GL_DeleteContext(sdlContext);
 		sdlContext = nullptr;
 
@@ -104,8 +339,11 @@ namespace Renderer
 		const GLenum type = convertTextureType(_type);
 		unsigned int texture;
 
+		flush();
+
 		glGenTextures(1, &texture);
 		bindTexture(texture);
+		applyTexture(texture);
 
 		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, _repeat ? GL_REPEAT : GL_CLAMP_TO_EDGE);
 		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, _repeat ? GL_REPEAT : GL_CLAMP_TO_EDGE);
@@ -117,6 +355,7 @@ namespace Renderer
 		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
 		glTexImage2D(GL_TEXTURE_2D, 0, type, _width, _height, 0, type, GL_UNSIGNED_BYTE, _data);
+		getCurrentFrameStats().textureUploads++;
 
 		return texture;
 
@@ -124,13 +363,24 @@ namespace Renderer
 	
 	void destroyTexture(const unsigned int _texture)
 	{
+		flush();
+
+		// The binding falls back to 0 when the bound texture is deleted
+		if(boundTexture == _texture)
+			boundTexture = 0;
+
+		if(boundChromaU == _texture || boundChromaV == _texture)
+			setYUVPlanes(0, 0);
+
 		glDeleteTextures(1, &_texture);
 
 	} // destroyTexture
 
 	void updateTexture(const unsigned int _texture, const Texture::Type _type, const unsigned int _x, const unsigned _y, const unsigned int _width, const unsigned int _height, void* _data)
 	{
-		glBindTexture(GL_TEXTURE_2D, _texture);
+		flush();
+		applyTexture(_texture);
+		getCurrentFrameStats().textureUploads++;
 
 		if (_x == -1 && _y == -1)
 		{
@@ -140,83 +390,116 @@ namespace Renderer
 		else 
 			glTexSubImage2D(GL_TEXTURE_2D, 0, _x, _y, _width, _height, convertTextureType(_type), GL_UNSIGNED_BYTE, _data);
 
-		glBindTexture(GL_TEXTURE_2D, 0);
-
 	} // updateTexture
 
-	void bindTexture(const unsigned int _texture)
+	void streamTexture(const unsigned int _texture, const Texture::Type _type, const unsigned int _width, const unsigned int _height, void* _data)
 	{
-		glBindTexture(GL_TEXTURE_2D, _texture);
+		flush();
+		applyTexture(_texture);
+		getCurrentFrameStats().textureUploads++;
+
+		if(pixelBuffers[0] == 0)
+		{
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, _width, _height, convertTextureType(_type), GL_UNSIGNED_BYTE, _data);
+			return;
+		}
+
+		const size_t size = _width * _height * (_type == Texture::RGBA ? 4 : 1);
 
-		if(_texture == 0) glDisable(GL_TEXTURE_2D);
-		else              glEnable(GL_TEXTURE_2D);
+		// The buffer is orphaned before being filled : the driver gives a new one if the GPU still reads the previous frame
+		glBindBufferProc(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[pixelBufferIndex]);
+		glBufferDataProc(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+		glBufferSubDataProc(GL_PIXEL_UNPACK_BUFFER, 0, size, _data);
 
-	} // bindTexture
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, _width, _height, convertTextureType(_type), GL_UNSIGNED_BYTE, nullptr);
 
-	void drawLines(const Vertex* _vertices, const unsigned int _numVertices, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
+		glBindBufferProc(GL_PIXEL_UNPACK_BUFFER, 0);
+		pixelBufferIndex = (pixelBufferIndex + 1) % PIXEL_BUFFERS;
+
+	} // streamTexture
+
+	bool supportsYUV()
 	{
-		glEnable(GL_BLEND);
-		glBlendFunc(convertBlendFactor(_srcBlendFactor), convertBlendFactor(_dstBlendFactor));
+		return yuvProgram != 0;
 
-		glEnableClientState(GL_VERTEX_ARRAY);
-		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-		glEnableClientState(GL_COLOR_ARRAY);
+	} // supportsYUV
 
-		glVertexPointer(  2, GL_FLOAT,         sizeof(Vertex), &_vertices[0].pos);
-		glTexCoordPointer(2, GL_FLOAT,         sizeof(Vertex), &_vertices[0].tex);
-		glColorPointer(   4, GL_UNSIGNED_BYTE, sizeof(Vertex), &_vertices[0].col);
+	void setYUVPlanes(const unsigned int _u, const unsigned int _v)
+	{
+		if(yuvProgram == 0 || (boundChromaU == _u && boundChromaV == _v))
+			return;
 
-		glDrawArrays(GL_LINES, 0, _numVertices);
+		if(_u != 0 && _v != 0)
+		{
+			glActiveTextureProc(GL_TEXTURE1);
+			glBindTexture(GL_TEXTURE_2D, _u);
+			glActiveTextureProc(GL_TEXTURE2);
+			glBindTexture(GL_TEXTURE_2D, _v);
+			glActiveTextureProc(GL_TEXTURE0);
+		}
 
-		glDisableClientState(GL_COLOR_ARRAY);
-		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-		glDisableClientState(GL_VERTEX_ARRAY);
+		if((boundChromaU != 0) != (_u != 0))
+			glUseProgramProc(_u != 0 ? yuvProgram : 0);
 
-		glDisable(GL_BLEND);
+		boundChromaU = _u;
+		boundChromaV = _v;
+		getCurrentFrameStats().stateChanges++;
 
-	} // drawLines
+	} // setYUVPlanes
 
-	void drawTriangleStrips(const Vertex* _vertices, const unsigned int _numVertices, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
+	void drawArrays(const Primitive::Type _type, const Vertex* _vertices, const unsigned int _numVertices, const unsigned int _texture, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
 	{
-		glEnable(GL_BLEND);
-		glBlendFunc(convertBlendFactor(_srcBlendFactor), convertBlendFactor(_dstBlendFactor));
+		applyTexture(_texture);
+		applyBlend(_srcBlendFactor, _dstBlendFactor);
 
-		glEnableClientState(GL_VERTEX_ARRAY);
-		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-		glEnableClientState(GL_COLOR_ARRAY);
+		const size_t size = _numVertices * sizeof(Vertex);
+		const char*  base = (const char*)_vertices;
+
+		if((vertexBuffer != 0) && (size <= VERTEX_BUFFER_SIZE))
+		{
+			bindBuffer(vertexBuffer);
+
+			// Orphan the buffer when it's full : the driver gives a new one instead of waiting for the GPU
+			if(vertexBufferOffset + size > VERTEX_BUFFER_SIZE)
+			{
+				glBufferDataProc(GL_ARRAY_BUFFER, VERTEX_BUFFER_SIZE, nullptr, GL_STREAM_DRAW);
+				vertexBufferOffset = 0;
+			}
 
-		glVertexPointer(  2, GL_FLOAT,         sizeof(Vertex), &_vertices[0].pos);
-		glTexCoordPointer(2, GL_FLOAT,         sizeof(Vertex), &_vertices[0].tex);
-		glColorPointer(   4, GL_UNSIGNED_BYTE, sizeof(Vertex), &_vertices[0].col);
+			glBufferSubDataProc(GL_ARRAY_BUFFER, vertexBufferOffset, size, _vertices);
 
-		glDrawArrays(GL_TRIANGLE_STRIP, 0, _numVertices);
+			base = (const char*)nullptr + vertexBufferOffset;
+			vertexBufferOffset += size;
+		}
+		else if(vertexBuffer != 0)
+			bindBuffer(0);
 
-		glDisableClientState(GL_COLOR_ARRAY);
-		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-		glDisableClientState(GL_VERTEX_ARRAY);
+		glVertexPointer(  2, GL_FLOAT,         sizeof(Vertex), base + offsetof(Vertex, pos));
+		glTexCoordPointer(2, GL_FLOAT,         sizeof(Vertex), base + offsetof(Vertex, tex));
+		glColorPointer(   4, GL_UNSIGNED_BYTE, sizeof(Vertex), base + offsetof(Vertex, col));
 
-		glDisable(GL_BLEND);
+		glDrawArrays((_type == Primitive::LINES) ? GL_LINES : GL_TRIANGLES, 0, _numVertices);
+		getCurrentFrameStats().drawCalls++;
 
-	} // drawTriangleStrips
+	} // drawArrays
 
 	void setProjection(const Transform4x4f& _projection)
 	{
+		flush();
+
 		glMatrixMode(GL_PROJECTION);
 		glLoadMatrixf((GLfloat*)&_projection);
 
-	} // setProjection
-
-	void setMatrix(const Transform4x4f& _matrix)
-	{
-		Transform4x4f matrix = _matrix;
-		matrix.round();
+		// Vertices are transformed on the CPU by setMatrix
 		glMatrixMode(GL_MODELVIEW);
-		glLoadMatrixf((GLfloat*)&matrix);
+		glLoadIdentity();
 
-	} // setMatrix
+	} // setProjection
 
 	void setViewport(const Rect& _viewport)
 	{
+		flush();
+
 		// glViewport starts at the bottom left of the window
 		glViewport( _viewport.x, getWindowHeight() - _viewport.y - _viewport.h, _viewport.w, _viewport.h);
 
@@ -224,6 +507,14 @@ namespace Renderer
 
 	void setScissor(const Rect& _scissor)
 	{
+		if((_scissor.x == scissorRect.x) && (_scissor.y == scissorRect.y) && (_scissor.w == scissorRect.w) && (_scissor.h == scissorRect.h))
+			return;
+
+		flush();
+
+		scissorRect = _scissor;
+		getCurrentFrameStats().stateChanges++;
+
 		if((_scissor.x == 0) && (_scissor.y == 0) && (_scissor.w == 0) && (_scissor.h == 0))
 		{
 			glDisable(GL_SCISSOR_TEST);
@@ -237,6 +528,26 @@ namespace Renderer
 
 	} // setScissor
 
+	void setAlphaTest(const float _threshold)
+	{
+		if(_threshold == alphaTest)
+			return;
+
+		flush();
+
+		alphaTest = _threshold;
+		getCurrentFrameStats().stateChanges++;
+
+		if(_threshold > 0.0f)
+		{
+			glAlphaFunc(GL_GEQUAL, _threshold);
+			glEnable(GL_ALPHA_TEST);
+		}
+		else
+			glDisable(GL_ALPHA_TEST);
+
+	} // setAlphaTest
+
 	void setSwapInterval()
 	{
 		// vsync
@@ -258,87 +569,17 @@ namespace Renderer
 
 	void swapBuffers()
 	{
+		flush();
+		endFrame();
+
 		SDL_GL_SwapWindow(getSDLWindow());
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	} // swapBuffers
 
-	#define ROUNDING_PIECES 8.0f
-
-	void drawGLRoundedCorner(float x, float y, double sa, double arc, float r, unsigned int color, std::vector<Vertex> &vertex)
-	{
-		float red = (((color & 0xff000000) >> 24) & 255) / 255.0f;
-		float g = (((color & 0x00ff0000) >> 16) & 255) / 255.0f;
-		float b = (((color & 0x0000ff00) >> 8) & 255) / 255.0f;
-		float a = (((color & 0x000000ff)) & 255) / 255.0f;
-
-		// centre of the arc, for clockwise sense
-		float cent_x = x + r * Math::cosf(sa + ES_PI / 2.0f);
-		float cent_y = y + r * Math::sinf(sa + ES_PI / 2.0f);
-
-		// build up piecemeal including end of the arc
-		int n = ceil(ROUNDING_PIECES * arc / ES_PI * 2.0f);
-		for (int i = 0; i <= n; i++)
-		{
-			float ang = sa + arc * (double)i / (double)n;
-
-			// compute the next point
-			float next_x = cent_x + r * Math::sinf(ang);
-			float next_y = cent_y - r * Math::cosf(ang);
-
-			Vertex vx;
-			vx.pos = Vector2f(next_x, next_y);
-			vx.tex = Vector2f(0, 0);
-			vx.col = color;
-			vertex.push_back(vx);
-		}
-	}
-	
-	void drawRoundRect(float x, float y, float width, float height, float radius, unsigned int color, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
-	{
-		auto finalColor = convertColor(color);
-
-		std::vector<Vertex> vertex;
-		drawGLRoundedCorner(x, y + radius, 3.0f * ES_PI / 2.0f, ES_PI / 2.0f, radius, finalColor, vertex);
-		drawGLRoundedCorner(x + width - radius, y, 0.0, ES_PI / 2.0f, radius, finalColor, vertex);
-		drawGLRoundedCorner(x + width, y + height - radius, ES_PI / 2.0f, ES_PI / 2.0f, radius, finalColor, vertex);
-		drawGLRoundedCorner(x + radius, y + height, ES_PI, ES_PI / 2.0f, radius, finalColor, vertex);
-
-		Vertex* vxs = new Vertex[vertex.size()];
-		for (int i = 0; i < vertex.size(); i++)
-			vxs[i] = vertex[i];
-
-		bindTexture(0);
-
-		glEnable(GL_MULTISAMPLE);
-
-		glEnable(GL_BLEND);
-		glBlendFunc(convertBlendFactor(_srcBlendFactor), convertBlendFactor(_dstBlendFactor));
-
-		glEnableClientState(GL_VERTEX_ARRAY);
-		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-		glEnableClientState(GL_COLOR_ARRAY);
-
-		glVertexPointer(2, GL_FLOAT, sizeof(Vertex), &vxs[0].pos);
-		glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), &vxs[0].tex);
-		glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), &vxs[0].col);
-
-		glDrawArrays(GL_TRIANGLE_FAN, 0, vertex.size());
-
-		glDisableClientState(GL_COLOR_ARRAY);
-		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-		glDisableClientState(GL_VERTEX_ARRAY);
-
-		delete[] vxs;
-
-		glDisable(GL_BLEND);
-		glDisable(GL_MULTISAMPLE);
-	}
-
 	void enableRoundCornerStencil(float x, float y, float width, float height, float radius)
 	{
-		bool tx = glIsEnabled(GL_TEXTURE_2D);
-		glDisable(GL_TEXTURE_2D);
+		flush();
 
 		glClear(GL_DEPTH_BUFFER_BIT);
 		glEnable(GL_STENCIL_TEST);
@@ -351,6 +592,7 @@ namespace Renderer
 		glClear(GL_STENCIL_BUFFER_BIT);	
 
 		drawRoundRect(x, y, width, height, radius, 0xFFFFFFFF);
+		flush();
 		
 		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 		glDepthMask(GL_TRUE);
@@ -358,13 +600,15 @@ namespace Renderer
 		glStencilFunc(GL_EQUAL, 0, 0xFF);
 		glStencilFunc(GL_EQUAL, 1, 0xFF);
 
-		if (tx)
-			glEnable(GL_TEXTURE_2D);
+		getCurrentFrameStats().stateChanges++;
 	}
 
 	void disableStencil()
 	{
+		flush();
+
 		glDisable(GL_STENCIL_TEST);
+		getCurrentFrameStats().stateChanges++;
 	}
 
 } // Renderer::
@@ -7,12 +7,28 @@
 
 #include <GLES/gl.h>
 #include <SDL.h>
+#include <stddef.h>
 #include <vector>
 
 namespace Renderer
 {
 	static SDL_GLContext sdlContext = nullptr;
 
+	// Streaming vertex buffer, orphaned when full
+	#define VERTEX_BUFFER_SIZE (1024 * 1024)
+
+	static GLuint       vertexBuffer       = 0;
+	static size_t       vertexBufferOffset = 0;
+
+	// GL state cache, so only actual changes reach the driver
+	static unsigned int boundTexture       = 0;
+	static bool         textureEnabled     = false;
+	static GLenum       blendSrc           = GL_ONE;
+	static GLenum       blendDst           = GL_ZERO;
+	static GLuint       boundBuffer        = 0;
+	static Rect         scissorRect        = Rect(0, 0, 0, 0);
+	static float        alphaTest          = 0.0f;
+
 	static GLenum convertBlendFactor(const Blend::Factor _blendFactor)
 	{
 		switch(_blendFactor)
@@ -43,6 +59,51 @@ namespace Renderer
 
 	} // convertTextureType
 
+	static void applyTexture(const unsigned int _texture)
+	{
+		if(boundTexture != _texture)
+		{
+			glBindTexture(GL_TEXTURE_2D, _texture);
+			boundTexture = _texture;
+			getCurrentFrameStats().stateChanges++;
+			getCurrentFrameStats().textureBinds++;
+		}
+
+		if(textureEnabled != (_texture != 0))
+		{
+			textureEnabled = (_texture != 0);
+			if(textureEnabled) glEnable(GL_TEXTURE_2D);
+			else               glDisable(GL_TEXTURE_2D);
+			getCurrentFrameStats().stateChanges++;
+		}
+
+	} // applyTexture
+
+	static void applyBlend(const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
+	{
+		const GLenum src = convertBlendFactor(_srcBlendFactor);
+		const GLenum dst = convertBlendFactor(_dstBlendFactor);
+
+		if((blendSrc != src) || (blendDst != dst))
+		{
+			glBlendFunc(src, dst);
+			blendSrc = src;
+			blendDst = dst;
+			getCurrentFrameStats().stateChanges++;
+		}
+
+	} // applyBlend
+
+	static void bindBuffer(const GLuint _buffer)
+	{
+		if(boundBuffer != _buffer)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, _buffer);
+			boundBuffer = _buffer;
+		}
+
+	} // bindBuffer
+
 	unsigned int convertColor(const unsigned int _color)
 	{
 		// convert from rgba to abgr
@@ -87,10 +148,40 @@ namespace Renderer
 		LOG(LogInfo) << "Checking available OpenGL extensions...";
 		LOG(LogInfo) << " ARB_texture_non_power_of_two: " << (glExts.find("ARB_texture_non_power_of_two") != std::string::npos ? "ok" : "MISSING");
 
+		glGenBuffers(1, &vertexBuffer);
+		if(vertexBuffer != 0)
+		{
+			bindBuffer(vertexBuffer);
+			glBufferData(GL_ARRAY_BUFFER, VERTEX_BUFFER_SIZE, nullptr, GL_DYNAMIC_DRAW);
+			vertexBufferOffset = 0;
+		}
+
+		// Blending and vertex arrays are always on, the other states are cached
+		glEnable(GL_BLEND);
+		glBlendFunc(blendSrc, blendDst);
+
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glEnableClientState(GL_COLOR_ARRAY);
+
 	} // createContext
 
 	void destroyContext()
 	{
+		if(vertexBuffer != 0)
+		{
+			bindBuffer(0);
+			glDeleteBuffers(1, &vertexBuffer);
+			vertexBuffer = 0;
+		}
+
+		boundTexture   = 0;
+		textureEnabled = false;
+		blendSrc       = GL_ONE;
+		blendDst       = GL_ZERO;
+		scissorRect    = Rect(0, 0, 0, 0);
+		alphaTest      = 0.0f;
+
 		SDL_GL_DeleteContext(sdlContext);
 		sdlContext = nullptr;
 
@@ -101,8 +192,11 @@ namespace Renderer
 		const GLenum type = convertTextureType(_type);
 		unsigned int texture;
 
+		flush();
+
 		glGenTextures(1, &texture);
 		bindTexture(texture);
+		applyTexture(texture);
 
 		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, _repeat ? GL_REPEAT : GL_CLAMP_TO_EDGE);
 		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, _repeat ? GL_REPEAT : GL_CLAMP_TO_EDGE);
@@ -114,6 +208,7 @@ namespace Renderer
 		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
 		glTexImage2D(GL_TEXTURE_2D, 0, type, _width, _height, 0, type, GL_UNSIGNED_BYTE, _data);
+		getCurrentFrameStats().textureUploads++;
 
 		return texture;
 
@@ -121,13 +216,21 @@ namespace Renderer
 
 	void destroyTexture(const unsigned int _texture)
 	{
+		flush();
+
+		// The binding falls back to 0 when the bound texture is deleted
+		if(boundTexture == _texture)
+			boundTexture = 0;
+
 		glDeleteTextures(1, &_texture);
 
 	} // destroyTexture
 
 	void updateTexture(const unsigned int _texture, const Texture::Type _type, const unsigned int _x, const unsigned _y, const unsigned int _width, const unsigned int _height, void* _data)
 	{
-		bindTexture(_texture);
+		flush();
+		applyTexture(_texture);
+		getCurrentFrameStats().textureUploads++;
 
 		if (_x == -1 && _y == -1)
 		{
@@ -137,83 +240,83 @@ namespace Renderer
 		else
 			glTexSubImage2D(GL_TEXTURE_2D, 0, _x, _y, _width, _height, convertTextureType(_type), GL_UNSIGNED_BYTE, _data);
 
-		bindTexture(0);
-
 	} // updateTexture
 
-	void bindTexture(const unsigned int _texture)
+	void streamTexture(const unsigned int _texture, const Texture::Type _type, const unsigned int _width, const unsigned int _height, void* _data)
 	{
-		glBindTexture(GL_TEXTURE_2D, _texture);
+		// No pixel buffer objects in GLES 1.0 : the frame ring of the caller keeps the decoder from waiting on the upload
+		flush();
+		applyTexture(_texture);
+		getCurrentFrameStats().textureUploads++;
 
-		if(_texture == 0) glDisable(GL_TEXTURE_2D);
-		else              glEnable(GL_TEXTURE_2D);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, _width, _height, convertTextureType(_type), GL_UNSIGNED_BYTE, _data);
 
-	} // bindTexture
+	} // streamTexture
 
-	void drawLines(const Vertex* _vertices, const unsigned int _numVertices, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
+	bool supportsYUV()
 	{
-		glEnable(GL_BLEND);
-		glBlendFunc(convertBlendFactor(_srcBlendFactor), convertBlendFactor(_dstBlendFactor));
-
-		glEnableClientState(GL_VERTEX_ARRAY);
-		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-		glEnableClientState(GL_COLOR_ARRAY);
-
-		glVertexPointer(  2, GL_FLOAT,         sizeof(Vertex), &_vertices[0].pos);
-		glTexCoordPointer(2, GL_FLOAT,         sizeof(Vertex), &_vertices[0].tex);
-		glColorPointer(   4, GL_UNSIGNED_BYTE, sizeof(Vertex), &_vertices[0].col);
+		// No fragment shaders
+		return false;
 
-		glDrawArrays(GL_LINES, 0, _numVertices);
+	} // supportsYUV
 
-		glDisableClientState(GL_COLOR_ARRAY);
-		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-		glDisableClientState(GL_VERTEX_ARRAY);
+	void setYUVPlanes(const unsigned int _u, const unsigned int _v)
+	{
+	} // setYUVPlanes
 
-		glDisable(GL_BLEND);
+	void drawArrays(const Primitive::Type _type, const Vertex* _vertices, const unsigned int _numVertices, const unsigned int _texture, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
+	{
+		applyTexture(_texture);
+		applyBlend(_srcBlendFactor, _dstBlendFactor);
 
-	} // drawLines
+		const size_t size = _numVertices * sizeof(Vertex);
+		const char*  base = (const char*)_vertices;
 
-	void drawTriangleStrips(const Vertex* _vertices, const unsigned int _numVertices, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
-	{
-		glEnable(GL_BLEND);
-		glBlendFunc(convertBlendFactor(_srcBlendFactor), convertBlendFactor(_dstBlendFactor));
+		if((vertexBuffer != 0) && (size <= VERTEX_BUFFER_SIZE))
+		{
+			bindBuffer(vertexBuffer);
 
-		glEnableClientState(GL_VERTEX_ARRAY);
-		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-		glEnableClientState(GL_COLOR_ARRAY);
+			// Orphan the buffer when it's full : the driver gives a new one instead of waiting for the GPU
+			if(vertexBufferOffset + size > VERTEX_BUFFER_SIZE)
+			{
+				glBufferData(GL_ARRAY_BUFFER, VERTEX_BUFFER_SIZE, nullptr, GL_DYNAMIC_DRAW);
+				vertexBufferOffset = 0;
+			}
 
-		glVertexPointer(  2, GL_FLOAT,         sizeof(Vertex), &_vertices[0].pos);
-		glTexCoordPointer(2, GL_FLOAT,         sizeof(Vertex), &_vertices[0].tex);
-		glColorPointer(   4, GL_UNSIGNED_BYTE, sizeof(Vertex), &_vertices[0].col);
+			glBufferSubData(GL_ARRAY_BUFFER, vertexBufferOffset, size, _vertices);
 
-		glDrawArrays(GL_TRIANGLE_STRIP, 0, _numVertices);
+			base = (const char*)nullptr + vertexBufferOffset;
+			vertexBufferOffset += size;
+		}
+		else if(vertexBuffer != 0)
+			bindBuffer(0);
 
-		glDisableClientState(GL_COLOR_ARRAY);
-		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-		glDisableClientState(GL_VERTEX_ARRAY);
+		glVertexPointer(  2, GL_FLOAT,         sizeof(Vertex), base + offsetof(Vertex, pos));
+		glTexCoordPointer(2, GL_FLOAT,         sizeof(Vertex), base + offsetof(Vertex, tex));
+		glColorPointer(   4, GL_UNSIGNED_BYTE, sizeof(Vertex), base + offsetof(Vertex, col));
 
-		glDisable(GL_BLEND);
+		glDrawArrays((_type == Primitive::LINES) ? GL_LINES : GL_TRIANGLES, 0, _numVertices);
+		getCurrentFrameStats().drawCalls++;
 
-	} // drawTriangleStrips
+	} // drawArrays
 
 	void setProjection(const Transform4x4f& _projection)
 	{
+		flush();
+
 		glMatrixMode(GL_PROJECTION);
 		glLoadMatrixf((GLfloat*)&_projection);
 
-	} // setProjection
-
-	void setMatrix(const Transform4x4f& _matrix)
-	{
-		Transform4x4f matrix = _matrix;
-		matrix.round();
+		// Vertices are transformed on the CPU by setMatrix
 		glMatrixMode(GL_MODELVIEW);
-		glLoadMatrixf((GLfloat*)&matrix);
+		glLoadIdentity();
 
-	} // setMatrix
+	} // setProjection
 
 	void setViewport(const Rect& _viewport)
 	{
+		flush();
+
 		// glViewport starts at the bottom left of the window
 		glViewport( _viewport.x, getWindowHeight() - _viewport.y - _viewport.h, _viewport.w, _viewport.h);
 
@@ -221,6 +324,14 @@ namespace Renderer
 
 	void setScissor(const Rect& _scissor)
 	{
+		if((_scissor.x == scissorRect.x) && (_scissor.y == scissorRect.y) && (_scissor.w == scissorRect.w) && (_scissor.h == scissorRect.h))
+			return;
+
+		flush();
+
+		scissorRect = _scissor;
+		getCurrentFrameStats().stateChanges++;
+
 		if((_scissor.x == 0) && (_scissor.y == 0) && (_scissor.w == 0) && (_scissor.h == 0))
 		{
 			glDisable(GL_SCISSOR_TEST);
@@ -234,6 +345,26 @@ namespace Renderer
 
 	} // setScissor
 
+	void setAlphaTest(const float _threshold)
+	{
+		if(_threshold == alphaTest)
+			return;
+
+		flush();
+
+		alphaTest = _threshold;
+		getCurrentFrameStats().stateChanges++;
+
+		if(_threshold > 0.0f)
+		{
+			glAlphaFunc(GL_GEQUAL, _threshold);
+			glEnable(GL_ALPHA_TEST);
+		}
+		else
+			glDisable(GL_ALPHA_TEST);
+
+	} // setAlphaTest
+
 	void setSwapInterval()
 	{
 		// vsync
@@ -255,83 +386,17 @@ namespace Renderer
 
 	void swapBuffers()
 	{
+		flush();
+		endFrame();
+
 		SDL_GL_SwapWindow(getSDLWindow());
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	} // swapBuffers
 
-#define ROUNDING_PIECES 8.0f
-
-	void drawGLRoundedCorner(float x, float y, double sa, double arc, float r, unsigned int color, std::vector<Vertex> &vertex)
-	{
-		float red = (((color & 0xff000000) >> 24) & 255) / 255.0f;
-		float g = (((color & 0x00ff0000) >> 16) & 255) / 255.0f;
-		float b = (((color & 0x0000ff00) >> 8) & 255) / 255.0f;
-		float a = (((color & 0x000000ff)) & 255) / 255.0f;
-
-		// centre of the arc, for clockwise sense
-		float cent_x = x + r * Math::cosf(sa + ES_PI / 2.0f);
-		float cent_y = y + r * Math::sinf(sa + ES_PI / 2.0f);
-
-		// build up piecemeal including end of the arc
-		int n = ceil(ROUNDING_PIECES * arc / ES_PI * 2.0f);
-		for (int i = 0; i <= n; i++)
-		{
-			float ang = sa + arc * (double)i / (double)n;
-
-			// compute the next point
-			float next_x = cent_x + r * Math::sinf(ang);
-			float next_y = cent_y - r * Math::cosf(ang);
-
-			Vertex vx;
-			vx.pos = Vector2f(next_x, next_y);
-			vx.tex = Vector2f(0, 0);
-			vx.col = color;
-			vertex.push_back(vx);
-		}
-	}
-
-	void drawRoundRect(float x, float y, float width, float height, float radius, unsigned int color, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
-	{
-		auto finalColor = convertColor(color);
-
-		std::vector<Vertex> vertex;
-		drawGLRoundedCorner(x, y + radius, 3.0f * ES_PI / 2.0f, ES_PI / 2.0f, radius, finalColor, vertex);
-		drawGLRoundedCorner(x + width - radius, y, 0.0, ES_PI / 2.0f, radius, finalColor, vertex);
-		drawGLRoundedCorner(x + width, y + height - radius, ES_PI / 2.0f, ES_PI / 2.0f, radius, finalColor, vertex);
-		drawGLRoundedCorner(x + radius, y + height, ES_PI, ES_PI / 2.0f, radius, finalColor, vertex);
-
-		Vertex* vxs = new Vertex[vertex.size()];
-		for (int i = 0; i < vertex.size(); i++)
-			vxs[i] = vertex[i];
-
-		bindTexture(0);
-
-		glEnable(GL_BLEND);
-		glBlendFunc(convertBlendFactor(_srcBlendFactor), convertBlendFactor(_dstBlendFactor));
-
-		glEnableClientState(GL_VERTEX_ARRAY);
-		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-		glEnableClientState(GL_COLOR_ARRAY);
-
-		glVertexPointer(2, GL_FLOAT, sizeof(Vertex), &vxs[0].pos);
-		glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), &vxs[0].tex);
-		glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), &vxs[0].col);
-
-		glDrawArrays(GL_TRIANGLE_FAN, 0, vertex.size());
-
-		glDisableClientState(GL_COLOR_ARRAY);
-		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-		glDisableClientState(GL_VERTEX_ARRAY);
-		glDisable(GL_BLEND);
-
-		delete[] vxs;	
-	}
-
 	void enableRoundCornerStencil(float x, float y, float width, float height, float radius)
 	{
-		bool tx = glIsEnabled(GL_TEXTURE_2D);
-		glDisable(GL_TEXTURE_2D);
+		flush();
 
 		glClear(GL_DEPTH_BUFFER_BIT);
 		glEnable(GL_STENCIL_TEST);
@@ -344,6 +409,7 @@ namespace Renderer
 		glClear(GL_STENCIL_BUFFER_BIT);
 
 		drawRoundRect(x, y, width, height, radius, 0xFFFFFFFF);
+		flush();
 
 		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 		glDepthMask(GL_TRUE);
@@ -351,13 +417,15 @@ namespace Renderer
 		glStencilFunc(GL_EQUAL, 0, 0xFF);
 		glStencilFunc(GL_EQUAL, 1, 0xFF);
 
-		if (tx)
-			glEnable(GL_TEXTURE_2D);
+		getCurrentFrameStats().stateChanges++;
 	}
 
 	void disableStencil()
 	{
+		flush();
+
 		glDisable(GL_STENCIL_TEST);
+		getCurrentFrameStats().stateChanges++;
 	}
 } // Renderer::
 
@@ -0,0 +1,172 @@
+#if defined(USE_NULL_RENDERER)
+
+#include "renderers/Renderer.h"
+#include "math/Transform4x4f.h"
+#include "Log.h"
+
+#include <SDL.h>
+
+//
+// Headless backend : nothing is rasterised, draws and texture uploads are only counted in the frame stats.
+// Used to measure the CPU cost of the UI (see --benchmark) on machines without a GPU. Run it with
+// SDL_VIDEODRIVER=dummy when there is no display
+//
+namespace Renderer
+{
+	static unsigned int nextTexture  = 1;
+	static unsigned int boundTexture = 0;
+	static Rect         scissorRect  = Rect(0, 0, 0, 0);
+	static float        alphaTest    = 0.0f;
+
+	unsigned int convertColor(const unsigned int _color)
+	{
+		// convert from rgba to abgr
+		unsigned char r = ((_color & 0xff000000) >> 24) & 255;
+		unsigned char g = ((_color & 0x00ff0000) >> 16) & 255;
+		unsigned char b = ((_color & 0x0000ff00) >>  8) & 255;
+		unsigned char a = ((_color & 0x000000ff)      ) & 255;
+
+		return ((a << 24) | (b << 16) | (g << 8) | (r));
+
+	} // convertColor
+
+	unsigned int getWindowFlags()
+	{
+		return SDL_WINDOW_HIDDEN;
+
+	} // getWindowFlags
+
+	void setupWindow()
+	{
+	} // setupWindow
+
+	void createContext()
+	{
+		LOG(LogInfo) << "Null renderer : nothing will be displayed";
+
+	} // createContext
+
+	void destroyContext()
+	{
+		boundTexture = 0;
+		scissorRect  = Rect(0, 0, 0, 0);
+		alphaTest    = 0.0f;
+
+	} // destroyContext
+
+	unsigned int createTexture(const Texture::Type _type, const bool _linear, const bool _repeat, const unsigned int _width, const unsigned int _height, void* _data)
+	{
+		flush();
+		getCurrentFrameStats().textureUploads++;
+
+		return nextTexture++;
+
+	} // createTexture
+
+	void destroyTexture(const unsigned int _texture)
+	{
+		flush();
+
+		if(boundTexture == _texture)
+			boundTexture = 0;
+
+	} // destroyTexture
+
+	void updateTexture(const unsigned int _texture, const Texture::Type _type, const unsigned int _x, const unsigned _y, const unsigned int _width, const unsigned int _height, void* _data)
+	{
+		flush();
+		getCurrentFrameStats().textureUploads++;
+
+	} // updateTexture
+
+	void streamTexture(const unsigned int _texture, const Texture::Type _type, const unsigned int _width, const unsigned int _height, void* _data)
+	{
+		flush();
+		getCurrentFrameStats().textureUploads++;
+
+	} // streamTexture
+
+	bool supportsYUV()
+	{
+		return false;
+
+	} // supportsYUV
+
+	void setYUVPlanes(const unsigned int _u, const unsigned int _v)
+	{
+	} // setYUVPlanes
+
+	void drawArrays(const Primitive::Type _type, const Vertex* _vertices, const unsigned int _numVertices, const unsigned int _texture, const Blend::Factor _srcBlendFactor, const Blend::Factor _dstBlendFactor)
+	{
+		if(boundTexture != _texture)
+		{
+			boundTexture = _texture;
+			getCurrentFrameStats().stateChanges++;
+			getCurrentFrameStats().textureBinds++;
+		}
+
+		getCurrentFrameStats().drawCalls++;
+
+	} // drawArrays
+
+	void setProjection(const Transform4x4f& _projection)
+	{
+		flush();
+
+	} // setProjection
+
+	void setViewport(const Rect& _viewport)
+	{
+		flush();
+
+	} // setViewport
+
+	void setScissor(const Rect& _scissor)
+	{
+		// Same redundant state check as the GL backends, so the stats match theirs
+		if((_scissor.x == scissorRect.x) && (_scissor.y == scissorRect.y) && (_scissor.w == scissorRect.w) && (_scissor.h == scissorRect.h))
+			return;
+
+		flush();
+
+		scissorRect = _scissor;
+		getCurrentFrameStats().stateChanges++;
+
+	} // setScissor
+
+	void setAlphaTest(const float _threshold)
+	{
+		if(_threshold == alphaTest)
+			return;
+
+		flush();
+
+		alphaTest = _threshold;
+		getCurrentFrameStats().stateChanges++;
+
+	} // setAlphaTest
+
+	void setSwapInterval()
+	{
+	} // setSwapInterval
+
+	void swapBuffers()
+	{
+		flush();
+		endFrame();
+
+	} // swapBuffers
+
+	void enableRoundCornerStencil(float x, float y, float width, float height, float radius)
+	{
+		flush();
+	}
+
+	void disableStencil()
+	{
+		flush();
+	}
+
+} // Renderer::
+
+#endif // USE_NULL_RENDERER
@@ -4,25 +4,167 @@
 #include "utils/FileSystemUtil.h"
 #include "utils/StringUtil.h"
 #include "Log.h"
+#include "Settings.h"
 #include "math/Misc.h"
+#include <algorithm>
+#include <functional>
+#include <math.h>
+#include <mutex>
+#include <string.h>
 
 #ifdef WIN32
 #include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
+#define FONT_TEXTURE_WIDTH		2048
+#define FONT_TEXTURE_HEIGHT		512
+
+#define DISTANCE_FIELD_SIZE		64 // size of the distance field glyphs in the textures
+#define DISTANCE_FIELD_SPREAD	4 // distance range around the outlines, in texels
+
 FT_Library Font::sLibrary = NULL;
 
 int Font::getSize() const { return mSize; }
 
 std::map< std::pair<std::string, int>, std::weak_ptr<Font> > Font::sFontMap;
+std::map< std::string, std::weak_ptr<Font> > Font::sDistanceFieldMap;
+std::vector<Font::FontTexture*> Font::sTextures;
+
+//
+// Font files are mapped read-only and shared by every Font instance and size using them : the pages belong to the file,
+// the system only reads what FreeType touches and can drop them under memory pressure. Where mapping isn't available,
+// the file is loaded once and shared the same way.
+// Fallback fonts stay open for the whole run, with the list of the codepoints they have, so the fallback search
+// never creates a face that cannot render the glyph
+//
+class Font::FontFile
+{
+public:
+	static std::shared_ptr<FontFile> get(const std::string& path, bool keep);
+
+	FontFile(const ResourceData& d, bool m) : data(d), mapped(m) { }
+
+	bool hasGlyph(unsigned int id);
+
+	const ResourceData	data;
+	const bool			mapped;
+
+private:
+	static ResourceData map(const std::string& path);
+
+	void buildCoverage();
+
+	std::vector<unsigned int>	mCoverage; // One bit per codepoint
+	std::once_flag				mCoverageBuilt; // The file is shared by the faces of every size, used from any thread
+
+	static std::mutex sMutex;
+	static std::map<std::string, std::weak_ptr<FontFile>> sFiles;
+	static std::vector<std::shared_ptr<FontFile>> sKeptFiles;
+};
+
+std::mutex Font::FontFile::sMutex;
+std::map<std::string, std::weak_ptr<Font::FontFile>> Font::FontFile::sFiles;
+std::vector<std::shared_ptr<Font::FontFile>> Font::FontFile::sKeptFiles;
+
+ResourceData Font::FontFile::map(const std::string& path)
+{
+	ResourceData empty = { NULL, 0 };
+
+#ifndef WIN32
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return empty;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0)
+	{
+		close(fd);
+		return empty;
+	}
+
+	size_t length = (size_t)st.st_size;
+	void* ptr = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (ptr == MAP_FAILED)
+		return empty;
+
+	ResourceData data = { std::shared_ptr<unsigned char>((unsigned char*)ptr, [length](unsigned char* p) { munmap(p, length); }), length };
+	return data;
+#else
+	return empty;
+#endif
+}
+
+std::shared_ptr<Font::FontFile> Font::FontFile::get(const std::string& path, bool keep)
+{
+	std::unique_lock<std::mutex> lock(sMutex);
+
+	auto it = sFiles.find(path);
+	if (it != sFiles.cend())
+	{
+		auto file = it->second.lock();
+		if (file)
+			return file;
+	}
+
+	std::shared_ptr<FontFile> file;
+
+	ResourceData data = map(ResourceManager::getInstance()->getResourcePath(path));
+	if (data.ptr)
+		file = std::make_shared<FontFile>(data, true);
+	else
+		file = std::make_shared<FontFile>(ResourceManager::getInstance()->getFileData(path), false);
 
-Font::FontFace::FontFace(ResourceData&& d, int size) : data(d)
+	sFiles[path] = file;
+	if (keep)
+		sKeptFiles.push_back(file);
+
+	return file;
+}
+
+void Font::FontFile::buildCoverage()
+{
+	// Walk the charmap of a size-less face once, only the cmap table of the file gets read
+	FT_Face face;
+	if (data.ptr && FT_New_Memory_Face(sLibrary, data.ptr.get(), (FT_Long)data.length, 0, &face) == 0)
+	{
+		FT_UInt index;
+		for (FT_ULong code = FT_Get_First_Char(face, &index); index != 0; code = FT_Get_Next_Char(face, code, &index))
+		{
+			if (code / 32 >= mCoverage.size())
+				mCoverage.resize(code / 32 + 1, 0);
+
+			mCoverage[code / 32] |= 1u << (code % 32);
+		}
+
+		FT_Done_Face(face);
+		mCoverage.shrink_to_fit();
+	}
+}
+
+bool Font::FontFile::hasGlyph(unsigned int id)
+{
+	// Other threads wait for the bitmap to be complete, and see it once call_once returns
+	std::call_once(mCoverageBuilt, &FontFile::buildCoverage, this);
+
+	return id / 32 < mCoverage.size() && (mCoverage[id / 32] & (1u << (id % 32))) != 0;
+}
+
+Font::FontFace::FontFace(const std::shared_ptr<FontFile>& f, int size) : file(f), face(NULL)
 {
-	int err = FT_New_Memory_Face(sLibrary, data.ptr.get(), (FT_Long)data.length, 0, &face);
+	int err = FT_New_Memory_Face(sLibrary, file->data.ptr.get(), (FT_Long)file->data.length, 0, &face);
 	assert(!err);
 	
 	if(!err)
 		FT_Set_Pixel_Sizes(face, 0, size);
+	else
+		face = NULL;
 }
 
 Font::FontFace::~FontFace()
@@ -43,12 +185,16 @@ void Font::initLibrary()
 
 size_t Font::getMemUsage() const
 {
+	// alpha textures, one byte per texel
 	size_t memUsage = 0;
-	for(auto it = mTextures.cbegin(); it != mTextures.cend(); it++)
-		memUsage += it->textureSize.x() * it->textureSize.y() * 4;
+	for(auto tex : sTextures)
+		if(tex->owner == this && tex->textureId != 0)
+			memUsage += tex->textureSize.x() * tex->textureSize.y();
 
+	// Mapped files are shared and paged from the disk
 	for(auto it = mFaceCache.cbegin(); it != mFaceCache.cend(); it++)
-		memUsage += it->second->data.length;
+		if(!it->second->file->mapped)
+			memUsage += it->second->file->data.length;
 
 	return memUsage;
 }
@@ -70,15 +216,28 @@ size_t Font::getTotalMemUsage()
 		it++;
 	}
 
+	auto dit = sDistanceFieldMap.cbegin();
+	while(dit != sDistanceFieldMap.cend())
+	{
+		if(dit->second.expired())
+		{
+			dit = sDistanceFieldMap.erase(dit);
+			continue;
+		}
+
+		total += dit->second.lock()->getMemUsage();
+		dit++;
+	}
+
 	return total;
 }
 
-Font::Font(int size, const std::string& path) : mSize(size), mPath(path)
+Font::Font(int size, const std::string& path, bool distanceField) : mDistanceField(distanceField), mSize(size), mPath(path)
 {
 	mSize = size;
 
 	// GPI
-	if (Renderer::isSmallScreen())
+	if (Renderer::isSmallScreen() && !mDistanceField)
 	{
 		float sz = Math::min(Renderer::getScreenWidth(), Renderer::getScreenHeight());
 		if (sz >= 320) // ODROID 480x320;
@@ -95,6 +254,20 @@ Font::Font(int size, const std::string& path) : mSize(size), mPath(path)
 	if(!sLibrary)
 		initLibrary();
 
+	if(!mDistanceField && Settings::getInstance()->getBool("FontDistanceField"))
+	{
+		auto it = sDistanceFieldMap.find(mPath);
+		if(it != sDistanceFieldMap.cend())
+			mDistanceFieldSource = it->second.lock();
+
+		if(!mDistanceFieldSource)
+		{
+			mDistanceFieldSource = std::shared_ptr<Font>(new Font(DISTANCE_FIELD_SIZE, mPath, true));
+			sDistanceFieldMap[mPath] = std::weak_ptr<Font>(mDistanceFieldSource);
+			ResourceManager::getInstance()->addReloadable(mDistanceFieldSource);
+		}
+	}
+
 	for (unsigned int i = 0; i < 255; i++)
 		mGlyphCacheArray[i] = NULL;
 
@@ -111,6 +284,17 @@ Font::~Font()
 		delete it->second;
 
 	unload();
+
+	// give our textures back
+	for (auto tex : sTextures)
+	{
+		if (tex->owner == this)
+		{
+			tex->deinitTexture();
+			tex->reset();
+			tex->owner = NULL;
+		}
+	}
 }
 
 void Font::reload()
@@ -154,18 +338,23 @@ std::shared_ptr<Font> Font::get(int size, const std::string& path)
 
 void Font::unloadTextures()
 {
-	for(auto it = mTextures.begin(); it != mTextures.end(); it++)
+	for(auto tex : sTextures)
 	{
-		it->deinitTexture();
+		if(tex->owner == this)
+			tex->deinitTexture();
 	}
 }
 
 Font::FontTexture::FontTexture()
 {
 	textureId = 0;
-	textureSize = Vector2i(2048, 512);
+	textureSize = Vector2i(FONT_TEXTURE_WIDTH, FONT_TEXTURE_HEIGHT);
 	writePos = Vector2i::Zero();
 	rowHeight = 0;
+	linear = false;
+	owner = NULL;
+	generation = 0;
+	lastUsed = 0;
 }
 
 Font::FontTexture::~FontTexture()
@@ -203,10 +392,17 @@ bool Font::FontTexture::findEmpty(const Vector2i& size, Vector2i& cursor_out)
 	return true;
 }
 
+void Font::FontTexture::reset()
+{
+	writePos = Vector2i::Zero();
+	rowHeight = 0;
+	generation++;
+}
+
 void Font::FontTexture::initTexture()
 {
 	assert(textureId == 0);
-	textureId = Renderer::createTexture(Renderer::Texture::ALPHA, false, false, textureSize.x(), textureSize.y(), nullptr);
+	textureId = Renderer::createTexture(Renderer::Texture::ALPHA, linear, false, textureSize.x(), textureSize.y(), nullptr);
 }
 
 void Font::FontTexture::deinitTexture()
@@ -220,21 +416,68 @@ void Font::FontTexture::deinitTexture()
 
 void Font::getTextureForNewGlyph(const Vector2i& glyphSize, FontTexture*& tex_out, Vector2i& cursor_out)
 {
-	if(mTextures.size())
+	// check if one of our textures has space
+	for(auto tex : sTextures)
+	{
+		if(tex->owner == this && tex->findEmpty(glyphSize, cursor_out))
+		{
+			tex_out = tex;
+			return;
+		}
+	}
+
+	// our textures are full : over the limit, empty the texture of any font used the longest time ago.
+	// Textures used in the current frame are never evicted, so the limit can be exceeded
+	tex_out = NULL;
+
+	const size_t maxVRAM = (size_t)Math::max(0, Settings::getInstance()->getInt("FontMaxVRAM")) * 1024 * 1024;
+	const unsigned int frame = Renderer::getFrameCount();
+
+	size_t used = 0;
+	for(auto tex : sTextures)
+		if(tex->textureId != 0)
+			used += tex->textureSize.x() * tex->textureSize.y();
+
+	if(maxVRAM != 0 && used + FONT_TEXTURE_WIDTH * FONT_TEXTURE_HEIGHT > maxVRAM)
+	{
+		for(auto tex : sTextures)
+			if(tex->owner != NULL && tex->lastUsed != frame && (tex_out == NULL || tex->lastUsed < tex_out->lastUsed))
+				tex_out = tex;
+
+		if(tex_out != NULL)
+			tex_out->owner->evictTexture(tex_out);
+	}
+
+	// otherwise take a free texture, or make a new one
+	if(tex_out == NULL)
 	{
-		// check if the most recent texture has space
-		tex_out = &mTextures.back();
+		for(auto tex : sTextures)
+		{
+			if(tex->owner == NULL)
+			{
+				tex_out = tex;
+				break;
+			}
+		}
+	}
 
-		// will this one work?
-		if(tex_out->findEmpty(glyphSize, cursor_out))
-			return; // yes
+	if(tex_out == NULL)
+	{
+		tex_out = new FontTexture();
+		sTextures.push_back(tex_out);
 	}
 
-	// current textures are full,
-	// make a new one
-	mTextures.push_back(FontTexture());
-	tex_out = &mTextures.back();
-	tex_out->initTexture();
+	tex_out->owner = this;
+	tex_out->lastUsed = frame;
+
+	if(tex_out->textureId != 0 && tex_out->linear != mDistanceField)
+		tex_out->deinitTexture();
+
+	if(tex_out->textureId == 0)
+	{
+		tex_out->linear = mDistanceField;
+		tex_out->initTexture();
+	}
 	
 	bool ok = tex_out->findEmpty(glyphSize, cursor_out);
 	if(!ok)
@@ -244,6 +487,31 @@ void Font::getTextureForNewGlyph(const Vector2i& glyphSize, FontTexture*& tex_ou
 	}
 }
 
+void Font::evictTexture(FontTexture* tex)
+{
+	for(auto it = mGlyphMap.begin(); it != mGlyphMap.end(); )
+	{
+		if(it->second->texture == tex)
+			dropGlyph(it++);
+		else
+			it++;
+	}
+
+	LOG(LogDebug) << "Font : glyph texture evicted from " << mPath << ", size " << mSize;
+
+	tex->reset();
+	tex->owner = NULL;
+}
+
+void Font::dropGlyph(std::map<unsigned int, Glyph*>::iterator it)
+{
+	if(it->first < 255)
+		mGlyphCacheArray[it->first] = NULL;
+
+	delete it->second;
+	mGlyphMap.erase(it);
+}
+
 std::vector<std::string> getFallbackFontPaths()
 {
 #ifdef WIN32
@@ -313,14 +581,22 @@ FT_Face Font::getFaceForChar(unsigned int id)
 		if(fit == mFaceCache.cend()) // doesn't exist yet
 		{
 			// i == 0 -> mPath
-			// otherwise, take from fallbackFonts
-			const std::string& path = (i == 0 ? mPath : fallbackFonts.at(i - 1));
-			ResourceData data = ResourceManager::getInstance()->getFileData(path);
-			mFaceCache[i] = std::unique_ptr<FontFace>(new FontFace(std::move(data), mSize));
+			// otherwise, take from fallbackFonts, if it has the glyph
+			std::shared_ptr<FontFile> file;
+			if(i == 0)
+				file = FontFile::get(mPath, false);
+			else
+			{
+				file = FontFile::get(fallbackFonts.at(i - 1), true);
+				if(!file->hasGlyph(id))
+					continue;
+			}
+
+			mFaceCache[i] = std::unique_ptr<FontFace>(new FontFace(file, mSize));
 			fit = mFaceCache.find(i);
 		}
 
-		if(FT_Get_Char_Index(fit->second->face, id) != 0)
+		if(fit->second->face != NULL && FT_Get_Char_Index(fit->second->face, id) != 0)
 			return fit->second->face;
 	}
 
@@ -333,69 +609,190 @@ void Font::clearFaceCache()
 	mFaceCache.clear();
 }
 
+// Signed distance to the outline of the glyph, in texels : 0.5 on the outline, 0 and 1 at DISTANCE_FIELD_SPREAD texels outside and inside
+static void buildDistanceField(const std::vector<unsigned char>& coverage, const Vector2i& coverageSize, std::vector<unsigned char>& field, Vector2i& size)
+{
+	const int spread = DISTANCE_FIELD_SPREAD;
+
+	size = Vector2i(coverageSize.x() + spread * 2, coverageSize.y() + spread * 2);
+
+	std::vector<unsigned char> inside(size.x() * size.y(), 0);
+	for(int y = 0; y < coverageSize.y(); y++)
+		for(int x = 0; x < coverageSize.x(); x++)
+			inside[(y + spread) * size.x() + x + spread] = coverage[y * coverageSize.x() + x] >= 128;
+
+	field.resize(size.x() * size.y());
+
+	for(int y = 0; y < size.y(); y++)
+	{
+		for(int x = 0; x < size.x(); x++)
+		{
+			const unsigned char in = inside[y * size.x() + x];
+			int nearest = (spread + 1) * (spread + 1);
+
+			// nearest texel on the other side of the outline
+			for(int dy = -spread; dy <= spread; dy++)
+			{
+				if(y + dy < 0 || y + dy >= size.y())
+				{
+					if(in && dy * dy < nearest)
+						nearest = dy * dy;
+
+					continue;
+				}
+
+				for(int dx = -spread; dx <= spread; dx++)
+				{
+					const int d = dx * dx + dy * dy;
+					if(d >= nearest)
+						continue;
+
+					const bool other = (x + dx < 0 || x + dx >= size.x()) ? in != 0 : inside[(y + dy) * size.x() + x + dx] != in;
+					if(other)
+						nearest = d;
+				}
+			}
+
+			float distance = Math::min(sqrtf((float)nearest) - 0.5f, (float)spread);
+			if(!in)
+				distance = -distance;
+
+			field[y * size.x() + x] = (unsigned char)(Math::clamp(0.5f + distance / (spread * 2), 0.0f, 1.0f) * 255.0f);
+		}
+	}
+}
+
+// Renders the glyph : its coverage, or its distance field for the source of distance field fonts. Bearing is the position of the pixels
+bool Font::rasterizeGlyph(unsigned int id, FT_GlyphSlot& slot, Vector2i& size, Vector2f& bearing, std::vector<unsigned char>& pixels)
+{
+	FT_Face face = getFaceForChar(id);
+	if(!face)
+	{
+		LOG(LogError) << "Could not find appropriate font face for character " << id << " for font " << mPath;
+		return false;
+	}
+
+	slot = face->glyph;
+
+	if(FT_Load_Char(face, id, FT_LOAD_RENDER))
+	{
+		LOG(LogError) << "Could not find glyph for character " << id << " for font " << mPath << ", size " << mSize << "!";
+		return false;
+	}
+
+	size = Vector2i(slot->bitmap.width, slot->bitmap.rows);
+	bearing = Vector2f((float)slot->metrics.horiBearingX / 64.0f, (float)slot->metrics.horiBearingY / 64.0f);
+
+	pixels.resize(size.x() * size.y());
+	for(int y = 0; y < size.y(); y++)
+		memcpy(&pixels[y * size.x()], slot->bitmap.buffer + y * slot->bitmap.pitch, size.x());
+
+	if(mDistanceField && size.x() > 0 && size.y() > 0)
+	{
+		std::vector<unsigned char> field;
+		buildDistanceField(pixels, size, field, size);
+		pixels.swap(field);
+
+		bearing += Vector2f(-DISTANCE_FIELD_SPREAD, DISTANCE_FIELD_SPREAD);
+	}
+
+	return true;
+}
+
 Font::Glyph* Font::getGlyph(unsigned int id)
 {
+	Glyph* cached = NULL;
+
 	if (id < 255)
 	{
 		// FCA Optimisation : array is faster than a map
 		// When computing & displaying long descriptions in gamelist views, it can come here textsize*2 times per frame
-		Glyph* fastCache = mGlyphCacheArray[id];
-		if (fastCache != NULL)
-			return fastCache;
+		cached = mGlyphCacheArray[id];
 	}
 	else
 	{
 		// is it already loaded?
 		auto it = mGlyphMap.find(id);
 		if (it != mGlyphMap.cend())
-			return it->second;
+			cached = it->second;
 	}
 
-	// nope, need to make a glyph
-	FT_Face face = getFaceForChar(id);
-	if(!face)
+	if (cached != NULL)
 	{
-		LOG(LogError) << "Could not find appropriate font face for character " << id << " for font " << mPath;
-		return NULL;
+		// the glyphs of distance field fonts are copies, the source glyph may have been evicted since
+		if (cached->generation == cached->texture->generation)
+		{
+			cached->texture->lastUsed = Renderer::getFrameCount();
+			return cached;
+		}
+
+		dropGlyph(mGlyphMap.find(id));
 	}
 
-	FT_GlyphSlot g = face->glyph;
+	// nope, need to make a glyph
+	Glyph* pGlyph = NULL;
 
-	if(FT_Load_Char(face, id, FT_LOAD_RENDER))
+	if(mDistanceFieldSource)
 	{
-		LOG(LogError) << "Could not find glyph for character " << id << " for font " << mPath << ", size " << mSize << "!";
-		return NULL;
+		// the same distance field, scaled
+		Glyph* source = mDistanceFieldSource->getGlyph(id);
+		if(source == NULL)
+			return NULL;
+
+		const float scale = mSize / (float)DISTANCE_FIELD_SIZE;
+
+		pGlyph = new Glyph(*source);
+		pGlyph->scale = scale;
+		pGlyph->advance = source->advance * scale;
+		pGlyph->bearing = source->bearing * scale;
+
+		// update max glyph height
+		int glyphHeight = (int)((source->texSize.y() * source->texture->textureSize.y() - DISTANCE_FIELD_SPREAD * 2) * scale);
+		if(glyphHeight > mMaxGlyphHeight)
+			mMaxGlyphHeight = glyphHeight;
 	}
+	else
+	{
+		FT_GlyphSlot g;
+		Vector2i glyphSize;
+		Vector2f bearing;
+		std::vector<unsigned char> pixels;
 
-	Vector2i glyphSize(g->bitmap.width, g->bitmap.rows);
+		if(!rasterizeGlyph(id, g, glyphSize, bearing, pixels))
+			return NULL;
 
-	FontTexture* tex = NULL;
-	Vector2i cursor;
-	getTextureForNewGlyph(glyphSize, tex, cursor);
+		FontTexture* tex = NULL;
+		Vector2i cursor;
+		getTextureForNewGlyph(glyphSize, tex, cursor);
 
-	// getTextureForNewGlyph can fail if the glyph is bigger than the max texture size (absurdly large font size)
-	if(tex == NULL)
-	{
-		LOG(LogError) << "Could not create glyph for character " << id << " for font " << mPath << ", size " << mSize << " (no suitable texture found)!";
-		return NULL;
-	}
+		// getTextureForNewGlyph can fail if the glyph is bigger than the max texture size (absurdly large font size)
+		if(tex == NULL)
+		{
+			LOG(LogError) << "Could not create glyph for character " << id << " for font " << mPath << ", size " << mSize << " (no suitable texture found)!";
+			return NULL;
+		}
 
-	// create glyph
-	Glyph* pGlyph = new Glyph();
-	
-	pGlyph->texture = tex;
-	pGlyph->texPos = Vector2f(cursor.x() / (float)tex->textureSize.x(), cursor.y() / (float)tex->textureSize.y());
-	pGlyph->texSize = Vector2f(glyphSize.x() / (float)tex->textureSize.x(), glyphSize.y() / (float)tex->textureSize.y());
+		// create glyph
+		pGlyph = new Glyph();
 
-	pGlyph->advance = Vector2f((float)g->metrics.horiAdvance / 64.0f, (float)g->metrics.vertAdvance / 64.0f);
-	pGlyph->bearing = Vector2f((float)g->metrics.horiBearingX / 64.0f, (float)g->metrics.horiBearingY / 64.0f);
+		pGlyph->texture = tex;
+		pGlyph->texPos = Vector2f(cursor.x() / (float)tex->textureSize.x(), cursor.y() / (float)tex->textureSize.y());
+		pGlyph->texSize = Vector2f(glyphSize.x() / (float)tex->textureSize.x(), glyphSize.y() / (float)tex->textureSize.y());
 
-	// upload glyph bitmap to texture
-	Renderer::updateTexture(tex->textureId, Renderer::Texture::ALPHA, cursor.x(), cursor.y(), glyphSize.x(), glyphSize.y(), g->bitmap.buffer);
+		pGlyph->advance = Vector2f((float)g->metrics.horiAdvance / 64.0f, (float)g->metrics.vertAdvance / 64.0f);
+		pGlyph->bearing = bearing;
 
-	// update max glyph height
-	if(glyphSize.y() > mMaxGlyphHeight)
-		mMaxGlyphHeight = glyphSize.y();
+		pGlyph->scale = 1.0f;
+		pGlyph->generation = tex->generation;
+
+		// upload glyph bitmap to texture
+		if(glyphSize.x() > 0 && glyphSize.y() > 0)
+			Renderer::updateTexture(tex->textureId, Renderer::Texture::ALPHA, cursor.x(), cursor.y(), glyphSize.x(), glyphSize.y(), &pixels[0]);
+
+		// update max glyph height
+		if(glyphSize.y() > mMaxGlyphHeight)
+			mMaxGlyphHeight = glyphSize.y();
+	}
 
 	mGlyphMap[id] = pGlyph;
 
@@ -410,29 +807,36 @@ Font::Glyph* Font::getGlyph(unsigned int id)
 void Font::rebuildTextures()
 {
 	// recreate OpenGL textures
-	for(auto it = mTextures.begin(); it != mTextures.end(); it++)
+	for(auto tex : sTextures)
 	{
-		it->initTexture();
+		if(tex->owner == this && tex->textureId == 0)
+			tex->initTexture();
 	}
 
-	// reupload the texture data
+	// reupload the texture data, the glyphs of distance field fonts are in the textures of their source
+	FT_GlyphSlot glyphSlot;
+	Vector2i glyphSize;
+	Vector2f bearing;
+	std::vector<unsigned char> pixels;
+
 	for(auto it = mGlyphMap.cbegin(); it != mGlyphMap.cend(); it++)
 	{
-		FT_Face face = getFaceForChar(it->first);
-		FT_GlyphSlot glyphSlot = face->glyph;
+		FontTexture* tex = it->second->texture;
+		if(tex->owner != this)
+			continue;
 
 		// load the glyph bitmap through FT
-		FT_Load_Char(face, it->first, FT_LOAD_RENDER);
+		if(!rasterizeGlyph(it->first, glyphSlot, glyphSize, bearing, pixels) || glyphSize.x() == 0 || glyphSize.y() == 0)
+			continue;
 
-		FontTexture* tex = it->second->texture;
-		
-		// find the position/size
+		// find the position
 		Vector2i cursor((int)(it->second->texPos.x() * tex->textureSize.x()), (int)(it->second->texPos.y() * tex->textureSize.y()));
-		Vector2i glyphSize((int)(it->second->texSize.x() * tex->textureSize.x()), (int)(it->second->texSize.y() * tex->textureSize.y()));
 		
 		// upload to texture
-		Renderer::updateTexture(tex->textureId, Renderer::Texture::ALPHA, cursor.x(), cursor.y(), glyphSize.x(), glyphSize.y(), glyphSlot->bitmap.buffer);
+		Renderer::updateTexture(tex->textureId, Renderer::Texture::ALPHA, cursor.x(), cursor.y(), glyphSize.x(), glyphSize.y(), &pixels[0]);
 	}
+
+	clearFaceCache();
 }
 
 void Font::renderTextCache(TextCache* cache)
@@ -443,15 +847,43 @@ void Font::renderTextCache(TextCache* cache)
 		return;
 	}
 
+	rebuildTextCache(cache);
+
+	// distance fields : the outline is where the alpha of the texture is 0.5
+	if(mDistanceFieldSource)
+		Renderer::setAlphaTest(0.5f * (cache->color & 0xFF) / 255.0f);
+
+	const unsigned int frame = Renderer::getFrameCount();
+
 	for(auto it = cache->vertexLists.cbegin(); it != cache->vertexLists.cend(); it++)
 	{
-		if (*it->textureIdPtr == 0)
+		if (it->texture->textureId == 0)
 			continue;
+
+		it->texture->lastUsed = frame;
 		
-		Renderer::bindTexture(*it->textureIdPtr);
+		Renderer::bindTexture(it->texture->textureId);
 		Renderer::drawTriangleStrips(&it->verts[0], it->verts.size());
 		Renderer::bindTexture(0);		
 	}
+
+	if(mDistanceFieldSource)
+		Renderer::setAlphaTest(0.0f);
+}
+
+// builds the cache again if some of its glyphs were evicted from their texture
+void Font::rebuildTextCache(TextCache* cache)
+{
+	bool evicted = false;
+	for(auto it = cache->vertexLists.cbegin(); it != cache->vertexLists.cend(); it++)
+		evicted |= (it->generation != it->texture->generation);
+
+	if(!evicted)
+		return;
+
+	TextCache* rebuilt = buildTextCache(cache->text, cache->offset, cache->color, cache->xLen, cache->alignment, cache->lineSpacing);
+	cache->vertexLists.swap(rebuilt->vertexLists);
+	delete rebuilt;
 }
 
 void Font::renderGradientTextCache(TextCache* cache, unsigned int colorTop, unsigned int colorBottom, bool horz)
@@ -462,9 +894,18 @@ void Font::renderGradientTextCache(TextCache* cache, unsigned int colorTop, unsi
 		return;
 	}
 
+	rebuildTextCache(cache);
+
+	if(mDistanceFieldSource)
+		Renderer::setAlphaTest(0.5f * Math::min((int)(colorTop & 0xFF), (int)(colorBottom & 0xFF)) / 255.0f);
+
+	const unsigned int frame = Renderer::getFrameCount();
+
 	for (auto it = cache->vertexLists.cbegin(); it != cache->vertexLists.cend(); it++)
 	{
-		assert(*it->textureIdPtr != 0);
+		assert(it->texture->textureId != 0);
+
+		it->texture->lastUsed = frame;
 
 		std::vector<Renderer::Vertex> vxs;
 		vxs.resize(it->verts.size());
@@ -503,10 +944,13 @@ void Font::renderGradientTextCache(TextCache* cache, unsigned int colorTop, unsi
 			vxs[i + 5] = vxs[i + 4];
 		}
 
-		Renderer::bindTexture(*it->textureIdPtr);
+		Renderer::bindTexture(it->texture->textureId);
 		Renderer::drawTriangleStrips(&vxs[0], vxs.size());
 		Renderer::bindTexture(0);
 	}
+
+	if(mDistanceFieldSource)
+		Renderer::setAlphaTest(0.0f);
 }
 
 
@@ -531,6 +975,7 @@ Vector2f Font::sizeText(std::string text, float lineSpacing)
 
 			lineWidth = 0.0f;
 			y += lineHeight;
+			continue;
 		}
 
 		Glyph* glyph = getGlyph(character);
@@ -553,55 +998,116 @@ float Font::getLetterHeight()
 {
 	Glyph* glyph = getGlyph('S');
 	assert(glyph);
-	return glyph->texSize.y() * glyph->texture->textureSize.y();
+
+	float height = glyph->texSize.y() * glyph->texture->textureSize.y();
+	if(mDistanceFieldSource)
+		height = (height - DISTANCE_FIELD_SPREAD * 2) * glyph->scale;
+
+	return height;
 }
 
-//the worst algorithm ever written
-//breaks up a normal string with newlines to make it fit xLen
-std::string Font::wrapText(std::string text, float xLen)
-{
-	std::string out;
+#define LAYOUT_CACHE_SIZE 64
 
-	std::string line, word, temp;
-	size_t space;
+static size_t getLayoutKey(const std::string& text, float xLen)
+{
+	return std::hash<std::string>()(text) ^ (std::hash<float>()(xLen) * 31);
+}
 
-	Vector2f textSize;
+const Font::TextLayout& Font::layoutText(const std::string& text, float xLen)
+{
+	const size_t key = getLayoutKey(text, xLen);
 
-	while(text.length() > 0) //while there's text or we still have text to render
+	auto it = mLayoutIndex.find(key);
+	if(it != mLayoutIndex.cend())
 	{
-		space = text.find_first_of(" \t\n");
-		if(space == std::string::npos)
-			space = text.length() - 1;
+		if(it->second->xLen == xLen && it->second->text == text)
+		{
+			mLayoutCache.splice(mLayoutCache.begin(), mLayoutCache, it->second);
+			return mLayoutCache.front();
+		}
+
+		// Same hash for another text
+		mLayoutCache.erase(it->second);
+		mLayoutIndex.erase(it);
+	}
 
-		word = text.substr(0, space + 1);
-		text.erase(0, space + 1);
+	mLayoutCache.push_front(TextLayout());
 
-		temp = line + word;
+	TextLayout& layout = mLayoutCache.front();
+	layout.text = text;
+	layout.xLen = xLen;
+	layout.width = 0.0f;
+	layout.wrappedText.reserve(text.length() + 16);
 
-		textSize = sizeText(temp);
+	// A word is a run of characters ending with its separator (space, tab or newline), it is measured once.
+	// It goes on the current line if it fits, otherwise it starts a new one
+	float lineWidth = 0.0f;
+	float wordWidth = 0.0f;
+	size_t wordStart = 0;
+
+	size_t cursor = 0;
+	while(cursor < text.length())
+	{
+		unsigned int character = Utils::String::chars2Unicode(text, cursor); // advances cursor
 
-		// if the word will fit on the line, add it to our line, and continue
-		if(textSize.x() <= xLen)
+		if(character != '\n')
 		{
-			line = temp;
+			Glyph* glyph = getGlyph(character);
+			if(glyph)
+				wordWidth += glyph->advance.x();
+		}
+
+		if(character != ' ' && character != '\t' && character != '\n' && cursor < text.length())
 			continue;
-		}else{
-			// the next word won't fit, so break here
-			out += line + '\n';
-			line = word;
+
+		// A word longer than the line stays alone on its line
+		if(lineWidth > 0.0f && lineWidth + wordWidth > xLen)
+		{
+			layout.wrappedText += '\n';
+			layout.lineWidths.push_back(lineWidth);
+			lineWidth = 0.0f;
+		}
+
+		layout.wrappedText.append(text, wordStart, cursor - wordStart);
+		lineWidth += wordWidth;
+
+		wordWidth = 0.0f;
+		wordStart = cursor;
+
+		if(character == '\n')
+		{
+			layout.lineWidths.push_back(lineWidth);
+			lineWidth = 0.0f;
 		}
 	}
 
-	// whatever's left should fit
-	out += line;
+	layout.lineWidths.push_back(lineWidth);
+
+	for(auto width : layout.lineWidths)
+		if(width > layout.width)
+			layout.width = width;
+
+	mLayoutIndex[key] = mLayoutCache.begin();
+
+	if(mLayoutCache.size() > LAYOUT_CACHE_SIZE)
+	{
+		mLayoutIndex.erase(getLayoutKey(mLayoutCache.back().text, mLayoutCache.back().xLen));
+		mLayoutCache.pop_back();
+	}
 
-	return out;
+	return layout;
+}
+
+//breaks up a normal string with newlines to make it fit xLen
+std::string Font::wrapText(std::string text, float xLen)
+{
+	return layoutText(text, xLen).wrappedText;
 }
 
 Vector2f Font::sizeWrappedText(std::string text, float xLen, float lineSpacing)
 {
-	text = wrapText(text, xLen);
-	return sizeText(text, lineSpacing);
+	const TextLayout& layout = layoutText(text, xLen);
+	return Vector2f(layout.width, layout.lineWidths.size() * getHeight(lineSpacing));
 }
 
 Vector2f Font::getWrappedTextCursorOffset(std::string text, float xLen, size_t stop, float lineSpacing)
@@ -648,22 +1154,16 @@ Vector2f Font::getWrappedTextCursorOffset(std::string text, float xLen, size_t s
 //TextCache
 //=============================================================================================================
 
-float Font::getNewlineStartOffset(const std::string& text, const unsigned int& charStart, const float& xLen, const Alignment& alignment)
+float Font::getNewlineStartOffset(float lineWidth, float xLen, Alignment alignment)
 {
 	switch(alignment)
 	{
 	case ALIGN_LEFT:
 		return 0;
 	case ALIGN_CENTER:
-		{
-			unsigned int endChar = (unsigned int)text.find('\n', charStart);
-			return (xLen - sizeText(text.substr(charStart, endChar != std::string::npos ? endChar - charStart : endChar)).x()) / 2.0f;
-		}
+		return (xLen - lineWidth) / 2.0f;
 	case ALIGN_RIGHT:
-		{
-			unsigned int endChar = (unsigned int)text.find('\n', charStart);
-			return xLen - (sizeText(text.substr(charStart, endChar != std::string::npos ? endChar - charStart : endChar)).x());
-		}
+		return xLen - lineWidth;
 	default:
 		return 0;
 	}
@@ -671,20 +1171,15 @@ float Font::getNewlineStartOffset(const std::string& text, const unsigned int& c
 
 TextCache* Font::buildTextCache(const std::string& text, Vector2f offset, unsigned int color, float xLen, Alignment alignment, float lineSpacing)
 {
-	float x = offset[0] + (xLen != 0 ? getNewlineStartOffset(text, 0, xLen, alignment) : 0);
-	
-	float yTop = getGlyph('S')->bearing.y();
-	float yBot = getHeight(lineSpacing);
-	float y = offset[1] + (yBot + yTop)/2.0f;
-
-	// vertices by texture
-	std::map< FontTexture*, std::vector<Renderer::Vertex> > vertMap;
+	// Decode the text once : its glyphs (nullptr for a new line) and the width of each line, for the alignment and the metrics
+	std::vector<Glyph*> glyphs;
+	std::vector<float> lineWidths(1, 0.0f);
+	glyphs.reserve(text.length());
 
 	size_t cursor = 0;
 	while(cursor < text.length())
 	{
 		unsigned int character = Utils::String::chars2Unicode(text, cursor); // also advances cursor
-		Glyph* glyph;
 
 		// invalid character
 		if(character == 0)
@@ -692,22 +1187,47 @@ TextCache* Font::buildTextCache(const std::string& text, Vector2f offset, unsign
 
 		if(character == '\n')
 		{
-			y += getHeight(lineSpacing);
-			x = offset[0] + (xLen != 0 ? getNewlineStartOffset(text, (const unsigned int)cursor /* cursor is already advanced */, xLen, alignment) : 0);
+			glyphs.push_back(nullptr);
+			lineWidths.push_back(0.0f);
 			continue;
 		}
 
-		glyph = getGlyph(character);
+		Glyph* glyph = getGlyph(character);
 		if(glyph == NULL)
 			continue;
 
+		glyphs.push_back(glyph);
+		lineWidths.back() += glyph->advance.x();
+	}
+
+	size_t line = 0;
+	float x = offset[0] + (xLen != 0 ? getNewlineStartOffset(lineWidths[line], xLen, alignment) : 0);
+	
+	Glyph* letter = getGlyph('S');
+	float yTop = letter->bearing.y() - (mDistanceFieldSource ? DISTANCE_FIELD_SPREAD * letter->scale : 0.0f);
+	float yBot = getHeight(lineSpacing);
+	float y = offset[1] + (yBot + yTop)/2.0f;
+
+	// vertices by texture
+	std::map< FontTexture*, std::vector<Renderer::Vertex> > vertMap;
+
+	for(auto glyph : glyphs)
+	{
+		if(glyph == nullptr)
+		{
+			line++;
+			y += getHeight(lineSpacing);
+			x = offset[0] + (xLen != 0 ? getNewlineStartOffset(lineWidths[line], xLen, alignment) : 0);
+			continue;
+		}
+
 		std::vector<Renderer::Vertex>& verts = vertMap[glyph->texture];
 		size_t oldVertSize = verts.size();
 		verts.resize(oldVertSize + 6);
 		Renderer::Vertex* vertices = verts.data() + oldVertSize;
 
 		const float        glyphStartX    = x + glyph->bearing.x();
-		const Vector2i&    textureSize    = glyph->texture->textureSize;
+		const Vector2f     textureSize    = Vector2f((float)glyph->texture->textureSize.x(), (float)glyph->texture->textureSize.y()) * glyph->scale;
 		const unsigned int convertedColor = Renderer::convertColor(color);
 
 		vertices[1] = { { glyphStartX                                       , y - glyph->bearing.y()                                          }, { glyph->texPos.x(),                      glyph->texPos.y()                      }, convertedColor };
@@ -730,15 +1250,22 @@ TextCache* Font::buildTextCache(const std::string& text, Vector2f offset, unsign
 	//TextCache::CacheMetrics metrics = { sizeText(text, lineSpacing) };
 
 	TextCache* cache = new TextCache();
+	cache->text = text;
+	cache->offset = offset;
+	cache->color = color;
+	cache->xLen = xLen;
+	cache->alignment = alignment;
+	cache->lineSpacing = lineSpacing;
 	cache->vertexLists.resize(vertMap.size());
-	cache->metrics = { sizeText(text, lineSpacing) };
+	cache->metrics = { Vector2f(*std::max_element(lineWidths.cbegin(), lineWidths.cend()), lineWidths.size() * getHeight(lineSpacing)) };
 
 	unsigned int i = 0;
 	for(auto it = vertMap.cbegin(); it != vertMap.cend(); it++)
 	{
 		TextCache::VertexList& vertList = cache->vertexLists.at(i);
 
-		vertList.textureIdPtr = &it->first->textureId;
+		vertList.texture = it->first;
+		vertList.generation = it->first->generation;
 		vertList.verts = it->second;
 		i++;
 	}
@@ -755,6 +1282,8 @@ TextCache* Font::buildTextCache(const std::string& text, float offsetX, float of
 
 void TextCache::setColor(unsigned int color)
 {
+	this->color = color;
+
 	const unsigned int convertedColor = Renderer::convertColor(color);
 
 	for(auto it = vertexLists.begin(); it != vertexLists.end(); it++)
@@ -9,6 +9,8 @@
 #include "ThemeData.h"
 #include <ft2build.h>
 #include FT_FREETYPE_H
+#include <list>
+#include <unordered_map>
 #include <vector>
 
 class TextCache;
@@ -76,9 +78,12 @@ public:
 private:
 	static FT_Library sLibrary;
 	static std::map< std::pair<std::string, int>, std::weak_ptr<Font> > sFontMap;
+	static std::map< std::string, std::weak_ptr<Font> > sDistanceFieldMap;
 
-	Font(int size, const std::string& path);
+	Font(int size, const std::string& path, bool distanceField = false);
 
+	// Glyph pages are shared by all the fonts : when the FontMaxVRAM setting is reached, the page used the longest time ago
+	// is emptied and given to the font that needs room. Pages are never deleted, so TextCaches can check their generation
 	struct FontTexture
 	{
 		unsigned int textureId;
@@ -87,30 +92,40 @@ private:
 		Vector2i writePos;
 		int rowHeight;
 
+		bool linear; // distance fields are filtered
+		Font* owner; // NULL when the page is free
+		unsigned int generation; // incremented each time the glyphs of the page are evicted
+		unsigned int lastUsed; // frame number
+
 		FontTexture();
 		~FontTexture();
 		bool findEmpty(const Vector2i& size, Vector2i& cursor_out);
+		void reset();
 
 		// you must call initTexture() after creating a FontTexture to get a textureId
 		void initTexture(); // initializes the OpenGL texture according to this FontTexture's settings, updating textureId
 		void deinitTexture(); // deinitializes the OpenGL texture if any exists, is automatically called in the destructor
 	};
 
+	// A font file, shared by all the Font instances and sizes using it (see Font.cpp)
+	class FontFile;
+
 	struct FontFace
 	{
-		const ResourceData data;
+		const std::shared_ptr<FontFile> file;
 		FT_Face face;
 
-		FontFace(ResourceData&& d, int size);
+		FontFace(const std::shared_ptr<FontFile>& f, int size);
 		virtual ~FontFace();
 	};
 
 	void rebuildTextures();
 	void unloadTextures();
 
-	std::vector<FontTexture> mTextures;
+	static std::vector<FontTexture*> sTextures;
 
 	void getTextureForNewGlyph(const Vector2i& glyphSize, FontTexture*& tex_out, Vector2i& cursor_out);
+	void evictTexture(FontTexture* tex);
 
 	std::map< unsigned int, std::unique_ptr<FontFace> > mFaceCache;
 	FT_Face getFaceForChar(unsigned int id);
@@ -125,12 +140,21 @@ private:
 
 		Vector2f advance;
 		Vector2f bearing;
+
+		float scale; // size on screen / size in the texture, distance fields are drawn at any size
+		unsigned int generation; // of the texture when the glyph was added
 	};
 
 	Glyph* mGlyphCacheArray[255]; // used to cache 255 first chars
 	std::map<unsigned int, Glyph*> mGlyphMap;
 
 	Glyph* getGlyph(unsigned int id);
+	bool rasterizeGlyph(unsigned int id, FT_GlyphSlot& slot, Vector2i& size, Vector2f& bearing, std::vector<unsigned char>& pixels);
+	void dropGlyph(std::map<unsigned int, Glyph*>::iterator it);
+
+	// FontDistanceField setting : all the sizes of a face use the glyphs of a single font, rasterised once as distance fields
+	bool mDistanceField;
+	std::shared_ptr<Font> mDistanceFieldSource;
 
 	int mMaxGlyphHeight;
 	
@@ -138,7 +162,25 @@ private:
 	const std::string mPath;
 	bool mLoaded;
 
-	float getNewlineStartOffset(const std::string& text, const unsigned int& charStart, const float& xLen, const Alignment& alignment);
+	float getNewlineStartOffset(float lineWidth, float xLen, Alignment alignment);
+	void rebuildTextCache(TextCache* cache);
+
+	// Result of wrapping a text at a width : the text with its line breaks, and the width of each line
+	struct TextLayout
+	{
+		std::string			text;
+		float				xLen;
+
+		std::string			wrappedText;
+		std::vector<float>	lineWidths;
+		float				width;
+	};
+
+	// Wraps in a single pass over the decoded text. The last layouts are kept, so a text shown again is not measured again
+	const TextLayout& layoutText(const std::string& text, float xLen);
+
+	std::list<TextLayout>								mLayoutCache;	// most recent first
+	std::unordered_map<size_t, std::list<TextLayout>::iterator>	mLayoutIndex;
 
 	friend TextCache;
 };
@@ -154,11 +196,20 @@ protected:
 	struct VertexList
 	{
 		std::vector<Renderer::Vertex> verts;
-		unsigned int* textureIdPtr; // this is a pointer because the texture ID can change during deinit/reinit (when launching a game)
+		Font::FontTexture* texture; // the texture ID can change during deinit/reinit (when launching a game)
+		unsigned int generation; // the glyphs were evicted from the texture if it changed
 	};
 
 	std::vector<VertexList> vertexLists;
 
+	// Arguments of Font::buildTextCache, the cache is built again when its glyphs were evicted
+	std::string text;
+	Vector2f offset;
+	unsigned int color;
+	float xLen;
+	Alignment alignment;
+	float lineSpacing;
+
 public:
 	struct CacheMetrics
 	{
@@ -0,0 +1,353 @@
+#include "resources/TextureAtlas.h"
+
+#include "resources/TextureDataManager.h"
+#include "math/Vector4f.h"
+#include "renderers/Renderer.h"
+#include "Log.h"
+#include "Settings.h"
+#include <algorithm>
+#include <string.h>
+#include <vector>
+
+#define ATLAS_PAGE_SIZE		1024
+#define ATLAS_BORDER		1
+
+struct AtlasShelf
+{
+	int y;
+	int height;
+	int x;		// Next free position on the shelf
+};
+
+struct TextureAtlas::Page
+{
+	unsigned int				texture;
+	bool						linear;
+	int							nextShelf;
+	size_t						entries;
+	std::vector<AtlasShelf>		shelves;
+};
+
+static std::vector<TextureAtlas::Page*>		sPages;
+static std::vector<TextureAtlas::Entry*>	sEntries;
+
+static size_t				sRepackCount = 0;
+
+static TextureDataManager*	sManager = nullptr;
+static size_t				sCopiesSize = 0;	// Pixels kept by the entries
+static size_t				sAccountedSize = 0;	// As last reported to sManager : the pages
+static size_t				sAccountedVRAM = 0;	// The pages and the copies
+
+// Same accounting calls as TextureData. The entries are already in the total size through their textures,
+// only the pages are added to it. Everything is resident, the copies in RAM count as committed like mDataRGBA
+static void updateAccounting()
+{
+	size_t size = sPages.size() * ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE * 4;
+	size_t vram = size + sCopiesSize;
+
+	if (sManager != nullptr && (size != sAccountedSize || vram != sAccountedVRAM))
+		sManager->onTextureSizeChanged(sAccountedSize, size, sAccountedVRAM, vram);
+
+	sAccountedSize = size;
+	sAccountedVRAM = vram;
+}
+
+static bool insert(TextureAtlas::Page* page, int width, int height, int& x, int& y)
+{
+	const int w = width + ATLAS_BORDER * 2;
+	const int h = height + ATLAS_BORDER * 2;
+
+	// First shelf that is high enough, without wasting more than a third of its height
+	for (auto& shelf : page->shelves)
+	{
+		if (h > shelf.height || h < shelf.height * 2 / 3 || shelf.x + w > ATLAS_PAGE_SIZE)
+			continue;
+
+		x = shelf.x + ATLAS_BORDER;
+		y = shelf.y + ATLAS_BORDER;
+		shelf.x += w;
+		return true;
+	}
+
+	if (page->nextShelf + h > ATLAS_PAGE_SIZE || w > ATLAS_PAGE_SIZE)
+		return false;
+
+	AtlasShelf shelf;
+	shelf.y = page->nextShelf;
+	shelf.height = h;
+	shelf.x = w;
+	page->shelves.push_back(shelf);
+	page->nextShelf += h;
+
+	x = ATLAS_BORDER;
+	y = shelf.y + ATLAS_BORDER;
+	return true;
+}
+
+// Copies the entry and its border into 'target', a 'pitch' pixels wide buffer, at (x, y) including the border
+static void copyWithBorder(const TextureAtlas::Entry* entry, unsigned char* target, int pitch, int x, int y)
+{
+	const int h = entry->height + ATLAS_BORDER * 2;
+
+	for (int row = 0; row < h; row++)
+	{
+		const int srcRow = std::min(std::max(row - ATLAS_BORDER, 0), entry->height - 1);
+		const unsigned char* src = entry->dataRGBA + srcRow * entry->width * 4;
+		unsigned char* dst = target + ((y + row) * pitch + x) * 4;
+
+		memcpy(dst, src, 4);
+		memcpy(dst + ATLAS_BORDER * 4, src, entry->width * 4);
+		memcpy(dst + (ATLAS_BORDER + entry->width) * 4, src + (entry->width - 1) * 4, 4);
+	}
+}
+
+static void upload(const TextureAtlas::Entry* entry)
+{
+	const int w = entry->width + ATLAS_BORDER * 2;
+	const int h = entry->height + ATLAS_BORDER * 2;
+
+	std::vector<unsigned char> data(w * h * 4);
+	copyWithBorder(entry, &data[0], w, 0, 0);
+
+	Renderer::updateTexture(entry->page->texture, Renderer::Texture::RGBA, entry->x - ATLAS_BORDER, entry->y - ATLAS_BORDER, w, h, &data[0]);
+}
+
+static TextureAtlas::Page* createPage(bool linear)
+{
+	unsigned int texture = Renderer::createTexture(Renderer::Texture::RGBA, linear, false, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, nullptr);
+	if (texture == 0)
+		return nullptr;
+
+	TextureAtlas::Page* page = new TextureAtlas::Page();
+	page->texture = texture;
+	page->linear = linear;
+	page->nextShelf = 0;
+	page->entries = 0;
+	sPages.push_back(page);
+
+	LOG(LogDebug) << "TextureAtlas : new page, " << sPages.size() << " pages";
+
+	updateAccounting();
+	return page;
+}
+
+static void destroyPage(TextureAtlas::Page* page)
+{
+	Renderer::destroyTexture(page->texture);
+	sPages.erase(std::remove(sPages.begin(), sPages.end(), page), sPages.end());
+	delete page;
+
+	updateAccounting();
+}
+
+static bool place(TextureAtlas::Entry* entry)
+{
+	for (auto page : sPages)
+	{
+		if (page->linear == entry->linear && insert(page, entry->width, entry->height, entry->x, entry->y))
+		{
+			entry->page = page;
+			page->entries++;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Pages are more than half empty : holes left by removed entries
+static bool isFragmented(bool linear)
+{
+	size_t used = 0;
+	size_t total = 0;
+
+	for (auto page : sPages)
+		if (page->linear == linear)
+			total += ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE;
+
+	for (auto entry : sEntries)
+		if (entry->linear == linear)
+			used += (entry->width + ATLAS_BORDER * 2) * (entry->height + ATLAS_BORDER * 2);
+
+	return total > 0 && used * 2 < total;
+}
+
+bool TextureAtlas::accepts(const std::string& path, size_t width, size_t height)
+{
+	// Theme and resource pictures live as long as the theme, they don't fragment the pages
+	if (path.empty() || (path[0] != ':' && path.find("/themes/") == std::string::npos))
+		return false;
+
+	size_t maxSize = (size_t)std::max(0, Settings::getInstance()->getInt("TextureAtlasMaxSize"));
+	maxSize = std::min(maxSize, (size_t)(ATLAS_PAGE_SIZE / 4));
+
+	return width > 0 && height > 0 && width <= maxSize && height <= maxSize;
+}
+
+TextureAtlas::Entry* TextureAtlas::add(const unsigned char* dataRGBA, size_t width, size_t height, bool linear)
+{
+	if (dataRGBA == nullptr || width == 0 || height == 0)
+		return nullptr;
+
+	Entry* entry = new Entry();
+	entry->page = nullptr;
+	entry->width = (int)width;
+	entry->height = (int)height;
+	entry->linear = linear;
+	entry->dataRGBA = new unsigned char[width * height * 4];
+	memcpy(entry->dataRGBA, dataRGBA, width * height * 4);
+
+	if (!place(entry))
+	{
+		// Reuse the holes before allocating a new page
+		if (isFragmented(linear))
+		{
+			repack();
+			place(entry);
+		}
+
+		if (entry->page == nullptr)
+		{
+			Page* page = createPage(linear);
+			if (page == nullptr || !insert(page, entry->width, entry->height, entry->x, entry->y))
+			{
+				delete[] entry->dataRGBA;
+				delete entry;
+				return nullptr;
+			}
+
+			entry->page = page;
+			page->entries++;
+		}
+	}
+
+	sEntries.push_back(entry);
+	upload(entry);
+
+	sCopiesSize += width * height * 4;
+	updateAccounting();
+
+	return entry;
+}
+
+void TextureAtlas::remove(Entry* entry)
+{
+	if (entry == nullptr)
+		return;
+
+	sEntries.erase(std::remove(sEntries.begin(), sEntries.end(), entry), sEntries.end());
+
+	// The room is only reclaimed when the page is empty, or by repack()
+	Page* page = entry->page;
+	if (page != nullptr && --page->entries == 0)
+		destroyPage(page);
+
+	sCopiesSize -= entry->width * entry->height * 4;
+	updateAccounting();
+
+	delete[] entry->dataRGBA;
+	delete entry;
+}
+
+bool TextureAtlas::bind(const Entry* entry)
+{
+	if (entry->page == nullptr)
+		return false;
+
+	const float size = (float)ATLAS_PAGE_SIZE;
+	Renderer::bindTexture(entry->page->texture, Vector4f(entry->x / size, entry->y / size, entry->width / size, entry->height / size));
+	return true;
+}
+
+void TextureAtlas::repack()
+{
+	if (sEntries.empty())
+		return;
+
+	sRepackCount++;
+
+	// Highest first, shelves are filled tighter
+	std::vector<Entry*> entries = sEntries;
+	std::stable_sort(entries.begin(), entries.end(), [](const Entry* a, const Entry* b) { return a->height > b->height; });
+
+	for (auto page : sPages)
+	{
+		page->shelves.clear();
+		page->nextShelf = 0;
+		page->entries = 0;
+	}
+
+	std::vector<Page*> pages = sPages;
+
+	for (auto entry : entries)
+	{
+		entry->page = nullptr;
+
+		if (!place(entry))
+		{
+			Page* page = createPage(entry->linear);
+			if (page != nullptr && insert(page, entry->width, entry->height, entry->x, entry->y))
+			{
+				entry->page = page;
+				page->entries++;
+			}
+		}
+	}
+
+	// Whole pages are uploaded again, this also clears what was left of removed entries
+	std::vector<unsigned char> data;
+
+	for (auto page : std::vector<Page*>(sPages))
+	{
+		if (page->entries == 0)
+		{
+			destroyPage(page);
+			continue;
+		}
+
+		data.assign(ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE * 4, 0);
+
+		for (auto entry : entries)
+			if (entry->page == page)
+				copyWithBorder(entry, &data[0], ATLAS_PAGE_SIZE, entry->x - ATLAS_BORDER, entry->y - ATLAS_BORDER);
+
+		Renderer::updateTexture(page->texture, Renderer::Texture::RGBA, -1, -1, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, &data[0]);
+	}
+
+	// An entry that doesn't fit anymore (no page could be created) is dropped : its owner reloads it on next bind
+	for (auto entry : entries)
+	{
+		if (entry->page == nullptr)
+		{
+			LOG(LogWarning) << "TextureAtlas::repack : unable to place a " << entry->width << "x" << entry->height << " picture";
+		}
+	}
+
+	LOG(LogDebug) << "TextureAtlas::repack : " << entries.size() << " pictures in " << sPages.size() << " pages (was " << pages.size() << ")";
+}
+
+void TextureAtlas::setManager(TextureDataManager* manager)
+{
+	if (sManager != nullptr)
+		sManager->onTextureSizeChanged(sAccountedSize, 0, sAccountedVRAM, 0);
+
+	sManager = manager;
+	sAccountedSize = 0;
+	sAccountedVRAM = 0;
+	updateAccounting();
+}
+
+size_t TextureAtlas::getPageCount()
+{
+	return sPages.size();
+}
+
+size_t TextureAtlas::getRepackCount()
+{
+	return sRepackCount;
+}
+
+size_t TextureAtlas::getVRAMUsage()
+{
+	return sPages.size() * ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE * 4;
+}
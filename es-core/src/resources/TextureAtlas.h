@@ -0,0 +1,59 @@
+#pragma once
+#ifndef ES_CORE_RESOURCES_TEXTURE_ATLAS_H
+#define ES_CORE_RESOURCES_TEXTURE_ATLAS_H
+
+#include <stddef.h>
+#include <string>
+
+class TextureDataManager;
+
+//
+// Shared texture pages for small, non-tiled theme and resource pictures (icons, help prompts, rating stars...).
+// Game pictures are left out : the LRU releases them while lists scroll, the holes they leave would trigger repacks.
+// Pictures are packed on shelves with a 1 pixel border copied from their edges, so linear filtering
+// never samples a neighbour. Binding an entry binds its page with a texture region : the renderer
+// remaps the 0..1 texture coordinates of the components to the entry, and draws using different
+// entries of the same page are merged into the same batch.
+// Entries keep their pixels so the pages can be repacked when they get fragmented, or when the theme changes.
+// The pages and these copies are reported to the TextureDataManager, the textures of the entries don't count them again.
+// All the functions must be called from the rendering thread
+//
+class TextureAtlas
+{
+public:
+	struct Page;
+
+	struct Entry
+	{
+		Page*			page;
+		int				x;		// Position in the page, border excluded
+		int				y;
+		int				width;
+		int				height;
+		bool			linear;
+		unsigned char*	dataRGBA;
+	};
+
+	// Returns true if the picture goes to the atlas : a resource (":/") or theme picture of at most
+	// TextureAtlasMaxSize pixels (0 disables the atlas)
+	static bool accepts(const std::string& path, size_t width, size_t height);
+
+	// Copies the picture into a page. Returns nullptr if there is no room for it
+	static Entry* add(const unsigned char* dataRGBA, size_t width, size_t height, bool linear);
+	static void remove(Entry* entry);
+
+	// Returns false if the entry lost its page (a page couldn't be created while repacking)
+	static bool bind(const Entry* entry);
+
+	// Packs all the entries again into as few pages as possible
+	static void repack();
+
+	// The manager the pages and the entry copies are accounted to
+	static void setManager(TextureDataManager* manager);
+
+	static size_t getPageCount();
+	static size_t getRepackCount(); // Since ES started, for the benchmark
+	static size_t getVRAMUsage();
+};
+
+#endif // ES_CORE_RESOURCES_TEXTURE_ATLAS_H
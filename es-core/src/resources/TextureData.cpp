@@ -10,16 +10,33 @@
 #include <assert.h>
 #include <string.h>
 #include "Settings.h"
+#include "resources/TextureDataManager.h"
+#include "resources/TextureDiskCache.h"
 
 #define DPI 96
 
 #define OPTIMIZEVRAM Settings::getInstance()->getBool("OptimizeVRAM")
 
-TextureData::TextureData(bool tile, bool linear) : mTile(tile), mLinear(linear), mTextureID(0), mDataRGBA(nullptr), mScalable(false),
+TextureData::TextureData(bool tile, bool linear) : mTile(tile), mLinear(linear), mTextureID(0), mAtlasEntry(nullptr), mDataRGBA(nullptr), mScalable(false),
 									  mWidth(0), mHeight(0), mSourceWidth(0.0f), mSourceHeight(0.0f),
 									  mPackedSize(Vector2i(0, 0)), mBaseSize(Vector2i(0, 0))
 {
 	mIsExternalDataRGBA = false;
+	mType = Renderer::Texture::RGBA;
+
+	mManager = nullptr;
+	mLruPrev = nullptr;
+	mLruNext = nullptr;
+	mLruLinked = false;
+	mPinned = false;
+	mAccountedSize = 0;
+	mAccountedVRAM = 0;
+	mLastBoundFrame = 0;
+
+	mLoaderQueued = false;
+	mLoaderProcessing = false;
+	mLoaderQueuedSize = 0;
+	mLoadPriority = 0;
 }
 
 TextureData::~TextureData()
@@ -40,7 +57,7 @@ bool TextureData::initSVGFromMemory(const unsigned char* fileData, size_t length
 {
 	// If already initialised then don't read again
 	std::unique_lock<std::mutex> lock(mMutex);
-	if (mDataRGBA || (mTextureID != 0))
+	if (mDataRGBA || isUploaded())
 		return true;
 
 	// nsvgParse excepts a modifiable, null-terminated string
@@ -109,6 +126,9 @@ bool TextureData::initSVGFromMemory(const unsigned char* fileData, size_t length
 	else
 		mPackedSize = Vector2i(0, 0);
 
+	if (mWidth == 0 || mHeight == 0)
+		return false;
+
 	unsigned char* dataRGBA = new unsigned char[mWidth * mHeight * 4];
 
 	double scale = ((float)((int)mHeight)) / svgImage->height;
@@ -116,31 +136,29 @@ bool TextureData::initSVGFromMemory(const unsigned char* fileData, size_t length
 	if (scaleV < scale)
 		scale = scaleV;
 
+	// Rasterized from the last row with a negative stride : the rows come out bottom-up, without a flip pass
 	NSVGrasterizer* rast = nsvgCreateRasterizer();
-	nsvgRasterize(rast, svgImage, 0, 0, scale, dataRGBA, (int)mWidth, (int)mHeight, (int)mWidth * 4);
+	nsvgRasterize(rast, svgImage, 0, 0, scale, dataRGBA + (mHeight - 1) * mWidth * 4, (int)mWidth, (int)mHeight, -(int)mWidth * 4);
 	nsvgDeleteRasterizer(rast);
 
-	ImageIO::flipPixelsVert(dataRGBA, mWidth, mHeight);
-
 	mDataRGBA = dataRGBA;
+	updateAccounting();
 
 	return true;
 }
 
-bool TextureData::initImageFromMemory(const unsigned char* fileData, size_t length)
+bool TextureData::initImageFromMemory(const unsigned char* fileData, size_t length, bool saveToDiskCache)
 {
 	size_t width, height;
 
 	// If already initialised then don't read again
 	{
 		std::unique_lock<std::mutex> lock(mMutex);
-		if (mDataRGBA || (mTextureID != 0))
+		if (mDataRGBA || isUploaded())
 			return true;
 	}
 
-	MaxSizeInfo maxSize(Renderer::getScreenWidth(), Renderer::getScreenHeight(), false);
-	if (!mMaxSize.empty())
-		maxSize = mMaxSize;
+	MaxSizeInfo maxSize = getTargetMaxSize();
 
 	unsigned char* imageRGBA = ImageIO::loadFromMemoryRGBA32((const unsigned char*)(fileData), length, width, height, &maxSize, &mBaseSize, &mPackedSize);
 	if (imageRGBA == nullptr)
@@ -153,6 +171,11 @@ bool TextureData::initImageFromMemory(const unsigned char* fileData, size_t leng
 	mSourceHeight = (float) height;
 	mScalable = false;
 
+	// Only store pictures that were downscaled, full size ones are cheaper to decode again than to store.
+	// The pixels are still only ours : the write doesn't hold mMutex, so uploadAndBind isn't kept waiting
+	if (saveToDiskCache && mPackedSize != Vector2i(0, 0))
+		TextureDiskCache::save(mPath, getTargetMaxSize(), imageRGBA, width, height, mBaseSize, mPackedSize);
+
 	return initFromRGBA(imageRGBA, width, height, false);
 }
 
@@ -164,6 +187,7 @@ bool TextureData::initFromRGBA(unsigned char* dataRGBA, size_t width, size_t hei
 	if (mIsExternalDataRGBA)
 	{
 		mIsExternalDataRGBA = false;
+		mType = Renderer::Texture::RGBA;
 		mDataRGBA = nullptr;
 	}
 
@@ -181,10 +205,11 @@ bool TextureData::initFromRGBA(unsigned char* dataRGBA, size_t width, size_t hei
 
 	mWidth = width;
 	mHeight = height;
+	updateAccounting();
 	return true;
 }
 
-bool TextureData::initFromExternalRGBA(unsigned char* dataRGBA, size_t width, size_t height)
+bool TextureData::initFromExternalPixels(unsigned char* data, size_t width, size_t height, Renderer::Texture::Type type)
 {
 	// If already initialised then don't read again
 	std::unique_lock<std::mutex> lock(mMutex);
@@ -192,17 +217,69 @@ bool TextureData::initFromExternalRGBA(unsigned char* dataRGBA, size_t width, si
 	if (!mIsExternalDataRGBA && mDataRGBA != nullptr)
 		delete[] mDataRGBA;
 
+	// Video frames keep their size : the texture is only refilled
+	bool sameTexture = (mWidth == width && mHeight == height && mType == type);
+
 	mIsExternalDataRGBA = true;
-	mDataRGBA = dataRGBA;
+	mDataRGBA = data;
 	mWidth = width;
 	mHeight = height;
+	mType = type;
 
 	if (mTextureID != 0)
-		Renderer::updateTexture(mTextureID, Renderer::Texture::RGBA, -1, -1, mWidth, mHeight, mDataRGBA);
+	{
+		if (sameTexture)
+			Renderer::streamTexture(mTextureID, mType, mWidth, mHeight, mDataRGBA);
+		else
+			Renderer::updateTexture(mTextureID, mType, -1, -1, mWidth, mHeight, mDataRGBA);
+	}
 
+	updateAccounting();
 	return true;
 }
 
+unsigned int TextureData::getTextureId()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	return mTextureID;
+}
+
+MaxSizeInfo TextureData::getTargetMaxSize()
+{
+	MaxSizeInfo maxSize(Renderer::getScreenWidth(), Renderer::getScreenHeight(), false);
+	if (!mMaxSize.empty())
+		maxSize = mMaxSize;
+
+	return maxSize;
+}
+
+bool TextureData::initFromDiskCache(bool updateCache)
+{
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		if (mDataRGBA || isUploaded())
+			return true;
+	}
+
+	size_t width, height, fileSize;
+	Vector2i baseSize, packedSize;
+
+	unsigned char* imageRGBA = TextureDiskCache::load(mPath, getTargetMaxSize(), width, height, baseSize, packedSize, &fileSize);
+	if (imageRGBA == nullptr)
+		return false;
+
+	if (updateCache)
+		ImageIO::updateImageCache(mPath, (int)fileSize, baseSize.x(), baseSize.y());
+
+	mBaseSize = baseSize;
+	mPackedSize = packedSize;
+	mSourceWidth = (float)width;
+	mSourceHeight = (float)height;
+	mScalable = false;
+
+	return initFromRGBA(imageRGBA, width, height, false);
+}
+
 bool TextureData::load(bool updateCache)
 {
 	bool retval = false;
@@ -212,16 +289,24 @@ bool TextureData::load(bool updateCache)
 	{
 		LOG(LogDebug) << "TextureData::load " << mPath;
 
+		// is it an SVG?
+		bool isSVG = mPath.substr(mPath.size() - 4, std::string::npos) == ".svg";
+
+		// Downscaled pictures may already be decoded in the disk cache. Internal resources are never cached
+		bool diskCache = !isSVG && mPath[0] != ':' && OPTIMIZEVRAM && TextureDiskCache::isEnabled();
+		if (diskCache && initFromDiskCache(updateCache))
+			return true;
+
 		std::shared_ptr<ResourceManager>& rm = ResourceManager::getInstance();
 		const ResourceData& data = rm->getFileData(mPath);
-		// is it an SVG?
-		if (mPath.substr(mPath.size() - 4, std::string::npos) == ".svg")
+
+		if (isSVG)
 		{
 			mScalable = true;
 			retval = initSVGFromMemory((const unsigned char*)data.ptr.get(), data.length);
 		}
-		else
-			retval = initImageFromMemory((const unsigned char*)data.ptr.get(), data.length);
+		else // Cache entries are only written from the loader thread (updateCache), blocking loads don't wait for the disk
+			retval = initImageFromMemory((const unsigned char*)data.ptr.get(), data.length, diskCache && updateCache);
 
 		if (updateCache && retval)
 			ImageIO::updateImageCache(mPath, data.length, mBaseSize.x(), mBaseSize.y());
@@ -233,7 +318,7 @@ bool TextureData::load(bool updateCache)
 bool TextureData::isLoaded()
 {
 	std::unique_lock<std::mutex> lock(mMutex);
-	if (mDataRGBA || (mTextureID != 0))
+	if (mDataRGBA || isUploaded())
 		return true;
 	return false;
 }
@@ -246,6 +331,17 @@ bool TextureData::uploadAndBind()
 	{
 		Renderer::bindTexture(mTextureID);
 	}
+	else if (mAtlasEntry != nullptr)
+	{
+		if (!TextureAtlas::bind(mAtlasEntry))
+		{
+			// Lost while repacking the atlas, the pixels have to be loaded again
+			TextureAtlas::remove(mAtlasEntry);
+			mAtlasEntry = nullptr;
+			updateAccounting();
+			return false;
+		}
+	}
 	else
 	{
 		// Load it if necessary
@@ -257,15 +353,24 @@ bool TextureData::uploadAndBind()
 		if ((mWidth == 0) || (mHeight == 0) || (mDataRGBA == nullptr))
 			return false;
 
-		// Upload texture
-		mTextureID = Renderer::createTexture(Renderer::Texture::RGBA, mLinear, mTile, mWidth, mHeight, mDataRGBA);
-		if (mTextureID)
+		// Small theme pictures share atlas pages, others get their own texture
+		if (!mTile && !mIsExternalDataRGBA && TextureAtlas::accepts(mPath, mWidth, mHeight))
+			mAtlasEntry = TextureAtlas::add(mDataRGBA, mWidth, mHeight, mLinear);
+
+		if (mAtlasEntry != nullptr)
+			TextureAtlas::bind(mAtlasEntry);
+		else
+			mTextureID = Renderer::createTexture(mType, mLinear, mTile, mWidth, mHeight, mDataRGBA);
+
+		if (isUploaded())
 		{
 			if (mDataRGBA != nullptr && !mIsExternalDataRGBA)
 				delete[] mDataRGBA;
 
 			mDataRGBA = nullptr;
 		}
+
+		updateAccounting();
 	}
 	return true;
 }
@@ -277,6 +382,13 @@ void TextureData::releaseVRAM()
 	{
 		Renderer::destroyTexture(mTextureID);
 		mTextureID = 0;
+		updateAccounting();
+	}
+	else if (mAtlasEntry != nullptr)
+	{
+		TextureAtlas::remove(mAtlasEntry);
+		mAtlasEntry = nullptr;
+		updateAccounting();
 	}
 }
 
@@ -288,6 +400,7 @@ void TextureData::releaseRAM()
 		delete[] mDataRGBA;
 
 	mDataRGBA = 0;
+	updateAccounting();
 }
 
 size_t TextureData::width()
@@ -320,10 +433,12 @@ float TextureData::sourceHeight()
 
 void TextureData::setTemporarySize(float width, float height)
 {
+	std::unique_lock<std::mutex> lock(mMutex);
 	mWidth = width;
 	mHeight = height;
 	mSourceWidth = width;
 	mSourceHeight = height;
+	updateAccounting();
 }
 
 void TextureData::setSourceSize(float width, float height)
@@ -342,7 +457,7 @@ void TextureData::setSourceSize(float width, float height)
 
 size_t TextureData::getVRAMUsage()
 {
-	if ((mTextureID != 0) || (mDataRGBA != nullptr))
+	if (isUploaded() || (mDataRGBA != nullptr))
 		return mWidth * mHeight * 4;
 	else
 		return 0;
@@ -383,4 +498,17 @@ bool TextureData::isMaxSizeValid()
 		return true;
 
 	return false;
-}
\ No newline at end of file
+}
+
+void TextureData::updateAccounting()
+{
+	size_t size = mWidth * mHeight * (mType == Renderer::Texture::ALPHA ? 1 : 4);
+	// An atlas entry is in the page and the copy TextureAtlas accounts for
+	size_t vram = (mTextureID != 0 || mDataRGBA != nullptr) ? size : 0;
+
+	if (mManager != nullptr && (size != mAccountedSize || vram != mAccountedVRAM))
+		mManager->onTextureSizeChanged(mAccountedSize, size, mAccountedVRAM, vram);
+
+	mAccountedSize = size;
+	mAccountedVRAM = vram;
+}
@@ -2,11 +2,21 @@
 #ifndef ES_CORE_RESOURCES_TEXTURE_DATA_H
 #define ES_CORE_RESOURCES_TEXTURE_DATA_H
 
+#include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include "ImageIO.h"
+#include "renderers/Renderer.h"
+#include "resources/TextureAtlas.h"
 
 class TextureResource;
+class TextureDataManager;
+class TextureData;
+
+// Loader queue ordering : lowest priority value first, then most recent request first
+typedef std::pair<int, unsigned int> TextureLoaderKey;
+typedef std::multimap<TextureLoaderKey, std::shared_ptr<TextureData>> TextureLoaderQueue;
 
 class TextureData
 {
@@ -19,12 +29,16 @@ public:
 	//!!!! Needs to be canonical path. Caller should check for duplicates before calling this
 	void initFromPath(const std::string& path);
 	bool initSVGFromMemory(const unsigned char* fileData, size_t length);
-	bool initImageFromMemory(const unsigned char* fileData, size_t length);
+	// saveToDiskCache stores downscaled pixels in the TextureDiskCache, before they are handed to the texture
+	bool initImageFromMemory(const unsigned char* fileData, size_t length, bool saveToDiskCache = false);
 	bool initFromRGBA(unsigned char* dataRGBA, size_t width, size_t height, bool copyData = true);
 
 	// Read the data into memory if necessary
 	bool load(bool updateCache = false);
 
+	// Read already downscaled pixels from the TextureDiskCache. updateCache refreshes the ImageIO size cache like a decode does
+	bool initFromDiskCache(bool updateCache = false);
+
 	bool isLoaded();
 
 	// Upload the texture to VRAM if necessary and bind. Returns true if bound ok or
@@ -59,14 +73,32 @@ public:
 
 	inline const std::string& getPath() { return mPath; };
 
-	bool initFromExternalRGBA(unsigned char* dataRGBA, size_t width, size_t height);
+	// Pixels owned by the caller, uploaded again each time they change (video frames)
+	bool initFromExternalPixels(unsigned char* data, size_t width, size_t height, Renderer::Texture::Type type = Renderer::Texture::RGBA);
+
+	// 0 if not uploaded in its own texture
+	unsigned int getTextureId();
 
 private:
+	friend class TextureDataManager;
+	friend class TextureDataList;
+	friend class TextureLoader;
+
+	// MaxSizeInfo pictures are decoded to : mMaxSize, or the screen size if not set
+	MaxSizeInfo getTargetMaxSize();
+
+	// Uploaded to VRAM, in its own texture or in a TextureAtlas page
+	bool isUploaded() { return mTextureID != 0 || mAtlasEntry != nullptr; }
+
+	// Reports size/residency changes to the owning TextureDataManager. Must be called with mMutex held
+	void updateAccounting();
+
 	std::mutex		mMutex;
 	bool			mTile;
 	bool			mLinear;
 	std::string		mPath;
 	unsigned int	mTextureID;
+	TextureAtlas::Entry* mAtlasEntry;
 	unsigned char*	mDataRGBA;
 	size_t			mWidth;
 	size_t			mHeight;
@@ -80,6 +112,24 @@ private:
 	Vector2i		mBaseSize;
 
 	bool			mIsExternalDataRGBA;
+	Renderer::Texture::Type	mType;		// Only external pixels may be something else than RGBA
+
+	// TextureDataManager bookkeeping : LRU links and the byte counts last reported to the manager
+	TextureDataManager*	mManager;
+	TextureData*		mLruPrev;
+	TextureData*		mLruNext;
+	bool				mLruLinked;
+	bool				mPinned;
+	size_t				mAccountedSize;
+	size_t				mAccountedVRAM;
+	unsigned int		mLastBoundFrame;
+
+	// TextureLoader bookkeeping, guarded by the loader lock. mLoaderHandle is only valid while mLoaderQueued is set
+	TextureLoaderQueue::iterator	mLoaderHandle;
+	bool				mLoaderQueued;
+	bool				mLoaderProcessing;
+	size_t				mLoaderQueuedSize;
+	int					mLoadPriority;
 };
 
 #endif // ES_CORE_RESOURCES_TEXTURE_DATA_H
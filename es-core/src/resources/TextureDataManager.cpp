@@ -1,12 +1,47 @@
 #include "resources/TextureDataManager.h"
 
+#include "resources/TextureAtlas.h"
 #include "resources/TextureData.h"
 #include "resources/TextureResource.h"
+#include "renderers/Renderer.h"
 #include "Settings.h"
 #include "Log.h"
 #include <algorithm>
+#include <chrono>
+#include <climits>
 
-TextureDataManager::TextureDataManager()
+void TextureDataList::pushFront(TextureData* tex)
+{
+	tex->mLruPrev = nullptr;
+	tex->mLruNext = mHead;
+
+	if (mHead != nullptr)
+		mHead->mLruPrev = tex;
+	else
+		mTail = tex;
+
+	mHead = tex;
+	tex->mLruLinked = true;
+}
+
+void TextureDataList::unlink(TextureData* tex)
+{
+	if (tex->mLruPrev != nullptr)
+		tex->mLruPrev->mLruNext = tex->mLruNext;
+	else
+		mHead = tex->mLruNext;
+
+	if (tex->mLruNext != nullptr)
+		tex->mLruNext->mLruPrev = tex->mLruPrev;
+	else
+		mTail = tex->mLruPrev;
+
+	tex->mLruPrev = nullptr;
+	tex->mLruNext = nullptr;
+	tex->mLruLinked = false;
+}
+
+TextureDataManager::TextureDataManager() : mTotalSize(0), mCommittedSize(0), mSnapshotVisible(0)
 {
 	unsigned char data[5 * 5 * 4];
 	mBlank = std::make_shared<TextureData>(false, false);
@@ -19,11 +54,22 @@ TextureDataManager::TextureDataManager()
 	}
 	mBlank->initFromRGBA(data, 5, 5);
 	mLoader = new TextureLoader(this);
+
+	TextureAtlas::setManager(this);
 }
 
 TextureDataManager::~TextureDataManager()
 {
+	TextureAtlas::setManager(nullptr);
+
 	delete mLoader;
+
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	for (auto it = mTextureLookup.cbegin(); it != mTextureLookup.cend(); it++)
+		detach(it->second.get());
+
+	mTextureLookup.clear();
 }
 
 void TextureDataManager::onTextureLoaded(std::shared_ptr<TextureData> tex)
@@ -32,8 +78,7 @@ void TextureDataManager::onTextureLoaded(std::shared_ptr<TextureData> tex)
 
 	for (auto it = mTextureLookup.cbegin(); it != mTextureLookup.cend(); it++)
 	{
-		std::shared_ptr<TextureData> texture = *(*it).second;
-		if (texture == tex)
+		if (it->second == tex)
 		{
 			const TextureResource* pResource = it->first;
 			((TextureResource*)pResource)->onTextureLoaded(tex);
@@ -41,23 +86,71 @@ void TextureDataManager::onTextureLoaded(std::shared_ptr<TextureData> tex)
 	}
 }
 
+void TextureDataManager::onTextureSizeChanged(size_t oldSize, size_t newSize, size_t oldVRAM, size_t newVRAM)
+{
+	mTotalSize += newSize;
+	mTotalSize -= oldSize;
+	mCommittedSize += newVRAM;
+	mCommittedSize -= oldVRAM;
+}
+
+void TextureDataManager::attach(TextureData* tex)
+{
+	std::unique_lock<std::mutex> lock(tex->mMutex);
+
+	tex->mManager = this;
+	tex->mAccountedSize = 0;
+	tex->mAccountedVRAM = 0;
+	tex->updateAccounting();
+}
+
+void TextureDataManager::detach(TextureData* tex)
+{
+	if (tex->mLruLinked)
+		(tex->mPinned ? mPinnedTextures : mEvictableTextures).unlink(tex);
+
+	std::unique_lock<std::mutex> lock(tex->mMutex);
+
+	onTextureSizeChanged(tex->mAccountedSize, 0, tex->mAccountedVRAM, 0);
+	tex->mManager = nullptr;
+	tex->mAccountedSize = 0;
+	tex->mAccountedVRAM = 0;
+}
+
+void TextureDataManager::touch(TextureData* tex)
+{
+	// The path is only known after initFromPath(), so the pool is chosen each time the texture is touched
+	bool pinned = tex->getPath().rfind(":/") == 0;
+
+	if (tex->mLruLinked)
+	{
+		TextureDataList& current = tex->mPinned ? mPinnedTextures : mEvictableTextures;
+		if (pinned == tex->mPinned && current.front() == tex)
+			return;
+
+		current.unlink(tex);
+	}
+
+	tex->mPinned = pinned;
+	(pinned ? mPinnedTextures : mEvictableTextures).pushFront(tex);
+}
+
 std::shared_ptr<TextureData> TextureDataManager::add(const TextureResource* key, bool tiled, bool linear)
 {	
 	std::unique_lock<std::mutex> lock(mMutex);
 
-	// Find the entry in the list
+	// Find the entry in the lookup and release it
 	auto it = mTextureLookup.find(key);
 	if (it != mTextureLookup.cend())
 	{
-		// Remove the list entry
-		mTextures.erase((*it).second);
-		// And the lookup
+		detach(it->second.get());
 		mTextureLookup.erase(it);
 	}
 
 	std::shared_ptr<TextureData> data = std::make_shared<TextureData>(tiled, linear);
-	mTextures.push_front(data);
-	mTextureLookup[key] = mTextures.cbegin();
+	mTextureLookup[key] = data;
+	attach(data.get());
+	touch(data.get());
 
 	return data;
 }
@@ -66,13 +159,11 @@ void TextureDataManager::remove(const TextureResource* key)
 {
 	std::unique_lock<std::mutex> lock(mMutex);
 
-	// Find the entry in the list
+	// Find the entry in the lookup and release it
 	auto it = mTextureLookup.find(key);
 	if (it != mTextureLookup.cend())
 	{
-		// Remove the list entry
-		mTextures.erase((*it).second);
-		// And the lookup
+		detach(it->second.get());
 		mTextureLookup.erase(it);
 	}
 }
@@ -83,30 +174,41 @@ void TextureDataManager::cancelAsync(const TextureResource* key)
 
 	auto it = mTextureLookup.find(key);
 	if (it != mTextureLookup.cend())
-		mLoader->remove(*(*it).second);
+		mLoader->remove(it->second);
+}
+
+void TextureDataManager::setLoadPriorities(const std::vector<std::pair<const TextureResource*, int>>& priorities)
+{
+	std::vector<std::pair<std::shared_ptr<TextureData>, int>> textures;
+
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+
+		for (auto it : priorities)
+		{
+			auto tx = mTextureLookup.find(it.first);
+			if (tx != mTextureLookup.cend())
+				textures.push_back(std::make_pair(tx->second, it.second));
+		}
+	}
+
+	mLoader->setPriorities(textures);
 }
 
 std::shared_ptr<TextureData> TextureDataManager::get(const TextureResource* key, bool enableLoading)
 {
 	std::unique_lock<std::mutex> lock(mMutex);
 	
-	// If it's in the cache then we want to remove it from it's current location and
-	// move it to the top
+	// If it's in the cache then we want to move it to the top of its pool. Textures that
+	// were evicted only come back in the pools when they are requested for loading
 	std::shared_ptr<TextureData> tex;
 	auto it = mTextureLookup.find(key);
 	if (it != mTextureLookup.cend())
 	{
-		tex = *(*it).second;
+		tex = it->second;
 
-		if (mTextures.cbegin() != (*it).second)
-		{
-			// Remove the list entry
-			mTextures.erase((*it).second);
-			// Put it at the top
-			mTextures.push_front(tex);
-			// Store it back in the lookup
-			mTextureLookup[key] = mTextures.cbegin();
-		}
+		if (enableLoading || tex->mLruLinked)
+			touch(tex.get());
 
 		// Make sure it's loaded or queued for loading
 		if (enableLoading && !tex->isLoaded())
@@ -124,7 +226,10 @@ bool TextureDataManager::bind(const TextureResource* key)
 	std::shared_ptr<TextureData> tex = get(key);
 	bool bound = false;
 	if (tex != nullptr)
+	{
+		tex->mLastBoundFrame = Renderer::getFrameCount();
 		bound = tex->uploadAndBind();
+	}
 	if (!bound)
 		mBlank->uploadAndBind();
 	return bound;
@@ -132,24 +237,12 @@ bool TextureDataManager::bind(const TextureResource* key)
 
 size_t TextureDataManager::getTotalSize()
 {
-	std::unique_lock<std::mutex> lock(mMutex);
-
-	size_t total = 0;
-	for (auto tex : mTextures)
-		total += tex->width() * tex->height() * 4;
-
-	return total;
+	return mTotalSize;
 }
 
 size_t TextureDataManager::getCommittedSize()
 {
-	std::unique_lock<std::mutex> lock(mMutex);
-
-	size_t total = 0;
-	for (auto tex : mTextures)
-		total += tex->getVRAMUsage();
-
-	return total;
+	return mCommittedSize;
 }
 
 size_t TextureDataManager::getQueueSize()
@@ -157,14 +250,34 @@ size_t TextureDataManager::getQueueSize()
 	return mLoader->getQueueSize();
 }
 
-bool compareTextures(const std::shared_ptr<TextureData>& first, const std::shared_ptr<TextureData>& second)
+size_t TextureDataManager::evict(TextureData* tex)
 {
-	bool isResource = first->getPath().rfind(":/") == 0;
-	bool secondIsResource = second->getPath().rfind(":/") == 0;
-	if (isResource && !secondIsResource)
-		return true;
+	size_t freed = 0;
 
-	return false;
+	if (tex->isLoaded())
+	{
+		LOG(LogDebug) << "Cleanup VRAM\tReleased : " << tex->getPath().c_str();
+
+		freed += tex->getVRAMUsage();
+		tex->releaseVRAM();
+		tex->releaseRAM();
+	}
+
+	// It may be already in the loader queue. In this case it wouldn't have been using
+	// any VRAM yet but it will be. Remove it from the loader queue
+	if (mLoader->remove(tex))
+	{
+		LOG(LogDebug) << "Cleanup VRAM\tRemoved from queue : " << tex->getPath().c_str();
+
+		// The loader thread updates the accounting with the texture mutex held
+		std::unique_lock<std::mutex> lock(tex->mMutex);
+		freed += tex->mAccountedSize;
+	}
+
+	// Released textures leave the pools until they are requested again
+	(tex->mPinned ? mPinnedTextures : mEvictableTextures).unlink(tex);
+
+	return freed;
 }
 
 void TextureDataManager::load(std::shared_ptr<TextureData> tex, bool block)
@@ -192,42 +305,22 @@ void TextureDataManager::load(std::shared_ptr<TextureData> tex, bool block)
 
 		std::unique_lock<std::mutex> lock(mMutex);
 
-		std::list<std::shared_ptr<TextureData>> orderedTextures(mTextures);
-		orderedTextures.sort(compareTextures);
-
-		for (auto it = orderedTextures.crbegin(); it != orderedTextures.crend(); ++it)
+		// Least recently used textures go first, theme resources only when nothing else is left
+		TextureDataList* pools[] = { &mEvictableTextures, &mPinnedTextures };
+		for (TextureDataList* pool : pools)
 		{
-			if (size < max_texture)
-				break;
-
-			if ((*it) == tex)
-				continue;
-
-			bool changed = false;
-
-			if ((*it)->isLoaded())
+			TextureData* it = pool->back();
+			while (it != nullptr && size >= max_texture)
 			{
-				LOG(LogDebug) << "Cleanup VRAM\tReleased : " << (*it)->getPath().c_str();
-
-				(*it)->releaseVRAM();
-				(*it)->releaseRAM();
-
-				changed = true;
-			}
+				TextureData* prev = it->mLruPrev;
 
-			// It may be already in the loader queue. In this case it wouldn't have been using
-			// any VRAM yet but it will be. Remove it from the loader queue
-			if (mLoader->remove(*it))
-			{
-				LOG(LogDebug) << "Cleanup VRAM\tRemoved from queue : " << (*it)->getPath().c_str();
-				changed = true;
-			}
+				if (it != tex.get())
+				{
+					size_t freed = evict(it);
+					size = freed < size ? size - freed : 0;
+				}
 
-			if (changed)
-			{
-				lock.unlock();
-				size = TextureResource::getTotalMemUsage();
-				lock.lock();
+				it = prev;
 			}
 		}
 	}
@@ -241,7 +334,104 @@ void TextureDataManager::load(std::shared_ptr<TextureData> tex, bool block)
 	}
 }
 
-TextureLoader::TextureLoader(TextureDataManager* mgr) : mManager(mgr), mExit(false)
+void TextureDataManager::snapshot()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	std::unordered_map<TextureData*, std::shared_ptr<TextureData>> textures;
+	for (auto it = mTextureLookup.cbegin(); it != mTextureLookup.cend(); it++)
+		textures[it->second.get()] = it->second;
+
+	// Drawn in the last two frames : on screen
+	const unsigned int frame = Renderer::getFrameCount();
+
+	std::vector<std::weak_ptr<TextureData>> visible;
+	std::vector<std::weak_ptr<TextureData>> others;
+
+	TextureDataList* pools[] = { &mPinnedTextures, &mEvictableTextures };
+	for (TextureDataList* pool : pools)
+	{
+		for (TextureData* tex = pool->front(); tex != nullptr; tex = tex->mLruNext)
+		{
+			auto it = textures.find(tex);
+			if (it == textures.cend() || !tex->isLoaded())
+				continue;
+
+			if (tex->mLastBoundFrame + 2 >= frame)
+				visible.push_back(it->second);
+			else
+				others.push_back(it->second);
+		}
+	}
+
+	mSnapshot = visible;
+	mSnapshot.insert(mSnapshot.end(), others.cbegin(), others.cend());
+	mSnapshotVisible = visible.size();
+
+	LOG(LogDebug) << "TextureDataManager::snapshot : " << visible.size() << " textures on screen, " << others.size() << " others";
+}
+
+size_t TextureDataManager::restore(int timeout)
+{
+	std::vector<std::shared_ptr<TextureData>> textures;
+	std::vector<std::shared_ptr<TextureData>> visible;
+
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+
+		for (size_t i = 0; i < mSnapshot.size(); i++)
+		{
+			auto tex = mSnapshot[i].lock();
+			if (tex == nullptr)
+				continue;
+
+			textures.push_back(tex);
+			if (i < mSnapshotVisible)
+				visible.push_back(tex);
+		}
+
+		mSnapshot.clear();
+		mSnapshotVisible = 0;
+	}
+
+	if (textures.empty())
+		return 0;
+
+	// The priorities given by the views before the launch don't apply anymore, the views will set them again
+	std::vector<std::pair<std::shared_ptr<TextureData>, int>> priorities;
+	for (auto tex : textures)
+		priorities.push_back(std::make_pair(tex, 0));
+
+	mLoader->setPriorities(priorities);
+
+	// The last request loads first : queue the snapshot backwards
+	for (auto it = textures.crbegin(); it != textures.crend(); it++)
+		if (!(*it)->isLoaded())
+			load(*it);
+
+	const auto start = std::chrono::steady_clock::now();
+
+	for (auto tex : visible)
+	{
+		while (!tex->isLoaded() && mLoader->isPending(tex.get()))
+		{
+			if (std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() >= timeout)
+			{
+				LOG(LogWarning) << "TextureDataManager::restore : timeout, the textures on screen will fade in";
+				return visible.size();
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	LOG(LogDebug) << "TextureDataManager::restore : " << visible.size() << " textures on screen loaded in " <<
+		std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() << "ms, " << textures.size() - visible.size() << " others queued";
+
+	return visible.size();
+}
+
+TextureLoader::TextureLoader(TextureDataManager* mgr) : mSequence(0), mQueueSize(0), mProcessing(0), mLoadedCount(0), mCancelledCount(0), mExit(false), mManager(mgr)
 {
 	int num_threads = std::thread::hardware_concurrency() / 2;
 	if (num_threads == 0)
@@ -264,6 +454,25 @@ TextureLoader::~TextureLoader()
 		t.join();
 }
 
+void TextureLoader::enqueue(const std::shared_ptr<TextureData>& textureData, unsigned int sequence)
+{
+	// Most recent requests have the lowest key for a same priority
+	TextureLoaderKey key(textureData->mLoadPriority, UINT_MAX - sequence);
+
+	textureData->mLoaderHandle = mTextureDataQ.insert(std::make_pair(key, textureData));
+	textureData->mLoaderQueued = true;
+	textureData->mLoaderQueuedSize = textureData->mWidth * textureData->mHeight * 4;
+	mQueueSize += textureData->mLoaderQueuedSize;
+}
+
+void TextureLoader::dequeue(TextureData* textureData)
+{
+	mQueueSize -= textureData->mLoaderQueuedSize;
+	textureData->mLoaderQueuedSize = 0;
+	textureData->mLoaderQueued = false;
+	mTextureDataQ.erase(textureData->mLoaderHandle);
+}
+
 void TextureLoader::threadProc()
 {
 	while (true)
@@ -277,10 +486,10 @@ void TextureLoader::threadProc()
 
 		if (!mTextureDataQ.empty())
 		{
-			std::shared_ptr<TextureData> textureData = mTextureDataQ.front();
-			mTextureDataQ.pop_front();
-
-			mProcessingTextureDataQ.push_back(textureData);
+			std::shared_ptr<TextureData> textureData = mTextureDataQ.cbegin()->second;
+			dequeue(textureData.get());
+			textureData->mLoaderProcessing = true;
+			mProcessing++;
 
 			lock.unlock();
 
@@ -292,11 +501,14 @@ void TextureLoader::threadProc()
 				textureData->load(true);
 				//mManager->onTextureLoaded(textureData);				
 
-				lock.lock();
-				mProcessingTextureDataQ.remove(textureData);			
-				lock.unlock();
+				mLoadedCount++;
 			}
 
+			lock.lock();
+			textureData->mLoaderProcessing = false;
+			mProcessing--;
+			lock.unlock();
+
 			std::this_thread::yield();
 		}		
 	}
@@ -311,32 +523,68 @@ void TextureLoader::load(std::shared_ptr<TextureData> textureData)
 		return;
 
 	// If is is currently loading, don't add again
-	if (std::find(mProcessingTextureDataQ.cbegin(), mProcessingTextureDataQ.cend(), textureData) != mProcessingTextureDataQ.cend())
+	if (textureData->mLoaderProcessing)
 		return;
 
 	// Remove it from the queue if it is already there
-	auto tx = std::find(mTextureDataQ.cbegin(), mTextureDataQ.cend(), textureData);
-	if (tx != mTextureDataQ.cend())
-		mTextureDataQ.erase(tx);
+	if (textureData->mLoaderQueued)
+		dequeue(textureData.get());
 
-	// Put it on the start of the queue as we want the newly requested textures to load first
-	mTextureDataQ.push_front(textureData);
+	// Newly requested textures load first among the ones sharing their priority
+	enqueue(textureData, mSequence++);
 	mEvent.notify_one();
 }
 
 bool TextureLoader::remove(std::shared_ptr<TextureData> textureData)
+{
+	return remove(textureData.get());
+}
+
+bool TextureLoader::remove(TextureData* textureData)
 {
 	// Just remove it from the queue so we don't attempt to load it
 	std::unique_lock<std::mutex> lock(mLoaderLock);
 
-	auto tx = std::find(mTextureDataQ.cbegin(), mTextureDataQ.cend(), textureData);
-	if (tx != mTextureDataQ.cend())
+	if (!textureData->mLoaderQueued)
+		return false;
+
+	dequeue(textureData);
+	mCancelledCount++;
+	return true;
+}
+
+void TextureLoader::setPriorities(const std::vector<std::pair<std::shared_ptr<TextureData>, int>>& priorities)
+{
+	std::unique_lock<std::mutex> lock(mLoaderLock);
+
+	for (auto it : priorities)
 	{
-		mTextureDataQ.erase(tx);
-		return true;
+		std::shared_ptr<TextureData>& textureData = it.first;
+		if (textureData->mLoadPriority == it.second)
+			continue;
+
+		textureData->mLoadPriority = it.second;
+
+		// Move it to its new place in the queue, keeping its request order
+		if (textureData->mLoaderQueued)
+		{
+			unsigned int sequence = UINT_MAX - textureData->mLoaderHandle->first.second;
+			dequeue(textureData.get());
+			enqueue(textureData, sequence);
+		}
 	}
+}
 
-	return false;
+bool TextureLoader::isPending(TextureData* textureData)
+{
+	std::unique_lock<std::mutex> lock(mLoaderLock);
+	return textureData->mLoaderQueued || textureData->mLoaderProcessing;
+}
+
+bool TextureLoader::isIdle()
+{
+	std::unique_lock<std::mutex> lock(mLoaderLock);
+	return mTextureDataQ.empty() && mProcessing == 0;
 }
 
 size_t TextureLoader::getQueueSize()
@@ -345,11 +593,7 @@ size_t TextureLoader::getQueueSize()
 
 	// Gets the amount of video memory that will be used once all textures in
 	// the queue are loaded
-	size_t mem = 0;
-	for (auto tex : mTextureDataQ)
-		mem += tex->width() * tex->height() * 4;
-
-	return mem;
+	return mQueueSize;
 }
 
 void TextureLoader::clearQueue()
@@ -357,7 +601,14 @@ void TextureLoader::clearQueue()
 	std::unique_lock<std::mutex> lock(mLoaderLock);
 
 	// Just abort any waiting texture
-	mTextureDataQ.clear();	
+	for (auto it = mTextureDataQ.cbegin(); it != mTextureDataQ.cend(); it++)
+	{
+		it->second->mLoaderQueued = false;
+		it->second->mLoaderQueuedSize = 0;
+	}
+
+	mTextureDataQ.clear();
+	mQueueSize = 0;
 }
 
 void TextureDataManager::clearQueue()
@@ -2,18 +2,25 @@
 #ifndef ES_CORE_RESOURCES_TEXTURE_DATA_MANAGER_H
 #define ES_CORE_RESOURCES_TEXTURE_DATA_MANAGER_H
 
+#include <atomic>
 #include <condition_variable>
-#include <list>
-#include <map>
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
+#include "resources/TextureData.h"
+
 class TextureDataManager;
-class TextureData;
 class TextureResource;
 
+//
+// Background texture loader. Pending textures are ordered by their load priority (lower
+// values first, typically the distance from the cursor) and then by most recent request.
+// Each TextureData keeps a handle on its queue entry so cancelling or reprioritising is
+// done without searching the queue
+//
 class TextureLoader
 {
 public:
@@ -22,15 +29,37 @@ public:
 
 	void load(std::shared_ptr<TextureData> textureData);
 	bool remove(std::shared_ptr<TextureData> textureData);
+	bool remove(TextureData* textureData);
 	void clearQueue();
 
+	// Updates the priority of a batch of textures, reordering the ones that are waiting in the queue
+	void setPriorities(const std::vector<std::pair<std::shared_ptr<TextureData>, int>>& priorities);
+
 	size_t getQueueSize();
 
+	// True while the texture waits in the queue or is being decoded
+	bool isPending(TextureData* textureData);
+	// True when nothing is queued or being decoded
+	bool isIdle();
+
+	// Number of textures decoded by the loader threads, and number of queued textures cancelled before decoding
+	size_t getLoadedCount() { return mLoadedCount; }
+	size_t getCancelledCount() { return mCancelledCount; }
+
 private:	
 	void threadProc();
 
-	std::list<std::shared_ptr<TextureData>> 										mProcessingTextureDataQ;
-	std::list<std::shared_ptr<TextureData>> 										mTextureDataQ;
+	// Must be called with mLoaderLock held
+	void enqueue(const std::shared_ptr<TextureData>& textureData, unsigned int sequence);
+	void dequeue(TextureData* textureData);
+
+	TextureLoaderQueue			mTextureDataQ;
+	unsigned int				mSequence;
+	size_t						mQueueSize;
+	size_t						mProcessing;
+
+	std::atomic<size_t>			mLoadedCount;
+	std::atomic<size_t>			mCancelledCount;
 
 	std::vector<std::thread>	mThreads;
 	std::mutex					mLoaderLock;
@@ -40,6 +69,26 @@ private:
 	TextureDataManager*			mManager;
 };
 
+//
+// Intrusive doubly linked list over the LRU links of TextureData. The list does not own
+// its items, TextureDataManager keeps them alive through its lookup table
+//
+class TextureDataList
+{
+public:
+	TextureDataList() : mHead(nullptr), mTail(nullptr) { }
+
+	void pushFront(TextureData* tex);
+	void unlink(TextureData* tex);
+
+	TextureData* front() { return mHead; }
+	TextureData* back() { return mTail; }
+
+private:
+	TextureData* mHead;
+	TextureData* mTail;
+};
+
 //
 // This class manages the loading and unloading of textures
 //
@@ -54,6 +103,10 @@ private:
 // to releaseRAM() which frees the memory buffer if the texture can be reloaded from
 // disk if needed again
 //
+// Textures are kept in two LRU pools : theme resources (":/" paths) are pinned and only
+// evicted once every other texture has been released. Evicted textures leave the pools
+// until they are requested again, so eviction only walks textures that hold memory
+//
 class TextureDataManager
 {
 public:
@@ -68,6 +121,7 @@ public:
 	void remove(const TextureResource* key);
 
 	void cancelAsync(const TextureResource* key);
+	void setLoadPriorities(const std::vector<std::pair<const TextureResource*, int>>& priorities);
 	std::shared_ptr<TextureData> get(const TextureResource* key, bool enableLoading = true);
 	bool bind(const TextureResource* key);
 
@@ -83,15 +137,42 @@ public:
 
 	void clearQueue();
 
+	// Game launches : remembers the loaded textures before the renderer is destroyed, most recently used first.
+	// When it is back, restore() queues them again in that order and waits up to 'timeout' ms for the ones
+	// drawn in the last frames, so the first frame is complete. Returns the number of textures waited for
+	void snapshot();
+	size_t restore(int timeout);
+
+	TextureLoader* getLoader() { return mLoader; }
+
 	void onTextureLoaded(std::shared_ptr<TextureData> tex);
 
+	// Called by TextureData (with its own lock held) whenever its size or residency changes
+	void onTextureSizeChanged(size_t oldSize, size_t newSize, size_t oldVRAM, size_t newVRAM);
+
 private:
+	void attach(TextureData* tex);
+	void detach(TextureData* tex);
+
+	// Moves the texture to the front of its pool. Must be called with mMutex held
+	void touch(TextureData* tex);
+	// Releases the texture and returns the number of bytes freed. Must be called with mMutex held
+	size_t evict(TextureData* tex);
+
 	std::mutex					mMutex;
 
-	std::list<std::shared_ptr<TextureData> >												mTextures;
-	std::map<const TextureResource*, std::list<std::shared_ptr<TextureData> >::const_iterator > 	mTextureLookup;
-	std::shared_ptr<TextureData>															mBlank;
-	TextureLoader*																			mLoader;
+	std::unordered_map<const TextureResource*, std::shared_ptr<TextureData> >	mTextureLookup;
+	TextureDataList				mPinnedTextures;
+	TextureDataList				mEvictableTextures;
+
+	std::atomic<size_t>			mTotalSize;
+	std::atomic<size_t>			mCommittedSize;
+
+	std::shared_ptr<TextureData>	mBlank;
+	TextureLoader*					mLoader;
+
+	std::vector<std::weak_ptr<TextureData>>	mSnapshot;
+	size_t									mSnapshotVisible; // the first entries of mSnapshot were on screen
 };
 
 #endif // ES_CORE_RESOURCES_TEXTURE_DATA_MANAGER_H
@@ -0,0 +1,312 @@
+#include "resources/TextureDiskCache.h"
+
+#include "math/Misc.h"
+#include "utils/FileSystemUtil.h"
+#include "Settings.h"
+#include "Log.h"
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#if !WIN32
+#include <sys/stat.h>
+#endif
+
+#define TEXTURE_CACHE_MAGIC		0x43545345 // "ESTC"
+#define TEXTURE_CACHE_VERSION	1
+#define TEXTURE_CACHE_PRUNE		0.9 // pruning goes down to 90% of the limit, so it doesn't run again at the next save
+
+struct TextureCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	int32_t  baseWidth;
+	int32_t  baseHeight;
+	int32_t  packedWidth;
+	int32_t  packedHeight;
+	uint32_t pathLength;
+};
+
+static uint64_t fnv1a(const std::string& value)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (auto c : value)
+	{
+		hash ^= (unsigned char)c;
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+struct TextureCacheFile
+{
+	std::string path;
+	size_t		size;
+	time_t		time;
+};
+
+static std::mutex	sCacheLock;
+static bool			sCacheScanned = false;
+static bool			sCacheScanning = false; // A loader thread is listing or pruning the folder, without holding sCacheLock
+static size_t		sCacheSize = 0;
+
+static std::string getCacheRoot()
+{
+	return Utils::FileSystem::getEsConfigPath() + "/cache/textures";
+}
+
+// Path of the source image, as stored after the header of an entry
+static std::string readSourcePath(const std::string& entryPath)
+{
+	FILE* f = fopen(entryPath.c_str(), "rb");
+	if (f == nullptr)
+		return "";
+
+	std::string path;
+
+	TextureCacheHeader header;
+	if (fread(&header, sizeof(header), 1, f) == 1 && header.magic == TEXTURE_CACHE_MAGIC && header.version == TEXTURE_CACHE_VERSION && header.pathLength < 4096)
+	{
+		path.resize(header.pathLength);
+		if (header.pathLength > 0 && fread(&path[0], 1, header.pathLength, f) != header.pathLength)
+			path = "";
+	}
+
+	fclose(f);
+	return path;
+}
+
+// Lists the entries of the cache. Entries of images that don't exist anymore, and entries that can't be read, are removed on the way
+static std::vector<TextureCacheFile> listEntries()
+{
+	std::vector<TextureCacheFile> entries;
+
+	for (auto folder : Utils::FileSystem::getDirectoryFiles(getCacheRoot()))
+	{
+		if (!folder.directory)
+			continue;
+
+		for (auto file : Utils::FileSystem::getDirectoryFiles(folder.path))
+		{
+			if (file.directory || Utils::FileSystem::getExtension(file.path) != ".tex")
+				continue;
+
+			std::string sourcePath = readSourcePath(file.path);
+			if (sourcePath.empty() || !Utils::FileSystem::exists(sourcePath))
+			{
+				Utils::FileSystem::removeFile(file.path);
+				continue;
+			}
+
+			TextureCacheFile entry;
+			entry.path = file.path;
+
+#if WIN32
+			entry.size = Utils::FileSystem::getFileSize(file.path);
+			entry.time = Utils::FileSystem::getFileModificationDate(file.path).getTime();
+#else
+			struct stat info;
+			if (stat(file.path.c_str(), &info) != 0)
+				continue;
+
+			// With relatime the access date is updated at most once a day : good enough to keep the entries in use, without writing anything
+			entry.size = (size_t)info.st_size;
+			entry.time = std::max(info.st_atime, info.st_mtime);
+#endif
+			entries.push_back(entry);
+		}
+	}
+
+	return entries;
+}
+
+// Called after an entry was written : keeps the cache under TextureDiskCacheMaxSize by removing the entries used the longest time ago.
+// The folder is walked without holding sCacheLock, the other savers only add their size meanwhile
+static void onEntrySaved(size_t size)
+{
+	size_t maxSize = (size_t)Math::max(0, Settings::getInstance()->getInt("TextureDiskCacheMaxSize")) * 1024 * 1024;
+
+	{
+		std::unique_lock<std::mutex> lock(sCacheLock);
+
+		sCacheSize += size;
+
+		if (sCacheScanning || (sCacheScanned && (maxSize == 0 || sCacheSize <= maxSize)))
+			return;
+
+		sCacheScanning = true;
+	}
+
+	// The first scan of the session includes the new entry
+	std::vector<TextureCacheFile> entries = listEntries();
+
+	size_t total = 0;
+	for (auto entry : entries)
+		total += entry.size;
+
+	if (maxSize == 0 || total <= maxSize)
+	{
+		std::unique_lock<std::mutex> lock(sCacheLock);
+		sCacheSize = total;
+		sCacheScanned = true;
+		sCacheScanning = false;
+		return;
+	}
+
+	std::sort(entries.begin(), entries.end(), [](const TextureCacheFile& a, const TextureCacheFile& b) { return a.time < b.time; });
+
+	size_t target = (size_t)(maxSize * TEXTURE_CACHE_PRUNE);
+	int removed = 0;
+
+	for (auto entry : entries)
+	{
+		if (total <= target)
+			break;
+
+		if (Utils::FileSystem::removeFile(entry.path))
+		{
+			total -= entry.size;
+			removed++;
+		}
+	}
+
+	LOG(LogDebug) << "TextureDiskCache : " << removed << " entries removed, " << (total / 1024 / 1024) << " MB left";
+
+	std::unique_lock<std::mutex> lock(sCacheLock);
+	sCacheSize = total;
+	sCacheScanned = true;
+	sCacheScanning = false;
+}
+
+bool TextureDiskCache::isEnabled()
+{
+	return Settings::getInstance()->getBool("TextureDiskCache");
+}
+
+std::string TextureDiskCache::getEntryPath(const std::string& path, MaxSizeInfo& maxSize, size_t* sourceSize)
+{
+	size_t fileSize = Utils::FileSystem::getFileSize(path);
+	if (fileSize == 0)
+		return "";
+
+	if (sourceSize != nullptr)
+		*sourceSize = fileSize;
+
+	time_t modified = Utils::FileSystem::getFileModificationDate(path).getTime();
+
+	std::string key = path + "|" + std::to_string(fileSize) + "|" + std::to_string((long long)modified) + "|" +
+		std::to_string((int)maxSize.x()) + "x" + std::to_string((int)maxSize.y()) + (maxSize.externalZoom() ? "z" : "");
+
+	char hash[17];
+	snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)fnv1a(key));
+
+	// Spread entries in 256 folders so a large collection doesn't end up in one huge directory
+	return getCacheRoot() + "/" + std::string(hash, 2) + "/" + std::string(hash) + ".tex";
+}
+
+unsigned char* TextureDiskCache::load(const std::string& path, MaxSizeInfo maxSize, size_t& width, size_t& height, Vector2i& baseSize, Vector2i& packedSize, size_t* fileSize)
+{
+	std::string entryPath = getEntryPath(path, maxSize, fileSize);
+	if (entryPath.empty())
+		return nullptr;
+
+	FILE* f = fopen(entryPath.c_str(), "rb");
+	if (f == nullptr)
+		return nullptr;
+
+	TextureCacheHeader header;
+	if (fread(&header, sizeof(header), 1, f) != 1 || header.magic != TEXTURE_CACHE_MAGIC || header.version != TEXTURE_CACHE_VERSION || header.pathLength != path.size() ||
+		header.width == 0 || header.height == 0 || header.width > 16384 || header.height > 16384)
+	{
+		fclose(f);
+		return nullptr;
+	}
+
+	std::string storedPath(header.pathLength, '\0');
+	if (header.pathLength > 0 && (fread(&storedPath[0], 1, header.pathLength, f) != header.pathLength || storedPath != path))
+	{
+		fclose(f);
+		return nullptr;
+	}
+
+	// The pixels are read straight into the buffer handed to the texture, a short read is a truncated entry
+	size_t dataSize = (size_t)header.width * header.height * 4;
+	unsigned char* dataRGBA = new unsigned char[dataSize];
+
+	bool ok = fread(dataRGBA, 1, dataSize, f) == dataSize && fgetc(f) == EOF;
+	fclose(f);
+
+	if (!ok)
+	{
+		delete[] dataRGBA;
+		return nullptr;
+	}
+
+	width = header.width;
+	height = header.height;
+	baseSize = Vector2i(header.baseWidth, header.baseHeight);
+	packedSize = Vector2i(header.packedWidth, header.packedHeight);
+
+	return dataRGBA;
+}
+
+void TextureDiskCache::save(const std::string& path, MaxSizeInfo maxSize, const unsigned char* dataRGBA, size_t width, size_t height, const Vector2i& baseSize, const Vector2i& packedSize)
+{
+	if (dataRGBA == nullptr || width == 0 || height == 0)
+		return;
+
+	std::string entryPath = getEntryPath(path, maxSize);
+	if (entryPath.empty())
+		return;
+
+	Utils::FileSystem::createDirectory(Utils::FileSystem::getParent(entryPath));
+
+	TextureCacheHeader header;
+	header.magic = TEXTURE_CACHE_MAGIC;
+	header.version = TEXTURE_CACHE_VERSION;
+	header.width = (uint32_t)width;
+	header.height = (uint32_t)height;
+	header.baseWidth = baseSize.x();
+	header.baseHeight = baseSize.y();
+	header.packedWidth = packedSize.x();
+	header.packedHeight = packedSize.y();
+	header.pathLength = (uint32_t)path.size();
+
+	// Write to a temporary file first so a reader never sees a partial entry
+	std::string tempPath = entryPath + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+
+	FILE* f = fopen(tempPath.c_str(), "wb");
+	if (f == nullptr)
+	{
+		LOG(LogWarning) << "TextureDiskCache::save\tUnable to write " << tempPath;
+		return;
+	}
+
+	bool ok =
+		fwrite(&header, sizeof(header), 1, f) == 1 &&
+		fwrite(path.c_str(), 1, path.size(), f) == path.size() &&
+		fwrite(dataRGBA, 1, width * height * 4, f) == width * height * 4;
+
+	fclose(f);
+
+	if (ok)
+	{
+#if WIN32
+		Utils::FileSystem::removeFile(entryPath);
+#endif
+		ok = rename(tempPath.c_str(), entryPath.c_str()) == 0;
+	}
+
+	if (!ok)
+		Utils::FileSystem::removeFile(tempPath);
+	else
+		onEntrySaved(sizeof(header) + path.size() + width * height * 4);
+}
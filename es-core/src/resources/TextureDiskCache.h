@@ -0,0 +1,29 @@
+#pragma once
+#ifndef ES_CORE_RESOURCES_TEXTURE_DISK_CACHE_H
+#define ES_CORE_RESOURCES_TEXTURE_DISK_CACHE_H
+
+#include "ImageIO.h"
+#include <string>
+
+//
+// Persistent cache of downscaled RGBA pixels, stored under <EsConfigPath>/cache/textures.
+// Entries are addressed by a hash of the image path, its size, its modification date and
+// the target MaxSizeInfo, so a modified image or a different tile size gets a new entry.
+// Reading an entry is a single read into the pixel buffer instead of a full image decode.
+// The folder is kept under TextureDiskCacheMaxSize : the entries used the longest time ago, and the ones of
+// images that don't exist anymore, are removed when a new entry goes over it
+//
+class TextureDiskCache
+{
+public:
+	static bool isEnabled();
+
+	// Returns a new[] allocated RGBA buffer or nullptr if there is no valid entry. fileSize receives the size of the image file
+	static unsigned char* load(const std::string& path, MaxSizeInfo maxSize, size_t& width, size_t& height, Vector2i& baseSize, Vector2i& packedSize, size_t* fileSize = nullptr);
+	static void save(const std::string& path, MaxSizeInfo maxSize, const unsigned char* dataRGBA, size_t width, size_t height, const Vector2i& baseSize, const Vector2i& packedSize);
+
+private:
+	static std::string getEntryPath(const std::string& path, MaxSizeInfo& maxSize, size_t* fileSize = nullptr);
+};
+
+#endif // ES_CORE_RESOURCES_TEXTURE_DISK_CACHE_H
@@ -101,9 +101,9 @@ void TextureResource::onTextureLoaded(std::shared_ptr<TextureData> tex)
 //	PowerSaver::pushRefreshEvent();
 }
 
-void TextureResource::initFromExternalPixels(unsigned char* dataRGBA, size_t width, size_t height)
+void TextureResource::initFromExternalPixels(unsigned char* data, size_t width, size_t height, Renderer::Texture::Type type)
 {
-	mTextureData->initFromExternalRGBA(dataRGBA, width, height);
+	mTextureData->initFromExternalPixels(data, width, height, type);
 
 	// Cache the image dimensions
 	mSize = Vector2i((int)width, (int)height);
@@ -167,12 +167,31 @@ bool TextureResource::bind()
 	return sTextureDataManager.bind(this);	
 }
 
+unsigned int TextureResource::getTextureId()
+{
+	if (mTextureData == nullptr || !mTextureData->uploadAndBind())
+		return 0;
+
+	return mTextureData->getTextureId();
+}
+
 void TextureResource::cancelAsync(std::shared_ptr<TextureResource> texture)
 {
 	if (texture != nullptr)
 		sTextureDataManager.cancelAsync(texture.get());
 }
 
+void TextureResource::setLoadPriorities(const std::vector<std::pair<std::shared_ptr<TextureResource>, int>>& priorities)
+{
+	std::vector<std::pair<const TextureResource*, int>> keys;
+	for (auto it : priorities)
+		if (it.first != nullptr && it.first->mTextureData == nullptr)
+			keys.push_back(std::make_pair(it.first.get(), it.second));
+
+	if (keys.size() > 0)
+		sTextureDataManager.setLoadPriorities(keys);
+}
+
 std::shared_ptr<TextureResource> TextureResource::get(const std::string& path, bool tile, bool linear, bool forceLoad, bool dynamic, bool asReloadable, MaxSizeInfo* maxSize)
 {
 	std::shared_ptr<ResourceManager>& rm = ResourceManager::getInstance();
@@ -318,6 +337,16 @@ size_t TextureResource::getTotalTextureSize()
 	return total;
 }
 
+size_t TextureResource::getLoadedCount()
+{
+	return sTextureDataManager.getLoader()->getLoadedCount();
+}
+
+size_t TextureResource::getCancelledCount()
+{
+	return sTextureDataManager.getLoader()->getCancelledCount();
+}
+
 bool TextureResource::unload()
 {
 	// Release the texture's resources
@@ -351,4 +380,19 @@ void TextureResource::reload()
 void TextureResource::clearQueue()
 {
 	sTextureDataManager.clearQueue();
-}
\ No newline at end of file
+}
+
+void TextureResource::snapshotTextures()
+{
+	sTextureDataManager.snapshot();
+}
+
+size_t TextureResource::restoreTextures(int timeout)
+{
+	return sTextureDataManager.restore(timeout);
+}
+
+bool TextureResource::isLoading()
+{
+	return !sTextureDataManager.getLoader()->isIdle();
+}
@@ -7,9 +7,11 @@
 #include "resources/ResourceManager.h"
 #include "resources/TextureDataManager.h"
 #include "resources/TextureData.h"
+#include <map>
 #include <set>
 #include <string>
 #include <tuple>
+#include <vector>
 
 // An OpenGL texture.
 // Automatically recreates the texture with renderer deinit/reinit.
@@ -20,9 +22,11 @@ public:
 
 public:
 	static void cancelAsync(std::shared_ptr<TextureResource> texture);
+	// Reorders the pending asynchronous loads, lower priorities load first
+	static void setLoadPriorities(const std::vector<std::pair<std::shared_ptr<TextureResource>, int>>& priorities);
 	static std::shared_ptr<TextureResource> get(const std::string& path, bool tile = false, bool linear = false, bool forceLoad = false, bool dynamic = true, bool asReloadable = true, MaxSizeInfo* maxSize = nullptr);
 	void initFromPixels(unsigned char* dataRGBA, size_t width, size_t height);
-	void initFromExternalPixels(unsigned char* dataRGBA, size_t width, size_t height);
+	void initFromExternalPixels(unsigned char* data, size_t width, size_t height, Renderer::Texture::Type type = Renderer::Texture::RGBA);
 	virtual void initFromMemory(const char* file, size_t length);
 
 	// For scalable source images in textures we want to set the resolution to rasterize at
@@ -37,8 +41,14 @@ public:
 	const Vector2i getSize() const;
 	bool bind();
 
+	// Uploads the texture if needed and returns its id, for the renderer calls taking several textures.
+	// Only for the textures that are not loaded from a file, 0 otherwise
+	unsigned int getTextureId();
+
 	static size_t getTotalMemUsage(); // returns an approximation of total VRAM used by textures (in bytes)
 	static size_t getTotalTextureSize(); // returns the number of bytes that would be used if all textures were in memory
+	static size_t getLoadedCount(); // returns the number of textures decoded by the async loader
+	static size_t getCancelledCount(); // returns the number of async loads cancelled before being decoded
 	
 	virtual bool unload();
 	virtual void reload();
@@ -47,6 +57,12 @@ public:
 
 	static void clearQueue();
 
+	// Game launches : the loaded textures are remembered before the renderer is destroyed, and loaded again
+	// in the same order after it is back (see TextureDataManager::snapshot)
+	static void snapshotTextures();
+	static size_t restoreTextures(int timeout);
+	static bool isLoading(); // true while the async loader has textures to decode
+
 private:
 	// mTextureData is used for textures that are not loaded from a file - these ones
 	// are permanently allocated and cannot be loaded and unloaded based on resources
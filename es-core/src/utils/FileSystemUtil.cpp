@@ -10,6 +10,8 @@
 #if defined(_WIN32)
 // because windows...
 #include <direct.h>
+#include <fcntl.h>
+#include <io.h>
 #include <Windows.h>
 #include <mutex>
 #define getcwd _getcwd
@@ -21,6 +23,7 @@
 #define S_ISDIR(x) (((x) & S_IFMT) == S_IFDIR)
 #else // _WIN32
 #include <dirent.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <mutex>
 #endif // _WIN32
@@ -138,6 +141,16 @@ namespace Utils
 				mFileCache[key] = cache;
 			}
 
+			static void add(const std::vector<std::pair<std::string, FileCache>>& items)
+			{
+				if (!mEnabled || items.size() == 0)
+					return;
+
+				std::unique_lock<std::mutex> lock(mFileCacheMutex);
+				for (auto& item : items)
+					mFileCache[item.first] = item.second;
+			}
+
 			static FileCache* get(const std::string& key)
 			{
 				if (!mEnabled)
@@ -166,6 +179,7 @@ namespace Utils
 			}
 
 			static void setEnabled(bool value) { mEnabled = value; }
+			static bool isEnabled() { return mEnabled; }
 
 		private:
 			static std::map<std::string, FileCache> mFileCache;
@@ -332,31 +346,49 @@ namespace Utils
 
 				if (dir != NULL)
 				{
+					std::vector<std::pair<std::string, FileCache>> cacheItems;
 					struct dirent* entry;
 
-					// loop over all files in the directory
+					// loop over all files in the directory. readdir is backed by getdents64, and d_type gives
+					// the type of each entry without a stat call
 					while ((entry = readdir(dir)) != NULL)
 					{
-						std::string name(entry->d_name);
+						const char* name = entry->d_name;
 
 						// ignore "." and ".."
-						if ((name != ".") && (name != ".."))
-						{
-							std::string fullName(getGenericPath(path + "/" + name));
+						if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0)))
+							continue;
 
-							FileInfo fi;
-							fi.path = fullName;
-							fi.hidden = Utils::FileSystem::isHidden(fullName);
-							fi.directory = (entry->d_type == 4); // DT_DIR;
+						unsigned char type = entry->d_type;
 
-							FileCache::add(fullName, FileCache(entry, fi.hidden));
+						// Some filesystems (NFS, ...) don't fill d_type
+						if (type == DT_UNKNOWN)
+						{
+							struct stat64 info;
+							if (fstatat64(dirfd(dir), name, &info, AT_SYMLINK_NOFOLLOW) == 0)
+								type = S_ISDIR(info.st_mode) ? DT_DIR : (S_ISLNK(info.st_mode) ? DT_LNK : DT_REG);
+						}
+
+						// path is already generic and name can't contain a '/'
+						FileInfo fi;
+						fi.path = path + "/" + name;
+						fi.hidden = (name[0] == '.');
+						fi.directory = (type == DT_DIR);
 
-							//DT_LNK
-							contentList.push_back(fi);
+						if (FileCache::isEnabled())
+						{
+							FileCache cache(true, fi.directory);
+							cache.hidden = fi.hidden;
+							cache.isSymLink = (type == DT_LNK);
+							cacheItems.push_back(std::make_pair(fi.path, cache));
 						}
+
+						contentList.push_back(fi);
 					}
 
 					closedir(dir);
+
+					FileCache::add(cacheItems);
 				}
 #endif // _WIN32
 
@@ -815,6 +847,34 @@ namespace Utils
 
 		} // removeFile
 
+		bool syncFile(const std::string& _path)
+		{
+			std::string path = getGenericPath(_path);
+
+#if defined(_WIN32)
+			// Directories can't be flushed, NTFS journals the renames itself
+			if (isDirectory(path))
+				return true;
+
+			int fd = _open(path.c_str(), _O_RDWR | _O_BINARY);
+			if (fd < 0)
+				return false;
+
+			bool ret = (_commit(fd) == 0);
+			_close(fd);
+			return ret;
+#else
+			int fd = open(path.c_str(), O_RDONLY);
+			if (fd < 0)
+				return false;
+
+			bool ret = (fsync(fd) == 0);
+			close(fd);
+			return ret;
+#endif // _WIN32
+
+		} // syncFile
+
 		bool createDirectory(const std::string& _path)
 		{
 			std::string path = getGenericPath(_path);
@@ -1053,6 +1113,18 @@ namespace Utils
 			return Utils::Time::DateTime();
 		}
 
+		Utils::Time::DateTime getFileModificationDate(const std::string& _path)
+		{
+			std::string path = getGenericPath(_path);
+			struct stat64 info;
+
+			// check if stat64 succeeded
+			if ((stat64(path.c_str(), &info) == 0))
+				return Utils::Time::DateTime(info.st_mtime);
+
+			return Utils::Time::DateTime();
+		}
+
 		std::string	readAllText(const std::string fileName)
 		{
 			std::ifstream t(fileName);
@@ -31,6 +31,7 @@ namespace Utils
 		std::string removeCommonPath   (const std::string& _path, const std::string& _common, bool& _contains);
 		std::string resolveSymlink     (const std::string& _path);
 		bool        removeFile         (const std::string& _path);
+		bool        syncFile           (const std::string& _path); // Flushes a file, or a directory entries (not on Windows), to the disk
 		bool        createDirectory    (const std::string& _path);
 		bool        exists             (const std::string& _path);
 		bool        isAbsolute         (const std::string& _path);
@@ -60,6 +61,7 @@ namespace Utils
 		std::string combine(const std::string& _path, const std::string& filename);
 		size_t		getFileSize(const std::string& _path);
 		Utils::Time::DateTime getFileCreationDate(const std::string& _path);
+		Utils::Time::DateTime getFileModificationDate(const std::string& _path);
 		std::string	readAllText(const std::string fileName);
 
 		class FileSystemCacheActivator
@@ -0,0 +1,976 @@
+#define _FILE_OFFSET_BITS 64
+
+#include "utils/HashUtil.h"
+#include "utils/FileSystemUtil.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <vector>
+
+#if defined(_WIN32)
+#define stat64 _stat64
+#define fseeko _fseeki64
+#elif defined(__linux__)
+#include <fcntl.h>
+#endif
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+// Files are read in large blocks, the kernel read-ahead does the rest
+#define HASH_READ_SIZE			(1024 * 1024)
+// Bigger archive directories are not worth reading : hashing gives up, the caller can still extract
+#define MAX_DIRECTORY_SIZE		(16 * 1024 * 1024)
+
+namespace Utils
+{
+	namespace Hash
+	{
+		static inline unsigned int read16(const unsigned char* p) { return p[0] | (p[1] << 8); }
+		static inline unsigned int read32(const unsigned char* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24); }
+		static inline unsigned long long read64(const unsigned char* p) { return read32(p) | ((unsigned long long)read32(p + 4) << 32); }
+
+		static inline unsigned int readBE32(const unsigned char* p) { return ((unsigned int)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+		static inline unsigned int rotl(unsigned int value, int bits) { return (value << bits) | (value >> (32 - bits)); }
+
+		static std::string toHex(const unsigned char* data, size_t length)
+		{
+			static const char* digits = "0123456789abcdef";
+
+			std::string ret(length * 2, '0');
+			for (size_t i = 0; i < length; i++)
+			{
+				ret[i * 2] = digits[data[i] >> 4];
+				ret[i * 2 + 1] = digits[data[i] & 15];
+			}
+
+			return ret;
+		}
+
+		static std::string crcToString(unsigned int crc)
+		{
+			char buffer[16];
+			snprintf(buffer, sizeof(buffer), "%08X", crc);
+			return buffer;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+		// CRC32 : ARMv8 crc instructions when the target has them, slice-by-8 tables otherwise
+		//////////////////////////////////////////////////////////////////////////
+
+		struct Crc32Tables
+		{
+			unsigned int table[8][256];
+
+			Crc32Tables()
+			{
+				for (unsigned int i = 0; i < 256; i++)
+				{
+					unsigned int crc = i;
+					for (int bit = 0; bit < 8; bit++)
+						crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+
+					table[0][i] = crc;
+				}
+
+				for (int slice = 1; slice < 8; slice++)
+					for (int i = 0; i < 256; i++)
+						table[slice][i] = (table[slice - 1][i] >> 8) ^ table[0][table[slice - 1][i] & 0xFF];
+			}
+		};
+
+		unsigned int crc32(const void* _data, size_t _length, unsigned int _crc)
+		{
+			const unsigned char* data = (const unsigned char*)_data;
+			unsigned int crc = ~_crc;
+
+#if defined(__ARM_FEATURE_CRC32)
+			for (; _length >= 8; _length -= 8, data += 8)
+			{
+				unsigned long long value;
+				memcpy(&value, data, 8);
+				crc = __crc32d(crc, value);
+			}
+
+			for (; _length > 0; _length--)
+				crc = __crc32b(crc, *data++);
+#else
+			static const Crc32Tables tables;
+			const unsigned int (*t)[256] = tables.table;
+
+			for (; _length >= 8; _length -= 8, data += 8)
+			{
+				unsigned int one = read32(data) ^ crc;
+				unsigned int two = read32(data + 4);
+
+				crc =
+					t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^ t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24] ^
+					t[3][two & 0xFF] ^ t[2][(two >> 8) & 0xFF] ^ t[1][(two >> 16) & 0xFF] ^ t[0][two >> 24];
+			}
+
+			for (; _length > 0; _length--)
+				crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xFF];
+#endif
+
+			return ~crc;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+		// MD5 & SHA1 : both work on 64 bytes blocks
+		//////////////////////////////////////////////////////////////////////////
+
+		template<class T> class BlockHash
+		{
+		public:
+			BlockHash() : mUsed(0), mLength(0) { }
+
+			void update(const unsigned char* data, size_t length)
+			{
+				mLength += length;
+
+				if (mUsed > 0)
+				{
+					size_t count = std::min(length, (size_t)64 - mUsed);
+					memcpy(mBuffer + mUsed, data, count);
+					mUsed += count;
+					data += count;
+					length -= count;
+
+					if (mUsed < 64)
+						return;
+
+					static_cast<T*>(this)->transform(mBuffer);
+					mUsed = 0;
+				}
+
+				for (; length >= 64; length -= 64, data += 64)
+					static_cast<T*>(this)->transform(data);
+
+				memcpy(mBuffer, data, length);
+				mUsed = length;
+			}
+
+		protected:
+			// Appends the padding and the message length in bits, 'bigEndian' for sha1
+			void pad(bool bigEndian)
+			{
+				unsigned long long bits = mLength * 8;
+
+				unsigned char padding[72] = { 0x80 };
+				size_t count = (mUsed < 56 ? 56 : 120) - mUsed;
+
+				for (int i = 0; i < 8; i++)
+					padding[count + i] = (unsigned char)(bits >> (bigEndian ? 56 - i * 8 : i * 8));
+
+				update(padding, count + 8);
+			}
+
+			unsigned char		mBuffer[64];
+			size_t				mUsed;
+			unsigned long long	mLength;
+		};
+
+		class Md5 : public BlockHash<Md5>
+		{
+		public:
+			Md5() { mState[0] = 0x67452301; mState[1] = 0xefcdab89; mState[2] = 0x98badcfe; mState[3] = 0x10325476; }
+
+			void transform(const unsigned char* block)
+			{
+				static const unsigned int k[64] =
+				{
+					0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+					0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+					0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+					0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+					0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+					0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+					0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+					0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+				};
+
+				static const int shifts[16] = { 7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21 };
+
+				unsigned int m[16];
+				for (int i = 0; i < 16; i++)
+					m[i] = read32(block + i * 4);
+
+				unsigned int a = mState[0], b = mState[1], c = mState[2], d = mState[3];
+
+				for (int i = 0; i < 64; i++)
+				{
+					unsigned int f;
+					int g;
+
+					switch (i >> 4)
+					{
+					case 0: f = (b & c) | (~b & d); g = i; break;
+					case 1: f = (d & b) | (~d & c); g = (5 * i + 1) & 15; break;
+					case 2: f = b ^ c ^ d; g = (3 * i + 5) & 15; break;
+					default: f = c ^ (b | ~d); g = (7 * i) & 15; break;
+					}
+
+					unsigned int tmp = d;
+					d = c;
+					c = b;
+					b = b + rotl(a + f + k[i] + m[g], shifts[((i >> 4) << 2) | (i & 3)]);
+					a = tmp;
+				}
+
+				mState[0] += a; mState[1] += b; mState[2] += c; mState[3] += d;
+			}
+
+			std::string finalize()
+			{
+				pad(false);
+
+				unsigned char digest[16];
+				for (int i = 0; i < 16; i++)
+					digest[i] = (unsigned char)(mState[i >> 2] >> ((i & 3) * 8));
+
+				return toHex(digest, 16);
+			}
+
+		private:
+			unsigned int mState[4];
+		};
+
+		class Sha1 : public BlockHash<Sha1>
+		{
+		public:
+			Sha1() { mState[0] = 0x67452301; mState[1] = 0xefcdab89; mState[2] = 0x98badcfe; mState[3] = 0x10325476; mState[4] = 0xc3d2e1f0; }
+
+			void transform(const unsigned char* block)
+			{
+				unsigned int w[80];
+				for (int i = 0; i < 16; i++)
+					w[i] = readBE32(block + i * 4);
+
+				for (int i = 16; i < 80; i++)
+					w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+				unsigned int a = mState[0], b = mState[1], c = mState[2], d = mState[3], e = mState[4];
+
+				for (int i = 0; i < 80; i++)
+				{
+					unsigned int f, k;
+
+					if (i < 20)      { f = (b & c) | (~b & d);          k = 0x5a827999; }
+					else if (i < 40) { f = b ^ c ^ d;                   k = 0x6ed9eba1; }
+					else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8f1bbcdc; }
+					else             { f = b ^ c ^ d;                   k = 0xca62c1d6; }
+
+					unsigned int tmp = rotl(a, 5) + f + e + k + w[i];
+					e = d;
+					d = c;
+					c = rotl(b, 30);
+					b = a;
+					a = tmp;
+				}
+
+				mState[0] += a; mState[1] += b; mState[2] += c; mState[3] += d; mState[4] += e;
+			}
+
+			std::string finalize()
+			{
+				pad(true);
+
+				unsigned char digest[20];
+				for (int i = 0; i < 20; i++)
+					digest[i] = (unsigned char)(mState[i >> 2] >> (24 - (i & 3) * 8));
+
+				return toHex(digest, 20);
+			}
+
+		private:
+			unsigned int mState[5];
+		};
+
+		//////////////////////////////////////////////////////////////////////////
+		// Archive directories
+		//////////////////////////////////////////////////////////////////////////
+
+		static bool readAt(FILE* file, long long offset, void* buffer, size_t size)
+		{
+			return offset >= 0 && fseeko(file, offset, SEEK_SET) == 0 && fread(buffer, 1, size, file) == size;
+		}
+
+		// Zip : the crc of each entry is in the central directory, found from the end of central directory record
+		static bool readZipCRC32(FILE* file, long long fileSize, unsigned int& crc)
+		{
+			// The record is 22 bytes long, followed by a comment of up to 64 Kb
+			size_t tailSize = (size_t)std::min<long long>(fileSize, 22 + 0xFFFF);
+			if (tailSize < 22)
+				return false;
+
+			std::vector<unsigned char> tail(tailSize);
+			if (!readAt(file, fileSize - tailSize, &tail[0], tailSize))
+				return false;
+
+			long long eocd = -1;
+			for (long long i = tailSize - 22; i >= 0; i--)
+			{
+				if (read32(&tail[i]) == 0x06054b50)
+				{
+					eocd = i;
+					break;
+				}
+			}
+
+			if (eocd < 0)
+				return false;
+
+			unsigned long long entries = read16(&tail[eocd + 10]);
+			unsigned long long directorySize = read32(&tail[eocd + 12]);
+			unsigned long long directoryOffset = read32(&tail[eocd + 16]);
+
+			if (entries == 0xFFFF || directorySize == 0xFFFFFFFF || directoryOffset == 0xFFFFFFFF)
+			{
+				// Zip64 : the locator of the zip64 record is just before the end of central directory record
+				unsigned char record[56];
+				if (!readAt(file, fileSize - tailSize + eocd - 20, record, 20) || read32(record) != 0x07064b50)
+					return false;
+
+				if (!readAt(file, (long long)read64(record + 8), record, 56) || read32(record) != 0x06064b50)
+					return false;
+
+				entries = read64(record + 32);
+				directorySize = read64(record + 40);
+				directoryOffset = read64(record + 48);
+			}
+
+			if (directorySize < 46 || directorySize > MAX_DIRECTORY_SIZE || directoryOffset + directorySize > (unsigned long long)fileSize)
+				return false;
+
+			std::vector<unsigned char> directory((size_t)directorySize);
+			if (!readAt(file, (long long)directoryOffset, &directory[0], directory.size()))
+				return false;
+
+			// Same as 7zr l -slt : the last file entry wins. Folders have no crc
+			bool found = false;
+
+			size_t pos = 0;
+			for (unsigned long long i = 0; i < entries && pos + 46 <= directory.size(); i++)
+			{
+				const unsigned char* entry = &directory[pos];
+				if (read32(entry) != 0x02014b50)
+					break;
+
+				size_t nameLength = read16(entry + 28);
+				if (pos + 46 + nameLength > directory.size())
+					break;
+
+				char last = nameLength > 0 ? (char)entry[46 + nameLength - 1] : '/';
+				if (last != '/' && last != '\\')
+				{
+					crc = read32(entry + 16);
+					found = true;
+				}
+
+				pos += 46 + nameLength + read16(entry + 30) + read16(entry + 32);
+			}
+
+			return found;
+		}
+
+		// 7z : the crcs are in the header at the end of the archive. 7-Zip compresses that header by default,
+		// decoding it needs lzma : only plain headers are read here
+		class SevenZipHeader
+		{
+		public:
+			SevenZipHeader(const unsigned char* data, size_t size) : mPos(data), mEnd(data + size), mValid(true) { }
+
+			bool getLastCRC32(unsigned int& crc)
+			{
+				enum { kEnd = 0, kHeader = 1, kArchiveProperties = 2, kMainStreamsInfo = 4 };
+
+				if (readByte() != kHeader)
+					return false;
+
+				int id = readByte();
+				if (id == kArchiveProperties)
+				{
+					while (mValid && readByte() != kEnd)
+						skip(readNumber());
+
+					id = readByte();
+				}
+
+				// Streams are stored in the same order as the files that have data : the last one is the last file
+				if (id != kMainStreamsInfo || !readStreamsInfo() || mStreams.empty() || !mStreams.back().defined)
+					return false;
+
+				crc = mStreams.back().crc;
+				return mValid;
+			}
+
+		private:
+			enum { kEnd = 0, kPackInfo = 6, kUnPackInfo = 7, kSubStreamsInfo = 8, kSize = 9, kCRC = 10, kFolder = 11, kCodersUnPackSize = 12, kNumUnPackStream = 13 };
+
+			struct Stream
+			{
+				bool			defined;
+				unsigned int	crc;
+			};
+
+			int readByte()
+			{
+				if (mPos >= mEnd)
+				{
+					mValid = false;
+					return kEnd;
+				}
+
+				return *mPos++;
+			}
+
+			void skip(unsigned long long count)
+			{
+				if (count > (unsigned long long)(mEnd - mPos))
+				{
+					mValid = false;
+					mPos = mEnd;
+				}
+				else
+					mPos += count;
+			}
+
+			unsigned long long readNumber()
+			{
+				int first = readByte();
+				int mask = 0x80;
+				unsigned long long value = 0;
+
+				for (int i = 0; i < 8; i++)
+				{
+					if ((first & mask) == 0)
+						return value | ((unsigned long long)(first & (mask - 1)) << (i * 8));
+
+					value |= (unsigned long long)readByte() << (i * 8);
+					mask >>= 1;
+				}
+
+				return value;
+			}
+
+			std::vector<Stream> readDigests(size_t count)
+			{
+				std::vector<Stream> digests(count);
+
+				int allDefined = readByte();
+				int mask = 0;
+				int bits = 0;
+
+				for (auto& digest : digests)
+				{
+					if (mask == 0)
+					{
+						bits = allDefined ? 0xFF : readByte();
+						mask = 0x80;
+					}
+
+					digest.defined = (bits & mask) != 0;
+					mask >>= 1;
+				}
+
+				for (auto& digest : digests)
+				{
+					digest.crc = 0;
+
+					if (digest.defined && mValid)
+					{
+						if (mEnd - mPos < 4)
+							mValid = false;
+						else
+						{
+							digest.crc = read32(mPos);
+							mPos += 4;
+						}
+					}
+				}
+
+				return digests;
+			}
+
+			bool readStreamsInfo()
+			{
+				int id = readByte();
+
+				if (id == kPackInfo)
+				{
+					readNumber();
+					unsigned long long packStreams = readNumber();
+
+					while (mValid && (id = readByte()) != kEnd)
+					{
+						if (id == kSize)
+							for (unsigned long long i = 0; i < packStreams && mValid; i++)
+								readNumber();
+						else if (id == kCRC)
+							readDigests((size_t)std::min<unsigned long long>(packStreams, mEnd - mPos));
+						else
+							return false;
+					}
+
+					id = readByte();
+				}
+
+				std::vector<unsigned long long> folderOutputs;
+				std::vector<Stream> folderDigests;
+
+				if (id == kUnPackInfo)
+				{
+					if (readByte() != kFolder)
+						return false;
+
+					unsigned long long folders = readNumber();
+					if (readByte() != 0 || folders > (unsigned long long)(mEnd - mPos))
+						return false;
+
+					for (unsigned long long f = 0; f < folders && mValid; f++)
+					{
+						unsigned long long coders = readNumber();
+						unsigned long long inputs = 0;
+						unsigned long long outputs = 0;
+
+						for (unsigned long long c = 0; c < coders && mValid; c++)
+						{
+							int flags = readByte();
+							if (flags & 0x80)
+								return false;
+
+							skip(flags & 0x0F);
+
+							if (flags & 0x10)
+							{
+								inputs += readNumber();
+								outputs += readNumber();
+							}
+							else
+							{
+								inputs++;
+								outputs++;
+							}
+
+							if (flags & 0x20)
+								skip(readNumber());
+						}
+
+						if (outputs == 0 || outputs > inputs + 1 || outputs > (unsigned long long)(mEnd - mPos))
+							return false;
+
+						for (unsigned long long b = 0; b < outputs - 1; b++)
+						{
+							readNumber();
+							readNumber();
+						}
+
+						unsigned long long packed = inputs - (outputs - 1);
+						if (packed > 1)
+							for (unsigned long long p = 0; p < packed; p++)
+								readNumber();
+
+						folderOutputs.push_back(outputs);
+					}
+
+					if (readByte() != kCodersUnPackSize)
+						return false;
+
+					for (auto outputs : folderOutputs)
+						for (unsigned long long o = 0; o < outputs; o++)
+							readNumber();
+
+					folderDigests.resize(folderOutputs.size());
+
+					id = readByte();
+					if (id == kCRC)
+					{
+						folderDigests = readDigests(folderOutputs.size());
+						id = readByte();
+					}
+
+					if (id != kEnd)
+						return false;
+
+					id = readByte();
+				}
+
+				std::vector<unsigned long long> unpackStreams(folderOutputs.size(), 1);
+
+				if (id == kSubStreamsInfo)
+				{
+					id = readByte();
+					if (id == kNumUnPackStream)
+					{
+						for (auto& count : unpackStreams)
+							count = readNumber();
+
+						id = readByte();
+					}
+
+					if (id == kSize)
+					{
+						for (auto count : unpackStreams)
+							for (unsigned long long i = 1; i < count && mValid; i++)
+								readNumber();
+
+						id = readByte();
+					}
+
+					// Folders with a single stream already have their crc
+					size_t unknown = 0;
+					for (size_t f = 0; f < unpackStreams.size(); f++)
+						if (unpackStreams[f] != 1 || !folderDigests[f].defined)
+							unknown += (size_t)std::min<unsigned long long>(unpackStreams[f], mEnd - mPos);
+
+					std::vector<Stream> digests;
+					if (id == kCRC)
+					{
+						digests = readDigests(unknown);
+						id = readByte();
+					}
+					else
+						digests.resize(unknown);
+
+					if (id != kEnd)
+						return false;
+
+					size_t next = 0;
+					for (size_t f = 0; f < unpackStreams.size() && mValid; f++)
+					{
+						if (unpackStreams[f] == 1 && folderDigests[f].defined)
+							mStreams.push_back(folderDigests[f]);
+						else
+							for (unsigned long long i = 0; i < unpackStreams[f] && next < digests.size(); i++)
+								mStreams.push_back(digests[next++]);
+					}
+
+					id = readByte();
+				}
+				else
+					mStreams = folderDigests;
+
+				return mValid && id == kEnd;
+			}
+
+			const unsigned char*	mPos;
+			const unsigned char*	mEnd;
+			bool					mValid;
+
+			std::vector<Stream>		mStreams;
+		};
+
+		static bool read7zCRC32(FILE* file, long long fileSize, unsigned int& crc)
+		{
+			static const unsigned char signature[6] = { '7', 'z', 0xBC, 0xAF, 0x27, 0x1C };
+
+			unsigned char start[32];
+			if (!readAt(file, 0, start, 32) || memcmp(start, signature, 6) != 0)
+				return false;
+
+			unsigned long long offset = read64(start + 12) + 32;
+			unsigned long long size = read64(start + 20);
+
+			if (size == 0 || size > MAX_DIRECTORY_SIZE || offset + size > (unsigned long long)fileSize)
+				return false;
+
+			std::vector<unsigned char> header((size_t)size);
+			if (!readAt(file, (long long)offset, &header[0], header.size()) || crc32(&header[0], header.size()) != read32(start + 28))
+				return false;
+
+			SevenZipHeader reader(&header[0], header.size());
+			return reader.getLastCRC32(crc);
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+		// Cache
+		//////////////////////////////////////////////////////////////////////////
+
+		struct CacheEntry
+		{
+			CacheEntry() : size(0), time(0), types(0), archiveRead(false) { }
+
+			long long	size;
+			time_t		time;
+
+			int			types;
+			Digest		digest;
+
+			bool		archiveRead;
+			std::string	archiveCrc;
+		};
+
+		static std::mutex							sCacheLock;
+		static std::map<std::string, CacheEntry>	sCache;
+		static bool									sCacheChanged = false;
+
+		static bool getFileInfo(const std::string& path, long long& size, time_t& time)
+		{
+			struct stat64 info;
+			if (stat64(path.c_str(), &info) != 0)
+				return false;
+
+			size = (long long)info.st_size;
+			time = info.st_mtime;
+			return true;
+		}
+
+		// Returns the cached entry of the file, reset if the file changed
+		static CacheEntry& getCacheEntry(const std::string& path, long long size, time_t time)
+		{
+			CacheEntry& entry = sCache[path];
+			if (entry.size != size || entry.time != time)
+			{
+				entry = CacheEntry();
+				entry.size = size;
+				entry.time = time;
+			}
+
+			return entry;
+		}
+
+		static void copyDigest(const Digest& source, int types, Digest& target)
+		{
+			if (types & CRC32) target.crc32 = source.crc32;
+			if (types & MD5) target.md5 = source.md5;
+			if (types & SHA1) target.sha1 = source.sha1;
+		}
+
+		bool hashFile(const std::string& _path, int _types, Digest& _digest, long long* _bytesRead)
+		{
+			if (_bytesRead != nullptr)
+				*_bytesRead = 0;
+
+			long long size;
+			time_t time;
+			if (!getFileInfo(_path, size, time))
+				return false;
+
+			_types &= ALL;
+
+			{
+				std::unique_lock<std::mutex> lock(sCacheLock);
+
+				CacheEntry& entry = getCacheEntry(_path, size, time);
+				if ((entry.types & _types) == _types)
+				{
+					copyDigest(entry.digest, _types, _digest);
+					return true;
+				}
+			}
+
+			FILE* file = fopen(_path.c_str(), "rb");
+			if (file == nullptr)
+				return false;
+
+#if defined(__linux__)
+			posix_fadvise(fileno(file), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+			unsigned int crc = 0;
+			Md5 md5;
+			Sha1 sha1;
+
+			std::vector<unsigned char> buffer(HASH_READ_SIZE);
+
+			bool ok = true;
+			size_t count;
+
+			while ((count = fread(&buffer[0], 1, buffer.size(), file)) > 0)
+			{
+				if (_bytesRead != nullptr)
+					*_bytesRead += count;
+
+				if (_types & CRC32) crc = crc32(&buffer[0], count, crc);
+				if (_types & MD5) md5.update(&buffer[0], count);
+				if (_types & SHA1) sha1.update(&buffer[0], count);
+			}
+
+			if (ferror(file))
+				ok = false;
+
+			fclose(file);
+
+			if (!ok)
+				return false;
+
+			Digest digest;
+			if (_types & CRC32) digest.crc32 = crcToString(crc);
+			if (_types & MD5) digest.md5 = md5.finalize();
+			if (_types & SHA1) digest.sha1 = sha1.finalize();
+
+			copyDigest(digest, _types, _digest);
+
+			std::unique_lock<std::mutex> lock(sCacheLock);
+
+			CacheEntry& entry = getCacheEntry(_path, size, time);
+			copyDigest(digest, _types, entry.digest);
+			entry.types |= _types;
+			sCacheChanged = true;
+
+			return true;
+		}
+
+		std::string getArchiveCRC32(const std::string& _path)
+		{
+			long long size;
+			time_t time;
+			if (!getFileInfo(_path, size, time))
+				return "";
+
+			{
+				std::unique_lock<std::mutex> lock(sCacheLock);
+
+				CacheEntry& entry = getCacheEntry(_path, size, time);
+				if (entry.archiveRead)
+					return entry.archiveCrc;
+			}
+
+			FILE* file = fopen(_path.c_str(), "rb");
+			if (file == nullptr)
+				return "";
+
+			unsigned int crc = 0;
+			bool found = readZipCRC32(file, size, crc) || read7zCRC32(file, size, crc);
+
+			fclose(file);
+
+			std::string ret = found ? crcToString(crc) : "";
+
+			std::unique_lock<std::mutex> lock(sCacheLock);
+
+			CacheEntry& entry = getCacheEntry(_path, size, time);
+			entry.archiveRead = true;
+			entry.archiveCrc = ret;
+			sCacheChanged = true;
+
+			return ret;
+		}
+
+		void setArchiveCRC32(const std::string& _path, const std::string& _crc)
+		{
+			long long size;
+			time_t time;
+			if (_crc.empty() || !getFileInfo(_path, size, time))
+				return;
+
+			std::unique_lock<std::mutex> lock(sCacheLock);
+
+			CacheEntry& entry = getCacheEntry(_path, size, time);
+			entry.archiveRead = true;
+			entry.archiveCrc = _crc;
+			sCacheChanged = true;
+		}
+
+		void clearCache()
+		{
+			std::unique_lock<std::mutex> lock(sCacheLock);
+			sCache.clear();
+		}
+
+		// One entry per line : size, time, types, crc32, md5, sha1, archive read, archive crc and path, separated with tabs
+		bool loadCache(const std::string& _path)
+		{
+			std::ifstream file(_path);
+			if (!file.is_open())
+				return false;
+
+			std::unique_lock<std::mutex> lock(sCacheLock);
+
+			std::string line;
+			std::vector<std::string> fields;
+
+			while (std::getline(file, line))
+			{
+				fields.clear();
+
+				size_t start = 0;
+				for (int i = 0; i < 8; i++)
+				{
+					size_t end = line.find('\t', start);
+					if (end == std::string::npos)
+						break;
+
+					fields.push_back(line.substr(start, end - start));
+					start = end + 1;
+				}
+
+				if (fields.size() != 8 || start >= line.size())
+					continue;
+
+				std::string path = line.substr(start);
+				if (sCache.find(path) != sCache.cend())
+					continue;
+
+				CacheEntry entry;
+				entry.size = atoll(fields[0].c_str());
+				entry.time = (time_t)atoll(fields[1].c_str());
+				entry.types = atoi(fields[2].c_str()) & ALL;
+				entry.digest.crc32 = fields[3];
+				entry.digest.md5 = fields[4];
+				entry.digest.sha1 = fields[5];
+				entry.archiveRead = fields[6] == "1";
+				entry.archiveCrc = fields[7];
+
+				sCache[path] = entry;
+			}
+
+			return true;
+		}
+
+		bool saveCache(const std::string& _path)
+		{
+			std::unique_lock<std::mutex> lock(sCacheLock);
+			if (!sCacheChanged)
+				return true;
+
+			// Written aside then renamed : an interrupted save doesn't lose the previous index
+			std::string tmpPath = _path + ".tmp";
+
+			{
+				std::ofstream file(tmpPath, std::ios::out | std::ios::trunc);
+				if (!file.is_open())
+					return false;
+
+				for (auto& it : sCache)
+				{
+					const CacheEntry& entry = it.second;
+					if (entry.types == 0 && !entry.archiveRead)
+						continue;
+
+					file << entry.size << '\t' << (long long)entry.time << '\t' << entry.types << '\t' <<
+						entry.digest.crc32 << '\t' << entry.digest.md5 << '\t' << entry.digest.sha1 << '\t' <<
+						(entry.archiveRead ? 1 : 0) << '\t' << entry.archiveCrc << '\t' << it.first << '\n';
+				}
+
+				if (!file.good())
+					return false;
+			}
+
+			// The new index must be on the disk before it replaces the previous one
+			if (!Utils::FileSystem::syncFile(tmpPath))
+				return false;
+
+#if defined(_WIN32)
+			// rename doesn't overwrite an existing file on Windows
+			remove(_path.c_str());
+#endif
+			if (rename(tmpPath.c_str(), _path.c_str()) != 0)
+				return false;
+
+			Utils::FileSystem::syncFile(Utils::FileSystem::getParent(_path));
+
+			sCacheChanged = false;
+			return true;
+		}
+
+	} // Hash::
+
+} // Utils::
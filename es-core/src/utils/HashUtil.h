@@ -0,0 +1,57 @@
+#pragma once
+#ifndef ES_CORE_UTILS_HASH_UTIL_H
+#define ES_CORE_UTILS_HASH_UTIL_H
+
+#include <stddef.h>
+#include <string>
+
+namespace Utils
+{
+	//
+	// In-process file hashing. All the requested digests are computed in a single pass over the file,
+	// and the results are cached by path, size and modification date, so a file is only read once
+	// whatever asks for its crc32 or md5 later (hasher, scrapers, netplay).
+	// Thread safe.
+	//
+	namespace Hash
+	{
+		enum Type
+		{
+			CRC32 = 1,
+			MD5   = 2,
+			SHA1  = 4,
+			ALL   = CRC32 | MD5 | SHA1
+		};
+
+		struct Digest
+		{
+			std::string crc32;	// 8 upper case hex digits, like 7-Zip prints them
+			std::string md5;	// lower case hex
+			std::string sha1;	// lower case hex
+		};
+
+		// Hashes the whole file. 'types' is a combination of Type, the other fields of 'digest' are left as they are.
+		// 'bytesRead' receives the bytes actually read from the file, 0 when the digests came from the cache
+		bool hashFile(const std::string& _path, int _types, Digest& _digest, long long* _bytesRead = nullptr);
+
+		// CRC32 of the last file of a zip or 7z archive, read from the archive directory without extracting anything.
+		// Returns an empty string if it can't be read (7z archives with compressed headers for example)
+		std::string getArchiveCRC32(const std::string& _path);
+
+		// Stores a crc getArchiveCRC32 couldn't read, found by other means (7zr), so it is returned on later calls.
+		// Keyed on the current size and modification date of the archive, like the rest of the cache
+		void setArchiveCRC32(const std::string& _path, const std::string& _crc);
+
+		// Standard (zlib) crc32 of a buffer. Pass the previous result to continue a crc
+		unsigned int crc32(const void* _data, size_t _length, unsigned int _crc = 0);
+
+		// Persistent copy of the cache, so the files that didn't change are not read again after a restart.
+		// Loading merges the file into the cache, the entries already in memory are kept
+		bool loadCache(const std::string& _path);
+		bool saveCache(const std::string& _path);
+
+		void clearCache();
+	}
+}
+
+#endif // ES_CORE_UTILS_HASH_UTIL_H
@@ -6,88 +6,218 @@
 
 namespace Utils
 {
-	ThreadPool::ThreadPool() : mRunning(true), mWaiting(false), mNumWork(0)
-	{
-		size_t num_threads = std::thread::hardware_concurrency() * 2;
+	static thread_local ThreadPool* sCurrentPool = nullptr;
+	static thread_local int sCurrentQueue = -1;
 
-		auto doWork = [&](size_t id)
-		{
-#if WIN32
-			auto mask = (static_cast<DWORD_PTR>(1) << id);
-			SetThreadAffinityMask(GetCurrentThread(), mask);
-#endif
+	ThreadPool::ThreadPool(int threadCount) : mRunning(true), mNumWork(0), mNumQueued(0), mNextQueue(0)
+	{
+		size_t num_threads = threadCount > 0 ? (size_t)threadCount : std::thread::hardware_concurrency();
+		if (num_threads == 0)
+			num_threads = 1;
 
-			while (mRunning)
-			{
-				_mutex.lock();
-				if (!mWorkQueue.empty())
-				{
-					auto work = mWorkQueue.front();
-					mWorkQueue.pop();
-					_mutex.unlock();
-
-					try
-					{
-						work();
-					}
-					catch (...) {}
-
-					mNumWork--;
-				}
-				else
-				{
-					_mutex.unlock();
-
-					// Extra code : Exit finished threads
-					if (mWaiting)
-						return;
-
-					std::this_thread::yield();
-					std::this_thread::sleep_for(std::chrono::milliseconds(1));
-				}
-			}
-		};
+		mQueues.reserve(num_threads);
+		for (size_t i = 0; i < num_threads; i++)
+			mQueues.push_back(new WorkQueue());
 
 		mThreads.reserve(num_threads);
 
 		for (size_t i = 0; i < num_threads; i++)
-			mThreads.push_back(std::thread(doWork, i));
+			mThreads.push_back(std::thread(&ThreadPool::workerProc, this, (int)i));
 	}
 
 	ThreadPool::~ThreadPool()
 	{
-		mRunning = false;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mRunning = false;
+		}
+
+		mWorkAvailable.notify_all();
 
 		for (std::thread& t : mThreads)
 			if (t.joinable())
 				t.join();
+
+		for (auto queue : mQueues)
+			delete queue;
+	}
+
+	ThreadPool* ThreadPool::getCurrent()
+	{
+		return sCurrentPool;
+	}
+
+	void ThreadPool::workerProc(int index)
+	{
+#if WIN32
+		auto mask = (static_cast<DWORD_PTR>(1) << index);
+		SetThreadAffinityMask(GetCurrentThread(), mask);
+#endif
+
+		sCurrentPool = this;
+		sCurrentQueue = index;
+
+		while (true)
+		{
+			if (runPendingWork(index))
+				continue;
+
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWorkAvailable.wait(lock, [this] { return !mRunning || mNumQueued > 0; });
+
+			if (!mRunning)
+				break;
+		}
 	}
 
 	void ThreadPool::queueWorkItem(work_function work)
 	{
-		_mutex.lock();
-		mWorkQueue.push(work);
+		// Nested work stays on the queue of the worker that created it, other work is spread over all queues
+		size_t index = (sCurrentPool == this) ? (size_t)sCurrentQueue : mNextQueue++ % mQueues.size();
+
 		mNumWork++;
-		_mutex.unlock();
+
+		{
+			WorkQueue* queue = mQueues[index];
+			std::unique_lock<std::mutex> lock(queue->mutex);
+			queue->items.push_back(work);
+			mNumQueued++;
+		}
+
+		{
+			// Taking the lock makes sure a worker checking mNumQueued before parking doesn't miss this item
+			std::unique_lock<std::mutex> lock(mMutex);
+		}
+
+		mWorkAvailable.notify_one();
+	}
+
+	bool ThreadPool::runPendingWork(int index)
+	{
+		work_function work;
+		bool found = false;
+
+		// Own queue first, newest item first
+		if (index >= 0)
+		{
+			WorkQueue* queue = mQueues[index];
+			std::unique_lock<std::mutex> lock(queue->mutex);
+			if (!queue->items.empty())
+			{
+				work = queue->items.back();
+				queue->items.pop_back();
+				found = true;
+			}
+		}
+
+		// Then steal the oldest item of another queue
+		size_t start = index >= 0 ? (size_t)index : 0;
+		for (size_t i = 1; !found && i <= mQueues.size(); i++)
+		{
+			WorkQueue* queue = mQueues[(start + i) % mQueues.size()];
+			std::unique_lock<std::mutex> lock(queue->mutex);
+			if (!queue->items.empty())
+			{
+				work = queue->items.front();
+				queue->items.pop_front();
+				found = true;
+			}
+		}
+
+		if (!found)
+			return false;
+
+		mNumQueued--;
+
+		try
+		{
+			work();
+		}
+		catch (...) {}
+
+		mNumWork--;
+
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+		}
+
+		mWorkDone.notify_all();
+		return true;
+	}
+
+	void ThreadPool::waitForCompletion(int timeoutMs)
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+
+		if (mNumWork == 0 || mNumQueued > 0)
+			return;
+
+		mWorkDone.wait_for(lock, std::chrono::milliseconds(timeoutMs));
 	}
 
 	void ThreadPool::wait()
 	{
-		mWaiting = true;
-		while (mNumWork.load() > 0)
-			std::this_thread::yield();
+		while (mNumWork > 0)
+		{
+			if (!runPendingWork(sCurrentPool == this ? sCurrentQueue : -1))
+				waitForCompletion(100);
+		}
 	}
 
 	void ThreadPool::wait(work_function work, int delay)
 	{
-		mWaiting = true;
+		// The calling thread only refreshes here (it is usually the UI thread), workers do the job
+		while (mNumWork > 0)
+		{
+			work();
+
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWorkDone.wait_for(lock, std::chrono::milliseconds(delay), [this] { return mNumWork == 0; });
+		}
+	}
+
+	TaskGroup::TaskGroup(ThreadPool* pool) : mPool(pool), mPending(0)
+	{
+	}
 
-		while (mNumWork.load() > 0)
+	TaskGroup::~TaskGroup()
+	{
+		wait();
+	}
+
+	void TaskGroup::run(ThreadPool::work_function work)
+	{
+		if (mPool == nullptr)
 		{
 			work();
+			return;
+		}
 
-			std::this_thread::yield();
-			std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+		mPending++;
+
+		mPool->queueWorkItem([this, work]
+		{
+			try
+			{
+				work();
+			}
+			catch (...) {}
+
+			mPending--;
+		});
+	}
+
+	void TaskGroup::wait()
+	{
+		if (mPool == nullptr)
+			return;
+
+		int index = (ThreadPool::getCurrent() == mPool) ? sCurrentQueue : -1;
+
+		while (mPending > 0)
+		{
+			if (!mPool->runPendingWork(index))
+				mPool->waitForCompletion(10);
 		}
 	}
-}
\ No newline at end of file
+}
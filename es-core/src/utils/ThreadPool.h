@@ -3,33 +3,88 @@
 
 #include <thread>
 #include <mutex>
-#include <queue>
+#include <condition_variable>
+#include <deque>
 #include <atomic>
 #include <functional>
+#include <vector>
 
 namespace Utils
 {
+	//
+	// Work stealing thread pool. Each worker owns a deque : work queued from a worker thread goes
+	// on its own deque (nested work items run LIFO, close to their parent), work queued from other
+	// threads is spread over the workers. Idle workers steal from the other deques, and park on a
+	// condition variable when there is nothing left to do.
+	//
 	class ThreadPool
 	{
 	public:
 		typedef std::function<void(void)> work_function;
 
-		ThreadPool();
+		// threadCount <= 0 uses the number of hardware threads
+		ThreadPool(int threadCount = 0);
 		~ThreadPool();
 
 		void queueWorkItem(work_function work);
+
+		// Wait for all work items to complete. The calling thread runs queued work while waiting
 		void wait();
+		// Wait for all work items to complete, calling 'work' every 'delay' ms (to refresh a loading screen for example)
 		void wait(work_function work, int delay = 50);
 
+		size_t getThreadCount() { return mThreads.size(); }
+
+		// Pool owning the calling thread, or nullptr if it is not a worker thread
+		static ThreadPool* getCurrent();
+
 	private:
-		bool mRunning;
-		bool mWaiting;
-		std::queue<work_function> mWorkQueue;
-		std::atomic<size_t> mNumWork;
-		std::mutex _mutex;
-		std::vector<std::thread> mThreads;
+		friend class TaskGroup;
+
+		struct WorkQueue
+		{
+			std::mutex					mutex;
+			std::deque<work_function>	items;
+		};
+
+		void workerProc(int index);
+
+		// Runs one queued work item on the calling thread. Returns false if there was nothing to run
+		bool runPendingWork(int index);
+		// Parks the calling thread until a work item completes or the timeout expires
+		void waitForCompletion(int timeoutMs);
+
+		bool						mRunning;
+		std::vector<WorkQueue*>		mQueues;
+		std::vector<std::thread>	mThreads;
+
+		std::atomic<size_t>			mNumWork;	// Queued and running work items
+		std::atomic<size_t>			mNumQueued;	// Queued work items only
+		std::atomic<size_t>			mNextQueue;
 
+		std::mutex					mMutex;
+		std::condition_variable		mWorkAvailable;
+		std::condition_variable		mWorkDone;
+	};
+
+	//
+	// Group of work items that can be waited for separately from the rest of the pool. Waiting runs
+	// pending work on the calling thread, so it is safe to wait for a group from inside a work item.
+	// Without a pool, work items run immediately on the calling thread.
+	//
+	class TaskGroup
+	{
+	public:
+		TaskGroup(ThreadPool* pool);
+		~TaskGroup();
+
+		void run(ThreadPool::work_function work);
+		void wait();
+
+	private:
+		ThreadPool*			mPool;
+		std::atomic<size_t>	mPending;
 	};
 }
 
-#endif
\ No newline at end of file
+#endif